@@ -3,3 +3,5 @@
 #include "Component.h"
 
 const double Enki::Component::OMNIDIRECTIONAL = std::numeric_limits<double>::max ();
+
+const double Enki::Component::IMMOVABLE_DRY_FRICTION = 1000;
@@ -26,6 +26,11 @@ namespace Enki
 		 * Constant that represents a component without an orientation.
 		 */
 		static const double OMNIDIRECTIONAL;
+		/**
+		 * Dry friction coefficient of objects that cannot be moved, such as
+		 * CASUs.
+		 */
+		static const double IMMOVABLE_DRY_FRICTION;
 		/**
 		 * The owner of this component.
 		 */
@@ -105,6 +110,15 @@ namespace Enki
 		{
 			return absoluteOrientation;
 		}
+		/**
+		 * Whether the owner of this component never moves, and so neither
+		 * does this component.
+		 */
+		bool isOwnerImmovable () const
+		{
+			return this->owner->getMass () < 0
+				|| this->owner->dryFrictionCoefficient >= IMMOVABLE_DRY_FRICTION;
+		}
 	};
 }
 
@@ -0,0 +1,11 @@
+#include "DemandDrivenSensor.h"
+#include "ExtendedWorld.h"
+
+using namespace Enki;
+
+bool DemandDrivenSensor::
+deferReading (const ExtendedWorld *world)
+{
+	this->stale = world != NULL && world->sensingOnDemand && !this->needsEveryStep ();
+	return this->stale;
+}
@@ -0,0 +1,76 @@
+#ifndef __DEMAND_DRIVEN_SENSOR_H
+#define __DEMAND_DRIVEN_SENSOR_H
+
+namespace Enki
+{
+	class ExtendedWorld;
+
+	/**
+	 * A sensor whose reading can be evaluated when it is read instead of
+	 * in every step of the world.
+	 *
+	 * <p> A sensor declares with {@code needsEveryStep()} whether its
+	 * reading integrates the steps, as a filter or a ring of samples
+	 * does, or is a point-in-time reading.  If the world senses on demand,
+	 * a point-in-time sensor only marks its reading as stale in each step.
+	 * The reading is evaluated the first time it is read afterwards, with
+	 * the sensor position of the last step and the state of the world at
+	 * that time.  Readings that nobody reads are never evaluated.
+	 *
+	 * <p> Readings evaluated on demand change shared caches of the world,
+	 * such as the light and air flow maps, so they must be read by the
+	 * simulation thread.
+	 */
+	class DemandDrivenSensor
+	{
+		/**
+		 * Whether the reading must be evaluated before it is read.
+		 */
+		mutable bool stale;
+	public:
+		DemandDrivenSensor ():
+			stale (false)
+		{
+		}
+		virtual ~DemandDrivenSensor ()
+		{
+		}
+		/**
+		 * Whether the reading of this sensor must be computed in every
+		 * step, because it depends on the previous steps.
+		 */
+		virtual bool needsEveryStep () const = 0;
+	protected:
+		/**
+		 * Defer the evaluation of the reading of this step until it is
+		 * read, if the world senses on demand and this sensor does not
+		 * need every step.  Otherwise the reading must be evaluated now.
+		 *
+		 * @return whether the evaluation was deferred.
+		 */
+		bool deferReading (const ExtendedWorld *world);
+		/**
+		 * Evaluate the reading if it is stale.  Called by the methods that
+		 * return the reading.
+		 */
+		void updateReading () const
+		{
+			if (this->stale) {
+				this->stale = false;
+				this->evaluateReading ();
+			}
+		}
+		/**
+		 * Compute the reading at the position of the last step.
+		 */
+		virtual void evaluateReading () const = 0;
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -9,13 +9,22 @@
 
 using namespace Enki;
 
+const char *Enki::
+objectKindName (ObjectKind kind)
+{
+	static const char *const names[] = {"None", "Wall", "Physical", "Bee", "Casu"};
+	return names [kind];
+}
+
 ExtendedRobot::
-ExtendedRobot ()
+ExtendedRobot (ObjectKind kind):
+	kind (kind)
 {
 }
 
 ExtendedRobot::
-ExtendedRobot (const ExtendedRobot& orig)
+ExtendedRobot (const ExtendedRobot& orig):
+	kind (orig.kind)
 {
 }
 
@@ -18,6 +18,22 @@ namespace Enki
 	class PhysicInteraction;
 	class PhysicSimulation;
 
+	/**
+	 * Kind of an object, as reported by object sensors.
+	 */
+	enum ObjectKind {
+		OBJECT_NONE,
+		OBJECT_WALL,
+		OBJECT_PHYSICAL,
+		OBJECT_BEE,
+		OBJECT_CASU
+	};
+
+	/**
+	 * Return the name of an object kind used in sensor messages.
+	 */
+	const char *objectKindName (ObjectKind kind);
+
 	/**
 	 * An extended robot that is capable of physical interactions besides
 	 * collisions.
@@ -31,15 +47,25 @@ namespace Enki
 	class ExtendedRobot: public virtual Robot
 	{
 	protected:
+		/**
+		 * Kind of this robot, set once at construction so that sensors
+		 * do not have to find out the class of a detected robot.
+		 */
+		const ObjectKind kind;
 		/**
 		 * Physical interactions that this robot is capable of.
 		 */
 		std::vector<PhysicInteraction *> physicInteractions;
 	public:
-		ExtendedRobot ();
+		ExtendedRobot (ObjectKind kind = OBJECT_PHYSICAL);
 		ExtendedRobot (const ExtendedRobot& orig);
 		virtual ~ExtendedRobot();
 
+		ObjectKind getKind () const
+		{
+			return this->kind;
+		}
+
 		void addPhysicInteraction (PhysicInteraction *pi)
 		{
 			this->physicInteractions.push_back (pi);
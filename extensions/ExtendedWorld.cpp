@@ -5,12 +5,19 @@
  * Created on 17 de Fevereiro de 2014, 15:13
  */
 
+#include <enki/Random.h>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
 #include "ExtendedWorld.h"
+#include "Trace.h"
 
 #include "interactions/VibrationSource.h"
 #include "interactions/AirPump.h"
 #include "interactions/NotSimulated.h"
 #include "interactions/WorldHeat.h"
+#include "interactions/WorldVibration.h"
+#include "interactions/WorldStimulus.h"
 
 using namespace Enki;
 
@@ -22,9 +29,15 @@ ExtendedWorld::ExtendedWorld (double width, double height,
 	World (width, height, wallsColor, groundTexture),
 	SKEW_MONITOR_RATE (skewMonitorRate),
 	SKEW_REPORT_THRESHOLD (skewReportThreshold + 1),
+	noiseGenerator (NULL),
 	worldHeat (NULL),
+	worldVibration (NULL),
+	worldStimulus (NULL),
+	worldRayCaster (NULL),
+	sensingOnDemand (false),
 	absoluteTime (0)
 {
+	this->initPerfCounters ();
 }
 
 ExtendedWorld::ExtendedWorld (double r, const Color& wallsColor,
@@ -34,9 +47,15 @@ ExtendedWorld::ExtendedWorld (double r, const Color& wallsColor,
 	World (r, wallsColor, groundTexture),
 	SKEW_MONITOR_RATE (skewMonitorRate),
 	SKEW_REPORT_THRESHOLD (skewReportThreshold + 1),
+	noiseGenerator (NULL),
 	worldHeat (NULL),
+	worldVibration (NULL),
+	worldStimulus (NULL),
+	worldRayCaster (NULL),
+	sensingOnDemand (false),
 	absoluteTime (0)
 {
+	this->initPerfCounters ();
 }
 
 ExtendedWorld::ExtendedWorld (
@@ -45,13 +64,29 @@ ExtendedWorld::ExtendedWorld (
 	World (),
 	SKEW_MONITOR_RATE (skewMonitorRate),
 	SKEW_REPORT_THRESHOLD (skewReportThreshold + 1),
+	noiseGenerator (NULL),
 	worldHeat (NULL),
+	worldVibration (NULL),
+	worldStimulus (NULL),
+	worldRayCaster (NULL),
+	sensingOnDemand (false),
 	absoluteTime (0)
 {
+	this->initPerfCounters ();
 }
 
 ExtendedWorld::~ExtendedWorld ()
 {
+	delete this->noiseGenerator;
+}
+
+void ExtendedWorld::initPerfCounters ()
+{
+	this->tickPhase = this->perfCounters.addPhase ("Tick");
+	this->physicSimulationsPhase = this->perfCounters.addPhase ("PhysicSimulations");
+	this->physicInteractionsPhase = this->perfCounters.addPhase ("PhysicInteractions");
+	this->enkiStepPhase = this->perfCounters.addPhase ("EnkiStep");
+	this->otherPhase = this->perfCounters.addPhase ("Other");
 }
 void ExtendedWorld::addObject (PhysicalObject *o)
 {
@@ -80,26 +115,43 @@ void ExtendedWorld::addPhysicSimulation (PhysicSimulation *pi)
 		// update world heat model
 		this->worldHeat = newWorldHeat;
 	}
+	WorldVibration *newWorldVibration = dynamic_cast<WorldVibration *> (pi);
+	if (newWorldVibration != NULL) {
+		this->worldVibration = newWorldVibration;
+	}
+	WorldStimulus *newWorldStimulus = dynamic_cast<WorldStimulus *> (pi);
+	if (newWorldStimulus != NULL) {
+		this->worldStimulus = newWorldStimulus;
+	}
 	this->physicSimulations.push_back (pi);
 	pi->initParameters (this);
 }
 
 void ExtendedWorld::step (double dt, unsigned physicsOversampling)
 {
+	ASSISI_TRACE_SCOPE ("ExtendedWorld::step");
+	const double tickStart = PerfCounters::now ();
+	this->perfCounters.begin (this->otherPhase);
 	const double overSampledDt = dt / (double) physicsOversampling;
 	for (unsigned po = 0; po < physicsOversampling; po++) {
 		// init physics interactions
 		for (PhysicSimulationsIterator pi = physicSimulations.begin (); pi != physicSimulations.end (); ++pi) {
+			this->perfCounters.begin (this->physicSimulationsPhase);
 			(*pi)->initStateComputing (overSampledDt);
+			this->perfCounters.begin (this->physicInteractionsPhase);
 			for (ExtendedRobotsIterator eri = extendedRobots.begin (); eri != extendedRobots.end (); ++eri) {
 				(*eri)->initPhysicInteractions (overSampledDt, *pi);
 				(*eri)->doPhysicInteractions (overSampledDt, *pi);
 				(*eri)->finalizePhysicInteractions (overSampledDt, *pi);
 			}
+			this->perfCounters.end ();
 			(*pi)->computeNextState (overSampledDt);
+			this->perfCounters.end ();
 		}
 	}
+	this->perfCounters.begin (this->enkiStepPhase);
 	World::step (dt, physicsOversampling);
+	this->perfCounters.end ();
 	absoluteTime += dt;
 	// check skewness
 	this->simulatedElapsedTime += dt;
@@ -120,10 +172,16 @@ void ExtendedWorld::step (double dt, unsigned physicsOversampling)
 		this->skewTimer.stop ();
 		this->skewTimer.start ();
 	}
+	this->perfCounters.end ();
+	this->perfCounters.add (this->tickPhase, PerfCounters::now () - tickStart);
+	this->perfCounters.endTick ();
 }
 
 double ExtendedWorld::getVibrationAmplitudeAt (const Point &position, double time) const
 {
+	if (this->worldVibration != NULL) {
+		return this->worldVibration->getVibrationAt (position);
+	}
 	double result = 0;
 	for (ObjectsIterator i = this->objects.begin (); i != this->objects.end (); ++i) {
 		PhysicalObject *po = (*i);
@@ -139,8 +197,28 @@ double ExtendedWorld::getVibrationAmplitudeAt (const Point &position, double tim
 	return result;
 }
 
+void ExtendedWorld::getVibrationAmplitudesAt (const std::vector<Point> &positions, double time, std::vector<double> &amplitudes) const
+{
+	amplitudes.assign (positions.size (), 0);
+	if (this->worldVibration != NULL) {
+		for (size_t i = 0; i < positions.size (); i++) {
+			amplitudes [i] = this->worldVibration->getVibrationAt (positions [i]);
+		}
+		return ;
+	}
+	for (ObjectsIterator i = this->objects.begin (); i != this->objects.end (); ++i) {
+		const VibrationSource *vibrationSource = dynamic_cast<const VibrationSource *> (*i);
+		if (vibrationSource != NULL) {
+			vibrationSource->addWavesAt (positions, time, amplitudes);
+		}
+	}
+}
+
 double ExtendedWorld::getAirFlowIntensityAt (const Point &position) const
 {
+	if (this->worldStimulus != NULL) {
+		return this->worldStimulus->getAirFlowAt (position).norm ();
+	}
 	Vector result (0, 0);
 	for (ObjectsIterator i = this->objects.begin (); i != this->objects.end (); ++i) {
 		PhysicalObject *po = (*i);
@@ -155,3 +233,29 @@ double ExtendedWorld::getAirFlowIntensityAt (const Point &position) const
 	}
 	return result.norm ();
 }
+
+void ExtendedWorld::setNoiseSeed (unsigned seed)
+{
+	delete this->noiseGenerator;
+	this->noiseGenerator = new boost::random::mt19937 (seed);
+}
+
+double ExtendedWorld::uniformNoise (World *world)
+{
+	ExtendedWorld *extendedWorld = dynamic_cast<ExtendedWorld *> (world);
+	if (extendedWorld == NULL || extendedWorld->noiseGenerator == NULL) {
+		return uniformRand ();
+	}
+	return boost::random::uniform_01<double> () (*extendedWorld->noiseGenerator);
+}
+
+double ExtendedWorld::gaussianNoise (World *world, double mean, double sigma)
+{
+	ExtendedWorld *extendedWorld = dynamic_cast<ExtendedWorld *> (world);
+	if (extendedWorld == NULL || extendedWorld->noiseGenerator == NULL) {
+		return gaussianRand (mean, sigma);
+	}
+	// scaled instead of passed to the distribution, since sensors may
+	// give a negative standard deviation, as gaussianRand () allows
+	return mean + sigma * boost::random::normal_distribution<double> () (*extendedWorld->noiseGenerator);
+}
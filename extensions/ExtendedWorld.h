@@ -11,16 +11,21 @@
 #define __EXTENDED_WORLD_H
 
 #include <enki/PhysicalEngine.h>
+#include <boost/random/mersenne_twister.hpp>
 #include <boost/timer/timer.hpp>
 
 #include "PhysicSimulation.h"
 #include "ExtendedRobot.h"
+#include "PerfCounters.h"
 
 namespace Enki
 {
 	class ExtendedRobot;
 	class PhysicSimulation;
 	class WorldHeat;
+	class WorldVibration;
+	class WorldStimulus;
+	class WorldRayCaster;
 	/**
 	 * Extends world class with other physic interactions besides collision
 	 * detection.  Robots can also interact with these physic simulations by
@@ -49,6 +54,11 @@ namespace Enki
 		 * Timer used to monitor used to measure simulation skewness.
 		 */
 		boost::timer::cpu_timer skewTimer;
+		/**
+		 * Generator of the sensor and actuator noise, or {@code NULL} if
+		 * the noise is drawn from the global Enki generator.
+		 */
+		boost::random::mt19937 *noiseGenerator;
 	public:
 		typedef std::vector<PhysicSimulation *> PhysicSimulations;
 		typedef PhysicSimulations::iterator PhysicSimulationsIterator;
@@ -58,6 +68,32 @@ namespace Enki
 		 * Current heat model used in the world.
 		 */
 		WorldHeat *worldHeat;
+		/**
+		 * Vibration field used in the world, or {@code NULL} if sensors
+		 * evaluate each vibration source.
+		 */
+		WorldVibration *worldVibration;
+		/**
+		 * Light and air flow maps used in the world, or {@code NULL} if
+		 * sensors evaluate each light source and air pump.
+		 */
+		WorldStimulus *worldStimulus;
+		/**
+		 * Casts the rays of all object sensors at once, or {@code NULL}
+		 * if each object sensor tests the objects presented by Enki.
+		 */
+		WorldRayCaster *worldRayCaster;
+		/**
+		 * Whether sensors that give a point-in-time reading are evaluated
+		 * when they are read instead of in every step.
+		 */
+		bool sensingOnDemand;
+		/**
+		 * Wall time spent in the phases of each step.  Subclasses can add
+		 * their own phases; phases timed inside {@code World::step()} are
+		 * not counted in the {@code EnkiStep} phase.
+		 */
+		PerfCounters perfCounters;
 
 	protected:
 		typedef std::set<ExtendedRobot *> ExtendedRobots;
@@ -70,6 +106,20 @@ namespace Enki
 		 * parameter {@code dt} of method {@code step()}.
 		 */
 		double absoluteTime;
+	private:
+		/**
+		 * Phases of {@code step()}.  The tick phase is the total time of
+		 * the step, the other phases are parts of it.
+		 */
+		int tickPhase;
+		int physicSimulationsPhase;
+		int physicInteractionsPhase;
+		int enkiStepPhase;
+		int otherPhase;
+		/**
+		 * Register the phases of {@code step()}.
+		 */
+		void initPerfCounters ();
 	public:
 		/**
 		 * Construct a world with square walls, takes width and height of the
@@ -122,15 +172,33 @@ namespace Enki
 		 * run per step, as usual collisions require a more precise
 		 * simulation than the sensor-motor loop frequency. */
 		virtual void step (double dt, unsigned physicsOversampling = 1);
+		/**
+		 * Whether {@code step()} can be called without blocking.  A
+		 * viewer that steps the world from its GUI thread skips a timer
+		 * tick when this returns false.
+		 */
+		virtual bool isReadyToStep ()
+		{
+			return true;
+		}
 
 		/**
 		 * Return the vibration amplitude sensed at the given position and
-		 * time.
+		 * time.  If the world has a vibration field, the value is looked up
+		 * in the field, which is computed at the current time.
 		 */
 		virtual double getVibrationAmplitudeAt (const Point &position, double time) const;
+		/**
+		 * Compute the vibration amplitude sensed at each of the given
+		 * positions, at the given time.  Each vibration source adds its
+		 * waves to all positions at once, with a fast approximation of the
+		 * sine, see {@code VibrationSource::addWavesAt()}.
+		 */
+		virtual void getVibrationAmplitudesAt (const std::vector<Point> &positions, double time, std::vector<double> &amplitudes) const;
 
 		/**
-		 * Return the air flow intensity at the given position.
+		 * Return the air flow intensity at the given position.  If the world
+		 * has an air flow map, the value is read from the map.
 		 */
 		virtual double getAirFlowIntensityAt (const Point &position) const;
 		// /**
@@ -143,6 +211,25 @@ namespace Enki
 		{
 			return this->absoluteTime;
 		}
+		/**
+		 * Draw the sensor and actuator noise of this world from a
+		 * generator of its own, seeded with the given value.  Worlds
+		 * stepped by concurrent threads must each have one, as the
+		 * global Enki generator is not thread safe.
+		 */
+		void setNoiseSeed (unsigned seed);
+		/**
+		 * Return a uniform random number in [0, 1) drawn from the noise
+		 * generator of the given world.  The global Enki generator is
+		 * used if the world is not an extended world or has no noise
+		 * generator of its own.
+		 */
+		static double uniformNoise (World *world);
+		/**
+		 * Return a Gaussian random number with the given mean and
+		 * standard deviation, drawn as in {@code uniformNoise()}.
+		 */
+		static double gaussianNoise (World *world, double mean, double sigma);
 	private:
 
 	};
@@ -0,0 +1,90 @@
+/*
+ * File:   PerfCounters.cpp
+ */
+
+#include <time.h>
+
+#include <algorithm>
+
+#include "PerfCounters.h"
+
+using namespace Enki;
+
+PerfCounters::PerfCounters (unsigned int windowSize):
+	windowSize (windowSize),
+	ticks (0)
+{
+}
+
+int PerfCounters::addPhase (const std::string &name)
+{
+	Phase phase;
+	phase.name = name;
+	phase.current = 0;
+	phase.window.reserve (this->windowSize);
+	this->phases.push_back (phase);
+	return this->phases.size () - 1;
+}
+
+void PerfCounters::endTick ()
+{
+	unsigned int slot = this->ticks % this->windowSize;
+	for (std::vector<Phase>::iterator phase = this->phases.begin (); phase != this->phases.end (); ++phase) {
+		if (phase->window.size () < this->windowSize) {
+			phase->window.push_back (phase->current);
+		}
+		else {
+			phase->window [slot] = phase->current;
+		}
+		phase->current = 0;
+	}
+	this->ticks++;
+}
+
+/**
+ * Value at the given quantile of a sorted vector.
+ */
+static double quantile (const std::vector<double> &sorted, double q)
+{
+	std::size_t index = (std::size_t) (q * (sorted.size () - 1) + 0.5);
+	return sorted [index];
+}
+
+void PerfCounters::summarize (std::vector<Summary> &result) const
+{
+	std::vector<double> sorted;
+	for (std::vector<Phase>::const_iterator phase = this->phases.begin (); phase != this->phases.end (); ++phase) {
+		Summary summary;
+		summary.name = phase->name;
+		if (phase->window.empty ()) {
+			summary.mean = summary.p50 = summary.p95 = summary.p99 = summary.max = 0;
+		}
+		else {
+			sorted = phase->window;
+			std::sort (sorted.begin (), sorted.end ());
+			double sum = 0;
+			for (std::size_t i = 0; i < sorted.size (); i++) {
+				sum += sorted [i];
+			}
+			summary.mean = sum / sorted.size ();
+			summary.p50 = quantile (sorted, 0.50);
+			summary.p95 = quantile (sorted, 0.95);
+			summary.p99 = quantile (sorted, 0.99);
+			summary.max = sorted.back ();
+		}
+		result.push_back (summary);
+	}
+}
+
+double PerfCounters::now ()
+{
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,144 @@
+/*
+ * File:   PerfCounters.h
+ *
+ * Per tick timing of the simulation phases.
+ */
+
+#ifndef __PERF_COUNTERS_H
+#define __PERF_COUNTERS_H
+
+#include <string>
+#include <vector>
+
+namespace Enki
+{
+	/**
+	 * Measures the wall time spent in the phases of each simulation tick,
+	 * and keeps the timings of the last ticks to compute rolling
+	 * statistics.
+	 *
+	 * <p> Phases are registered with {@code addPhase()} and measured
+	 * between calls to {@code begin()} and {@code end()}.  Phases can be
+	 * nested; the time of a nested phase is not counted in the enclosing
+	 * phase, so the phase times of a tick add up to the tick time.
+	 * A phase can run several times in a tick, its times are added.
+	 *
+	 * <p> An instance must only be used by one thread.
+	 */
+	class PerfCounters
+	{
+	public:
+		/**
+		 * Rolling statistics of a phase, in seconds.
+		 */
+		struct Summary {
+			std::string name;
+			double mean;
+			double p50;
+			double p95;
+			double p99;
+			double max;
+		};
+	private:
+		struct Phase {
+			std::string name;
+			/**
+			 * Time spent in this phase in the current tick.
+			 */
+			double current;
+			/**
+			 * Times of the last ticks, used as a ring buffer.
+			 */
+			std::vector<double> window;
+		};
+		struct Frame {
+			int phase;
+			double start;
+			/**
+			 * Time spent in phases nested in this one.
+			 */
+			double nested;
+		};
+		/**
+		 * Number of ticks in the rolling window.
+		 */
+		const unsigned int windowSize;
+		std::vector<Phase> phases;
+		std::vector<Frame> stack;
+		/**
+		 * Number of ticks ended.
+		 */
+		unsigned long ticks;
+	public:
+		/**
+		 * Create counters that keep the timings of the last {@code
+		 * windowSize} ticks.
+		 */
+		PerfCounters (unsigned int windowSize = 1000);
+		/**
+		 * Register a phase.
+		 *
+		 * @return the phase identifier.
+		 */
+		int addPhase (const std::string &name);
+		/**
+		 * Start timing a phase.
+		 */
+		void begin (int phase)
+		{
+			Frame frame;
+			frame.phase = phase;
+			frame.start = now ();
+			frame.nested = 0;
+			this->stack.push_back (frame);
+		}
+		/**
+		 * Stop timing the innermost phase.
+		 */
+		void end ()
+		{
+			const Frame &frame = this->stack.back ();
+			double elapsed = now () - frame.start;
+			this->phases [frame.phase].current += elapsed - frame.nested;
+			this->stack.pop_back ();
+			if (!this->stack.empty ()) {
+				this->stack.back ().nested += elapsed;
+			}
+		}
+		/**
+		 * Add a time measured elsewhere to a phase.
+		 */
+		void add (int phase, double seconds)
+		{
+			this->phases [phase].current += seconds;
+		}
+		/**
+		 * Move the times of the current tick into the rolling window.
+		 */
+		void endTick ();
+		/**
+		 * Number of ticks ended so far.
+		 */
+		unsigned long getTicks () const
+		{
+			return this->ticks;
+		}
+		/**
+		 * Compute the rolling statistics of all phases and append them to
+		 * the given vector.
+		 */
+		void summarize (std::vector<Summary> &result) const;
+		/**
+		 * Monotonic wall clock, in seconds.
+		 */
+		static double now ();
+	};
+}
+
+#endif	/* __PERF_COUNTERS_H */
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
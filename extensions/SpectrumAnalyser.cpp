@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+
+#include <boost/math/constants/constants.hpp>
+
+#include "SpectrumAnalyser.h"
+
+using namespace Enki;
+
+static unsigned powerOfTwo (unsigned value)
+{
+	unsigned result = 4;
+	while (result < value) {
+		result *= 2;
+	}
+	return result;
+}
+
+SpectrumAnalyser::
+SpectrumAnalyser (unsigned window):
+	window (powerOfTwo (window)),
+	hann (this->window),
+	hannSum (0),
+	twiddles (this->window / 4),
+	realTwiddles (this->window / 2),
+	reversed (this->window / 2),
+	samples (this->window),
+	sequence (this->window / 2),
+	magnitude (this->window / 2 + 1)
+{
+	const double pi = boost::math::constants::pi<double> ();
+	const unsigned half = this->window / 2;
+	for (unsigned i = 0; i < this->window; i++) {
+		this->hann [i] = 0.5 - 0.5 * std::cos (2 * pi * i / this->window);
+		this->hannSum += this->hann [i];
+	}
+	for (unsigned k = 0; k < half / 2; k++) {
+		this->twiddles [k] = std::polar (1.0, -2 * pi * k / half);
+	}
+	for (unsigned k = 0; k < half; k++) {
+		this->realTwiddles [k] = std::polar (1.0, -2 * pi * k / this->window);
+	}
+	unsigned bits = 0;
+	while ((1u << bits) < half) {
+		bits++;
+	}
+	for (unsigned i = 0; i < half; i++) {
+		unsigned r = 0;
+		for (unsigned b = 0; b < bits; b++) {
+			if (i & (1u << b)) {
+				r |= 1u << (bits - 1 - b);
+			}
+		}
+		this->reversed [i] = r;
+	}
+}
+
+void SpectrumAnalyser::
+analyse (const double *first, unsigned firstSize, const double *second, unsigned secondSize, double sampleRate, unsigned peaks, Features &features)
+{
+	const unsigned count = std::min (firstSize + secondSize, this->window);
+	std::copy (first, first + std::min (firstSize, count), this->samples.begin ());
+	if (firstSize < count) {
+		std::copy (second, second + (count - firstSize), this->samples.begin () + firstSize);
+	}
+	// amplitude statistics
+	features.samples = count;
+	features.sampleRate = sampleRate;
+	features.peaks.clear ();
+	double sum = 0, sumSquares = 0, peak = 0;
+	for (unsigned i = 0; i < count; i++) {
+		const double x = this->samples [i];
+		sum += x;
+		sumSquares += x * x;
+		peak = std::max (peak, std::fabs (x));
+	}
+	features.mean = count > 0 ? sum / count : 0;
+	features.rms = count > 0 ? std::sqrt (sumSquares / count) : 0;
+	features.peak = peak;
+	double variance = 0;
+	for (unsigned i = 0; i < count; i++) {
+		const double d = this->samples [i] - features.mean;
+		variance += d * d;
+	}
+	features.standardDeviation = count > 1 ? std::sqrt (variance / (count - 1)) : 0;
+	if (count < this->window || peaks == 0) {
+		return ;
+	}
+	// spectrum of the real signal, from the FFT of the even samples as the
+	// real part and the odd samples as the imaginary part
+	const unsigned half = this->window / 2;
+	for (unsigned n = 0; n < half; n++) {
+		this->sequence [n] = std::complex<double> (
+			(this->samples [2 * n] - features.mean) * this->hann [2 * n],
+			(this->samples [2 * n + 1] - features.mean) * this->hann [2 * n + 1]);
+	}
+	this->fft ();
+	const std::complex<double> i (0, 1);
+	for (unsigned k = 0; k <= half; k++) {
+		const std::complex<double> z = this->sequence [k % half];
+		const std::complex<double> zc = std::conj (this->sequence [(half - k) % half]);
+		const std::complex<double> even = (z + zc) * 0.5;
+		const std::complex<double> odd = (z - zc) * (-0.5 * i);
+		const std::complex<double> twiddle = k < half ? this->realTwiddles [k] : std::complex<double> (-1, 0);
+		this->magnitude [k] = std::abs (even + twiddle * odd);
+	}
+	// largest local maxima, strongest first
+	for (unsigned k = 1; k < half; k++) {
+		const double a = this->magnitude [k - 1];
+		const double b = this->magnitude [k];
+		const double c = this->magnitude [k + 1];
+		if (b <= a || b < c) {
+			continue;
+		}
+		const double denominator = a - 2 * b + c;
+		const double delta = denominator != 0 ? 0.5 * (a - c) / denominator : 0;
+		Peak candidate;
+		candidate.frequency = (k + delta) * sampleRate / this->window;
+		candidate.amplitude = 2 * (b - 0.25 * (a - c) * delta) / this->hannSum;
+		if (features.peaks.size () < peaks) {
+			features.peaks.push_back (candidate);
+		}
+		else if (candidate.amplitude > features.peaks.back ().amplitude) {
+			features.peaks.back () = candidate;
+		}
+		else {
+			continue;
+		}
+		for (size_t j = features.peaks.size () - 1; j > 0 && features.peaks [j].amplitude > features.peaks [j - 1].amplitude; j--) {
+			std::swap (features.peaks [j], features.peaks [j - 1]);
+		}
+	}
+}
+
+void SpectrumAnalyser::
+fft ()
+{
+	const unsigned n = this->window / 2;
+	for (unsigned i = 0; i < n; i++) {
+		if (i < this->reversed [i]) {
+			std::swap (this->sequence [i], this->sequence [this->reversed [i]]);
+		}
+	}
+	for (unsigned size = 2; size <= n; size *= 2) {
+		const unsigned half = size / 2;
+		const unsigned step = n / size;
+		for (unsigned start = 0; start < n; start += size) {
+			for (unsigned j = 0; j < half; j++) {
+				const std::complex<double> t = this->twiddles [j * step] * this->sequence [start + j + half];
+				const std::complex<double> u = this->sequence [start + j];
+				this->sequence [start + j] = u + t;
+				this->sequence [start + j + half] = u - t;
+			}
+		}
+	}
+}
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,142 @@
+#ifndef __SPECTRUM_ANALYSER_H
+#define __SPECTRUM_ANALYSER_H
+
+#include <complex>
+#include <vector>
+
+namespace Enki
+{
+	/**
+	 * Computes spectral features and amplitude statistics of a window of
+	 * samples of a real signal.
+	 *
+	 * <p> The spectrum is computed by a radix-2 real FFT: the window is
+	 * packed into a complex sequence of half its size, transformed, and
+	 * separated into the spectrum of the real signal.  Samples are
+	 * multiplied by a Hann window after the mean is removed.  Dominant
+	 * frequencies are the largest local maxima of the magnitude
+	 * spectrum, refined by parabolic interpolation between bins.
+	 *
+	 * <p> All buffers are allocated by the constructor, so an analysis
+	 * does not allocate memory once the vectors of the features have
+	 * reached their size.
+	 */
+	class SpectrumAnalyser
+	{
+	public:
+		/**
+		 * A dominant frequency of the signal.
+		 */
+		struct Peak
+		{
+			/**
+			 * Frequency, in Hz.
+			 */
+			double frequency;
+			/**
+			 * Amplitude of a sinusoid with this frequency.
+			 */
+			double amplitude;
+		};
+		/**
+		 * Result of an analysis.
+		 */
+		struct Features
+		{
+			/**
+			 * Dominant frequencies, strongest first.  Empty until the
+			 * window is full.
+			 */
+			std::vector<Peak> peaks;
+			double mean;
+			double standardDeviation;
+			double rms;
+			/**
+			 * Largest absolute value of the samples.
+			 */
+			double peak;
+			/**
+			 * Number of samples analysed.
+			 */
+			unsigned samples;
+			/**
+			 * Sample rate, in Hz.
+			 */
+			double sampleRate;
+		};
+	private:
+		/**
+		 * Number of samples of a window, a power of two.
+		 */
+		const unsigned window;
+		/**
+		 * Hann window coefficients, and their sum.
+		 */
+		std::vector<double> hann;
+		double hannSum;
+		/**
+		 * Twiddle factors of the complex FFT of half the window size.
+		 */
+		std::vector<std::complex<double> > twiddles;
+		/**
+		 * Twiddle factors used to separate the spectrum of the real
+		 * signal.
+		 */
+		std::vector<std::complex<double> > realTwiddles;
+		/**
+		 * Bit reversed index of each element of the complex sequence.
+		 */
+		std::vector<unsigned> reversed;
+		/**
+		 * Samples in time order, then the complex sequence.
+		 */
+		std::vector<double> samples;
+		std::vector<std::complex<double> > sequence;
+		/**
+		 * Magnitude of each frequency bin, from 0 to half the window.
+		 */
+		std::vector<double> magnitude;
+	public:
+		/**
+		 * Create an analyser of windows of the given size.
+		 *
+		 * @param window Number of samples, rounded up to a power of two,
+		 * and at least 4.
+		 */
+		SpectrumAnalyser (unsigned window);
+		unsigned getWindow () const
+		{
+			return this->window;
+		}
+		/**
+		 * Magnitude of each frequency bin, from 0 to half the window, of
+		 * the last analysis that computed the spectrum.
+		 */
+		const std::vector<double> &getMagnitude () const
+		{
+			return this->magnitude;
+		}
+		/**
+		 * Analyse the samples of a ring buffer.  The oldest samples are in
+		 * range {@code [first, first + firstSize)}, followed by range
+		 * {@code [second, second + secondSize)}.  The spectrum is only
+		 * computed if there is a full window of samples.
+		 *
+		 * @param peaks Maximum number of dominant frequencies.
+		 */
+		void analyse (const double *first, unsigned firstSize, const double *second, unsigned secondSize, double sampleRate, unsigned peaks, Features &features);
+	private:
+		/**
+		 * In-place radix-2 decimation in time FFT of {@code sequence}.
+		 */
+		void fft ();
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,111 @@
+#ifndef __STATIC_COUPLINGS_H
+#define __STATIC_COUPLINGS_H
+
+#include <algorithm>
+#include <vector>
+
+#include <enki/PhysicalEngine.h>
+
+namespace Enki
+{
+	/**
+	 * Cache of the couplings between a sensor and the sources it senses,
+	 * for sensors and sources that do not move.  A coupling holds the
+	 * part of a sensed value that only depends on the geometry, such as
+	 * attenuation with distance, so that each step only the part that
+	 * depends on the source state is computed.
+	 *
+	 * <p> Enki presents the objects to a local interaction in the same
+	 * order every step, so the couplings are kept in that order and the
+	 * next coupling is normally the one that is looked up.  A coupling is
+	 * computed again if the sensor or the source position changed.
+	 * Couplings of sources that were not sensed in a step are dropped
+	 * in the next one.
+	 *
+	 * @param T Type of the coupling.
+	 */
+	template<class T>
+	class StaticCouplings
+	{
+		struct Entry
+		{
+			const PhysicalObject *source;
+			Point sourcePosition;
+			Point sensorPosition;
+			T coupling;
+		};
+		/**
+		 * Couplings in the order the sources were sensed.
+		 */
+		std::vector<Entry> entries;
+		/**
+		 * Index of the coupling of the next source.
+		 */
+		size_t next;
+	public:
+		StaticCouplings ():
+			next (0)
+		{
+		}
+		/**
+		 * Start a new step.  Called when the sensor is initialised.
+		 */
+		void rewind ()
+		{
+			this->entries.resize (this->next);
+			this->next = 0;
+		}
+		/**
+		 * Return the coupling with the given source, or {@code NULL} if it
+		 * must be computed and stored with method {@code store()}.
+		 */
+		const T *find (const PhysicalObject *source, const Point &sourcePosition, const Point &sensorPosition)
+		{
+			if (this->next == this->entries.size () || this->entries [this->next].source != source) {
+				// the sources changed, look for this one further on
+				size_t i = this->next + 1;
+				while (i < this->entries.size () && this->entries [i].source != source) {
+					i++;
+				}
+				if (i >= this->entries.size ()) {
+					return NULL;
+				}
+				std::swap (this->entries [i], this->entries [this->next]);
+			}
+			const Entry &entry = this->entries [this->next];
+			if (entry.sourcePosition.x != sourcePosition.x
+			    || entry.sourcePosition.y != sourcePosition.y
+			    || entry.sensorPosition.x != sensorPosition.x
+			    || entry.sensorPosition.y != sensorPosition.y) {
+				return NULL;
+			}
+			this->next++;
+			return &entry.coupling;
+		}
+		/**
+		 * Store the coupling with a source that was not found by method
+		 * {@code find()}.
+		 */
+		const T *store (const PhysicalObject *source, const Point &sourcePosition, const Point &sensorPosition, const T &coupling)
+		{
+			if (this->next == this->entries.size () || this->entries [this->next].source != source) {
+				this->entries.insert (this->entries.begin () + this->next, Entry ());
+			}
+			Entry &entry = this->entries [this->next];
+			entry.source = source;
+			entry.sourcePosition = sourcePosition;
+			entry.sensorPosition = sensorPosition;
+			entry.coupling = coupling;
+			this->next++;
+			return &entry.coupling;
+		}
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
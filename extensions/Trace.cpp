@@ -0,0 +1,109 @@
+/*
+ * File:   Trace.cpp
+ */
+
+#include "Trace.h"
+
+#ifdef ASSISI_TRACE
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <fstream>
+#include <iomanip>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+using namespace Enki;
+
+/**
+ * Buffers of all the threads that recorded events.  Buffers are never
+ * deleted, so they can be flushed after their thread has finished.
+ */
+static std::vector<Trace::Buffer *> buffers;
+static boost::mutex buffersMutex;
+
+/**
+ * Buffer of the current thread.
+ */
+static __thread Trace::Buffer *currentBuffer = NULL;
+
+void Trace::record (const char *name, char phase)
+{
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	Buffer *buffer = threadBuffer ();
+	unsigned long head = buffer->head.load (boost::memory_order_relaxed);
+	// the previous head is visible to flush () before the slot changes
+	boost::atomic_thread_fence (boost::memory_order_release);
+	Event &event = buffer->events [head % BUFFER_SIZE];
+	event.name = name;
+	event.timestamp = (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+	event.phase = phase;
+	// publish the event to flush ()
+	buffer->head.store (head + 1, boost::memory_order_release);
+}
+
+Trace::Buffer *Trace::threadBuffer ()
+{
+	if (currentBuffer == NULL) {
+		Buffer *buffer = new Buffer;
+		buffer->threadId = syscall (SYS_gettid);
+		buffer->events.resize (BUFFER_SIZE);
+		buffer->head = 0;
+		boost::lock_guard<boost::mutex> lock (buffersMutex);
+		buffers.push_back (buffer);
+		currentBuffer = buffer;
+	}
+	return currentBuffer;
+}
+
+bool Trace::flush (const std::string &filename)
+{
+	std::ofstream os (filename.c_str ());
+	if (!os.is_open ()) {
+		return false;
+	}
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	os << std::fixed << std::setprecision (3);
+	long pid = getpid ();
+	bool first = true;
+	boost::lock_guard<boost::mutex> lock (buffersMutex);
+	for (std::vector<Buffer *>::const_iterator i = buffers.begin (); i != buffers.end (); ++i) {
+		const Buffer *buffer = *i;
+		unsigned long head = buffer->head.load (boost::memory_order_acquire);
+		unsigned long start = head > BUFFER_SIZE ? head - BUFFER_SIZE : 0;
+		for (unsigned long e = start; e < head; e++) {
+			const Event event = buffer->events [e % BUFFER_SIZE];
+			// The owner thread keeps recording.  Once it has reached event
+			// e + BUFFER_SIZE, it may have been writing the slot we copied,
+			// so the copy may be torn and is left out.
+			boost::atomic_thread_fence (boost::memory_order_acquire);
+			if (e + BUFFER_SIZE <= buffer->head.load (boost::memory_order_relaxed)) {
+				continue;
+			}
+			if (!first) {
+				os << ",\n";
+			}
+			first = false;
+			os << "{\"name\":\"" << event.name
+			   << "\",\"ph\":\"" << event.phase
+			   << "\",\"ts\":" << event.timestamp / 1000.0
+			   << ",\"pid\":" << pid
+			   << ",\"tid\":" << buffer->threadId
+			   << "}";
+		}
+	}
+	os << "\n]}\n";
+	return os.good ();
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,141 @@
+/*
+ * File:   Trace.h
+ *
+ * Optional recording of trace events in the Chrome trace event format.
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+/**
+ * Trace events are only recorded when the code is compiled with symbol
+ * {@code ASSISI_TRACE} defined (cmake option ASSISI_TRACE).  Otherwise the
+ * macros below expand to nothing and do not evaluate their arguments.
+ *
+ * <p> Event names must remain valid until the trace is flushed, string
+ * literals are the common case.
+ *
+ * <p> Use:
+ * <pre>
+ * void f ()
+ * {
+ *    ASSISI_TRACE_SCOPE ("f");
+ *    ...
+ * }
+ * </pre>
+ */
+#ifdef ASSISI_TRACE
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+
+namespace Enki
+{
+	/**
+	 * Records begin and end events in per-thread ring buffers, and writes
+	 * them to a JSON file that can be loaded in chrome://tracing or
+	 * Perfetto.
+	 *
+	 * <p> Each thread writes to its own buffer, so recording an event
+	 * takes no lock.  When a buffer is full the oldest events are
+	 * overwritten.
+	 */
+	class Trace
+	{
+	public:
+		/**
+		 * Number of events kept per thread.
+		 */
+		static const unsigned int BUFFER_SIZE = 1 << 16;
+		/**
+		 * Record the beginning of an event in the calling thread.
+		 */
+		static void begin (const char *name)
+		{
+			record (name, 'B');
+		}
+		/**
+		 * Record the end of an event in the calling thread.
+		 */
+		static void end (const char *name)
+		{
+			record (name, 'E');
+		}
+		/**
+		 * Write the events recorded so far by all threads.  Threads may
+		 * keep recording: the oldest events of a full buffer that are
+		 * overwritten while it is written are left out.
+		 *
+		 * @return false if the file could not be written.
+		 */
+		static bool flush (const std::string &filename);
+		/**
+		 * Records an event lasting until the end of the enclosing scope.
+		 */
+		class Scope
+		{
+			const char *name;
+		public:
+			Scope (const char *name):
+				name (name)
+			{
+				Trace::begin (name);
+			}
+			~Scope ()
+			{
+				Trace::end (this->name);
+			}
+		};
+		/**
+		 * Recorded event.  Only used by the implementation.
+		 */
+		struct Event {
+			const char *name;
+			uint64_t timestamp;
+			char phase;
+		};
+		struct Buffer {
+			long threadId;
+			std::vector<Event> events;
+			/**
+			 * Number of events written.  Only the owner thread writes it.
+			 */
+			boost::atomic<unsigned long> head;
+		};
+	private:
+		static void record (const char *name, char phase);
+		/**
+		 * Buffer of the calling thread, created on first use.
+		 */
+		static Buffer *threadBuffer ();
+	};
+}
+
+#define ASSISI_TRACE_CONCAT2(a, b) a ## b
+#define ASSISI_TRACE_CONCAT(a, b) ASSISI_TRACE_CONCAT2 (a, b)
+
+#define ASSISI_TRACE_SCOPE(name) Enki::Trace::Scope ASSISI_TRACE_CONCAT (traceScope, __LINE__) (name)
+#define ASSISI_TRACE_BEGIN(name) Enki::Trace::begin (name)
+#define ASSISI_TRACE_END(name) Enki::Trace::end (name)
+#define ASSISI_TRACE_FLUSH(filename) Enki::Trace::flush (filename)
+
+#else
+
+#define ASSISI_TRACE_SCOPE(name) do { } while (0)
+#define ASSISI_TRACE_BEGIN(name) do { } while (0)
+#define ASSISI_TRACE_END(name) do { } while (0)
+#define ASSISI_TRACE_FLUSH(filename) false
+
+#endif
+
+#endif	/* __TRACE_H */
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -10,6 +10,7 @@
 
 #include "playground/WorldExt.h"
 #include "robots/Bee.h"
+#include "robots/BeeSwarm.h"
 #include "handlers/BeeHandler.h"
 
 // Protobuf message headers
@@ -29,156 +30,386 @@ using namespace AssisiMsg;
 namespace Enki
 {
 
+    const char* const BeeHandler::DEVICE_NAMES[BeeHandler::DEVICE_COUNT] =
+    {
+        "Object", "Base", "Light", "Temp", "Color", "Airflow"
+    };
+
+    const char* const BeeHandler::COMMAND_NAMES[BeeHandler::COMMAND_COUNT] =
+    {
+        "Vel", "Set"
+    };
+
+// -----------------------------------------------------------------------------
+
+    BeeHandler::BeeHandler(double body_length, double body_width, double body_height,
+                           double body_mass, double max_speed,
+                           BeeSwarm* swarm) :
+        swarm_(swarm),
+        body_length_(body_length), body_width_(body_width), body_height_(body_height),
+        body_mass_(body_mass), max_speed_(max_speed),
+        prefab_hull_(Bee::makeHull(body_length, body_width, body_height))
+    {
+        for (int d = 0; d < DEVICE_COUNT; d++)
+        {
+            schedule_.addDevice(DEVICE_NAMES[d]);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
     /* virtual */
-    string BeeHandler::createObject(const std::string& data, 
-                                     WorldExt* world)
+    bool BeeHandler::createObject(const Spawn& spawn_msg, 
+                                  ObjectHandle handle,
+                                  WorldExt* world)
     {
-        string name = "";
-        Spawn spawn_msg;     
-        assert(spawn_msg.ParseFromString(data));
-        if (bees_.count(spawn_msg.name()) < 1)
+        if (bees_.get(handle) == 0 && swarm_bees_.get(handle) == 0)
         {
-            name = spawn_msg.name();
             Point pos(spawn_msg.pose().position().x(),
                       spawn_msg.pose().position().y());
             double yaw(spawn_msg.pose().orientation().z());
-            bees_[name] = new Bee(body_length_,body_width_,body_height_,
-                                  body_mass_, max_speed_);
-            bees_[name]->pos = pos;
-            bees_[name]->angle = yaw;
-            world->addObject(bees_[name]);
+            if (swarm_)
+            {
+                swarm_->addBee(pos, yaw);
+                swarm_bees_.add(handle, spawn_msg.name(), swarm_);
+                schedule_.addObject(handle);
+                return true;
+            }
+            Bee* bee = new Bee(body_length_,body_width_,body_height_,
+                               body_mass_, max_speed_, &prefab_hull_);
+            bee->pos = pos;
+            bee->angle = yaw;
+            bees_.add(handle, spawn_msg.name(), bee);
+            schedule_.addObject(handle);
+            world->addObject(bee);
+            return true;
         }
         else
         {
             cerr << "Bee "<< spawn_msg.name() << " already exists." << endl;
+            return false;
         }
-        return name;
     }
 
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    int BeeHandler::handleIncoming(const std::string& name,
-                                    const std::string& device,
-                                    const std::string& command,
-                                    const std::string& data)
+    bool BeeHandler::parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const
     {
-        int count = 0;
-        if (device == "Base")
+        parsed.device = lookup(DEVICE_NAMES, DEVICE_COUNT, device);
+        parsed.command = lookup(COMMAND_NAMES, COMMAND_COUNT, command);
+        if (parsed.device == BASE && parsed.command == VEL)
         {
-            if (command == "Vel")
-            {
-                DiffDrive drive;
-                assert(drive.ParseFromString(data));
-                bees_[name]->leftSpeed = drive.vel_left();
-                bees_[name]->rightSpeed = drive.vel_right();
-                count++;
-            }
-            else
+            return parsePayload<DiffDrive>(data, parsed.payload);
+        }
+        else if (parsed.device == COLOR && parsed.command == SET)
+        {
+            return parsePayload<ColorStamped>(data, parsed.payload);
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int BeeHandler::handleIncoming(const Command& command)
+    {
+        Bee* bee = bees_.get(command.handle);
+        if (bee == 0)
+        {
+            // a bee of the swarm
+            std::size_t i = swarm_bees_.position(command.handle);
+            switch (command.device)
             {
-                cerr << "Unknown command for " << name << "/" << device << endl;
-                return 0;
+            case BASE:
+                {
+                    const DiffDrive& drive = static_cast<const DiffDrive&>(*command.payload);
+                    swarm_->left_speed[i] = drive.vel_left();
+                    swarm_->right_speed[i] = drive.vel_right();
+                }
+                return 1;
+            case COLOR:
+                {
+                    const ColorStamped& color_msg = static_cast<const ColorStamped&>(*command.payload);
+                    swarm_->color_r[i] = color_msg.color().red();
+                    swarm_->color_g[i] = color_msg.color().green();
+                    swarm_->color_b[i] = color_msg.color().blue();
+                }
+                return 1;
             }
+            return 0;
         }
-        else if (device == "Color")
+        switch (command.device)
         {
-            if (command == "Set")
+        case BASE:
+            {
+                const DiffDrive& drive = static_cast<const DiffDrive&>(*command.payload);
+                bee->leftSpeed = drive.vel_left();
+                bee->rightSpeed = drive.vel_right();
+            }
+            return 1;
+        case COLOR:
             {
-                ColorStamped color_msg;
-                assert(color_msg.ParseFromString(data));
+                const ColorStamped& color_msg = static_cast<const ColorStamped&>(*command.payload);
                 /*
-                bees_[name]->setColor(Color(color_msg.color().red(),
-                                            color_msg.color().green(),
-                                            color_msg.color().blue()));
+                bee->setColor(Color(color_msg.color().red(),
+                                    color_msg.color().green(),
+                                    color_msg.color().blue()));
                 */
-                bees_[name]->setColor(color_msg.color().red(),
-                                      color_msg.color().green(),
-                                      color_msg.color().blue());
+                bee->setColor(color_msg.color().red(),
+                              color_msg.color().green(),
+                              color_msg.color().blue());
             }
+            return 1;
         }
-        else
+        return 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int BeeHandler::snapshotOutgoing(double from, double to)
+    {
+        int count = 0;
+        BOOST_FOREACH(const ObjectIndex<Bee>::Entry& ca, bees_.entries())
         {
-            cerr << "Unknown device " << device << endl;
+            unsigned int due = dueDevices_(ca.handle, from, to);
+            if (due == 0)
+            {
+                continue;
+            }
+
+            const Bee* bee = ca.object;
+            Sample& sample = outgoing_.add();
+            sample.name = ca.name;
+            sample.due = due;
+
+            if (due & (1 << OBJECT))
+            {
+                sample.object_ranges.clear();
+                sample.object_types.resize(bee->object_sensors.size());
+                for (size_t i = 0; i < bee->object_sensors.size(); i++)
+                {
+                    sample.object_ranges.push_back(bee->object_sensors[i]->getDist());
+                    sample.object_types[i] = bee->object_sensors[i]->getKind();
+                }
+            }
+            if (due & (1 << BASE))
+            {
+                sample.vel_left = bee->leftSpeed;
+                sample.vel_right = bee->rightSpeed;
+                sample.enc_left = bee->leftEncoder;
+                sample.enc_right = bee->rightEncoder;
+                sample.x = bee->pos.x;
+                sample.y = bee->pos.y;
+                sample.yaw = bee->angle;
+            }
+            if (due & (1 << LIGHT))
+            {
+                sample.light_blue = bee->light_sensor_blue->getIntensity();
+            }
+            if (due & (1 << TEMP))
+            {
+                sample.temperatures.clear();
+                BOOST_FOREACH(HeatSensor* hs, bee->heat_sensors)
+                {
+                    sample.temperatures.push_back(hs->getMeasuredHeat());
+                }
+            }
+            if (due & (1 << COLOR))
+            {
+                sample.color_r = bee->color_r_;
+                sample.color_g = bee->color_g_;
+                sample.color_b = bee->color_b_;
+            }
+            if (due & (1 << AIRFLOW))
+            {
+                sample.airflow_intensity = bee->air_flow_sensor->getIntensity ().norm ();
+                sample.airflow_direction = bee->air_flow_sensor->getIntensity ().angle ();
+            }
+            count++;
+        }
+        const ObjectIndex<BeeSwarm>::Entries& swarm_entries = swarm_bees_.entries();
+        for (size_t i = 0; i < swarm_entries.size(); i++)
+        {
+            // bees of the swarm have no object sensors
+            unsigned int due = dueDevices_(swarm_entries[i].handle, from, to) & ~(1 << OBJECT);
+            if (due == 0)
+            {
+                continue;
+            }
+
+            const BeeSwarm& swarm = *swarm_;
+            Sample& sample = outgoing_.add();
+            sample.name = swarm_entries[i].name;
+            sample.due = due;
+
+            if (due & (1 << BASE))
+            {
+                sample.vel_left = swarm.left_speed[i];
+                sample.vel_right = swarm.right_speed[i];
+                sample.enc_left = swarm.left_encoder[i];
+                sample.enc_right = swarm.right_encoder[i];
+                sample.x = swarm.x[i];
+                sample.y = swarm.y[i];
+                sample.yaw = swarm.yaw[i];
+            }
+            if (due & (1 << LIGHT))
+            {
+                sample.light_blue = swarm.light_blue[i];
+            }
+            if (due & (1 << TEMP))
+            {
+                sample.temperatures.assign(
+                    swarm.temperatures.begin() + i * BeeSwarm::HEAT_SENSOR_COUNT,
+                    swarm.temperatures.begin() + (i + 1) * BeeSwarm::HEAT_SENSOR_COUNT);
+            }
+            if (due & (1 << COLOR))
+            {
+                sample.color_r = swarm.color_r[i];
+                sample.color_g = swarm.color_g[i];
+                sample.color_b = swarm.color_b[i];
+            }
+            if (due & (1 << AIRFLOW))
+            {
+                const Vector airflow(swarm.airflow_x[i], swarm.airflow_y[i]);
+                sample.airflow_intensity = airflow.norm ();
+                sample.airflow_direction = airflow.angle ();
+            }
+            count++;
         }
         return count;
     }
 
+// -----------------------------------------------------------------------------
+
+    unsigned int BeeHandler::dueDevices_(ObjectHandle handle, double from, double to)
+    {
+        unsigned int due = 0;
+        for (int d = 0; d < DEVICE_COUNT; d++)
+        {
+            if (schedule_.isDue(handle, d, from, to))
+            {
+                due |= 1 << d;
+            }
+        }
+        return due;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void BeeHandler::swapOutgoing()
+    {
+        outgoing_.swap();
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    unsigned long BeeHandler::droppedOutgoing() const
+    {
+        return outgoing_.dropped();
+    }
+
 // -----------------------------------------------------------------------------
 
     /* virtual */
     int BeeHandler::sendOutgoing(socket_t& socket)
     {
         int count = 0;
-        BOOST_FOREACH(const BeeMap::value_type& ca, bees_)
+        for (size_t i = 0; i < outgoing_.size(); i++)
         {
+            const Sample& sample = outgoing_[i];
             std::string data;
 
             /* Publishing Object Sensor readings */
-            ObjectArray objects;
-            BOOST_FOREACH(ObjectSensor* obj, ca.second->object_sensors)
+            if (sample.due & (1 << OBJECT))
             {
-                objects.add_range(obj->getDist());                
-                objects.add_type(obj->getType());
+                ObjectArray objects;
+                for (size_t j = 0; j < sample.object_ranges.size(); j++)
+                {
+                    objects.add_range(sample.object_ranges[j]);                
+                    objects.add_type(objectKindName(sample.object_types[j]));
+                }
+                objects.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Object", "Ranges", data);
+                count++;
             }
-            objects.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Object", "Ranges", data);
-            count++;
 
-            /* Publish velocity setpoints */
-            DiffDrive drive;
-            drive.set_vel_left(ca.second->leftSpeed);
-            drive.set_vel_right(ca.second->rightSpeed);
-            drive.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Base", "VelRef", data);
-            count++;
+            if (sample.due & (1 << BASE))
+            {
+                /* Publish velocity setpoints */
+                DiffDrive drive;
+                drive.set_vel_left(sample.vel_left);
+                drive.set_vel_right(sample.vel_right);
+                drive.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Base", "VelRef", data);
+                count++;
 
-            /* Publish velocities */
-            drive.set_vel_left(ca.second->leftEncoder);
-            drive.set_vel_right(ca.second->rightEncoder);
-            send_multipart(socket, ca.first, "Base", "Enc", data);
-            count++;
+                /* Publish velocities */
+                drive.set_vel_left(sample.enc_left);
+                drive.set_vel_right(sample.enc_right);
+                send_multipart(socket, sample.name, "Base", "Enc", data);
+                count++;
+
+                /* Publish ground truth */
+                PoseStamped pose;
+                pose.mutable_pose()->mutable_position()->set_x(sample.x);
+                pose.mutable_pose()->mutable_position()->set_y(sample.y);
+                pose.mutable_pose()->mutable_orientation()->set_z(sample.yaw);
+                pose.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Base", "GroundTruth", data);
+            }
 
             /* Publish light sensor data */
-            ColorStamped light;
-            light.mutable_color()->set_red(0);
-            light.mutable_color()->set_green(0);
-            light.mutable_color()->set_blue(ca.second->light_sensor_blue->getIntensity());
+            if (sample.due & (1 << LIGHT))
+            {
+                ColorStamped light;
+                light.mutable_color()->set_red(0);
+                light.mutable_color()->set_green(0);
+                light.mutable_color()->set_blue(sample.light_blue);
             
-            light.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Light", "Readings", data);
-            count++;
-
-            /* Publish ground truth */
-            PoseStamped pose;
-            pose.mutable_pose()->mutable_position()->set_x(ca.second->pos.x);
-            pose.mutable_pose()->mutable_position()->set_y(ca.second->pos.y);
-            pose.mutable_pose()->mutable_orientation()->set_z(ca.second->angle);
-            pose.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Base", "GroundTruth", data);
+                light.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Light", "Readings", data);
+                count++;
+            }
 
             /* Publish temperature sensor data */
-            TemperatureArray temps;
-            BOOST_FOREACH(HeatSensor* hs, ca.second->heat_sensors)
+            if (sample.due & (1 << TEMP))
             {
-                temps.add_temp(hs->getMeasuredHeat());
+                TemperatureArray temps;
+                BOOST_FOREACH(double t, sample.temperatures)
+                {
+                    temps.add_temp(t);
+                }
+                temps.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Temp", "Temperatures", data);
             }
-            temps.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Temp", "Temperatures", data);
 
             /* Publish Diagnostic color "actuator" set value */
-            ColorStamped color;
-            color.mutable_color()->set_red(ca.second->color_r_);
-            color.mutable_color()->set_green(ca.second->color_g_);
-            color.mutable_color()->set_blue(ca.second->color_b_);
-            color.SerializeToString(&data);
-            send_multipart(socket, ca.first, "Color", "ColorVal", data);
+            if (sample.due & (1 << COLOR))
+            {
+                ColorStamped color;
+                color.mutable_color()->set_red(sample.color_r);
+                color.mutable_color()->set_green(sample.color_g);
+                color.mutable_color()->set_blue(sample.color_b);
+                color.SerializeToString(&data);
+                send_multipart(socket, sample.name, "Color", "ColorVal", data);
+            }
 
             /* Publish air flow sensor */
-            AirflowReading airflowReading;
-				airflowReading.set_intensity (ca.second->air_flow_sensor->intensity.norm ());
-				airflowReading.set_direction (ca.second->air_flow_sensor->intensity.angle ());
-				airflowReading.SerializeToString (&data);
-				send_multipart (socket, ca.first, "Airflow", "Reading", data);
+            if (sample.due & (1 << AIRFLOW))
+            {
+                AirflowReading airflowReading;
+                airflowReading.set_intensity (sample.airflow_intensity);
+                airflowReading.set_direction (sample.airflow_direction);
+                airflowReading.SerializeToString (&data);
+                send_multipart (socket, sample.name, "Airflow", "Reading", data);
+            }
 
             /* Publish other stuff as necessary */
         }
@@ -188,16 +419,31 @@ namespace Enki
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    PhysicalObject* BeeHandler::getObject(const std::string& name)
+    PhysicalObject* BeeHandler::getObject(ObjectHandle handle)
     {
-        if (bees_.count(name) > 0)
-        {
-            return bees_[name];
-        }
-        else
+        return bees_.get(handle);
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    bool BeeHandler::hasObject(ObjectHandle handle)
+    {
+        return bees_.get(handle) != 0 || swarm_bees_.get(handle) != 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    bool BeeHandler::teleportObject(ObjectHandle handle,
+                                    double x, double y, double yaw)
+    {
+        if (swarm_bees_.get(handle) == 0)
         {
-            return 0;
+            return false;
         }
+        swarm_->setPose(swarm_bees_.position(handle), Point(x, y), yaw);
+        return true;
     }
 
 // -----------------------------------------------------------------------------
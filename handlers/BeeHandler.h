@@ -5,14 +5,20 @@
 #ifndef ENKI_BEE_HANDLER_H
 #define ENKI_BEE_HANDLER_H
 
-#include <map>
+#include <vector>
 
+#include <PhysicalEngine.h>
+
+#include "extensions/ExtendedRobot.h"
 #include "handlers/ObjectHandler.h"
+#include "handlers/ObjectIndex.h"
+#include "handlers/OutgoingBuffer.h"
 
 namespace Enki
 {
 
     class Bee;
+    class BeeSwarm;
     class WorldExt;
 
     //! Handling of Bees
@@ -22,10 +28,14 @@ namespace Enki
     class BeeHandler : public ObjectHandler
     {
     public:
+        //! Create a handler of bees.
+        /*! If a swarm is given, spawned bees are added to it instead
+            of being Enki robots. The swarm must have been added to
+            the world, and outlive the handler.
+         */
         BeeHandler(double body_length, double body_width, double body_height,
-                   double body_mass, double max_speed) :
-        body_length_(body_length), body_width_(body_width), body_height_(body_height),
-          body_mass_(body_mass), max_speed_(max_speed) { }
+                   double body_mass, double max_speed,
+                   BeeSwarm* swarm = 0);
         virtual ~BeeHandler() { }
 
         //! Bee factory method
@@ -34,18 +44,32 @@ namespace Enki
           Keeps a pointer to the created robot, but does not
           delete it in the destructor.
 
-          \return Returns the name of the created robot.
+          \arg handle Handle interned for the robot name by the world.
+          \return False if the robot was not created, because an
+                  object with that handle already exists.
         */
-        virtual std::string createObject(const std::string& data, WorldExt* world);
+        virtual bool createObject(const AssisiMsg::Spawn& spawn,
+                                  ObjectHandle handle,
+                                  WorldExt* world);
+
+        //! Validate incoming message
+        virtual bool parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const;
 
         //! Handle incoming message
         /*! Handles bee actuator commands.
 
          */
-        virtual int handleIncoming(const std::string& name,
-                                   const std::string& device,
-                                   const std::string& command,
-                                   const std::string& data);
+        virtual int handleIncoming(const Command& command);
+
+        //! Copy Bee sensor data, setpoints and poses.
+        virtual int snapshotOutgoing(double from, double to);
+
+        virtual void swapOutgoing();
+
+        virtual unsigned long droppedOutgoing() const;
 
         //! Assemble outgoing messages.
         /*! Sends Bee sensor data messages.
@@ -53,16 +77,75 @@ namespace Enki
          */
         virtual int sendOutgoing(zmq::socket_t& socket);
 
-    virtual PhysicalObject* getObject(const std::string& name);
+    virtual PhysicalObject* getObject(ObjectHandle handle);
+
+        virtual bool hasObject(ObjectHandle handle);
+
+        //! Move a bee of the swarm.
+        virtual bool teleportObject(ObjectHandle handle,
+                                    double x, double y, double yaw);
+
+        //! All Bees, in order of creation.
+        const ObjectIndex<Bee>& getBees() const { return bees_; }
 
     private:
-        typedef std::map<std::string, Bee*> BeeMap;
-        BeeMap bees_;
+        //! Devices of a bee due in the step (from, to], bit (1 << device).
+        unsigned int dueDevices_(ObjectHandle handle, double from, double to);
+
+        ObjectIndex<Bee> bees_;
+        BeeSwarm* swarm_;
+        //! Bees of the swarm; the position of an entry is the index
+        //! of the bee in the swarm arrays.
+        ObjectIndex<BeeSwarm> swarm_bees_;
         double body_length_;
         double body_width_;
         double body_height_;
         double body_mass_;
         double max_speed_;
+        // Body shape shared by all bees of this handler
+        PhysicalObject::Hull prefab_hull_;
+
+        //! Bee devices, in the order of DEVICE_NAMES.
+        enum Device
+        {
+            OBJECT,
+            BASE,
+            LIGHT,
+            TEMP,
+            COLOR,
+            AIRFLOW,
+            DEVICE_COUNT
+        };
+        static const char* const DEVICE_NAMES[DEVICE_COUNT];
+
+        //! Bee commands, in the order of COMMAND_NAMES.
+        enum Action
+        {
+            VEL,
+            SET,
+            COMMAND_COUNT
+        };
+        static const char* const COMMAND_NAMES[COMMAND_COUNT];
+
+        //! Outgoing data of one Bee.
+        /*! Only the fields of the devices in the due mask,
+            bit (1 << device), are valid.
+         */
+        struct Sample
+        {
+            std::string name;
+            unsigned int due;
+            std::vector<double> object_ranges;
+            std::vector<ObjectKind> object_types;
+            double vel_left, vel_right;
+            double enc_left, enc_right;
+            double x, y, yaw;
+            double light_blue;
+            std::vector<double> temperatures;
+            double color_r, color_g, color_b;
+            double airflow_intensity, airflow_direction;
+        };
+        OutgoingBuffer<Sample> outgoing_;
     };
 }
 
@@ -18,6 +18,7 @@
 #include "base_msgs.pb.h"
 #include "dev_msgs.pb.h"
 #include "sim_msgs.pb.h"
+#include "playground_msgs.pb.h"
 
 using zmq::message_t;
 using zmq::socket_t;
@@ -31,117 +32,293 @@ namespace Enki
 {
 	extern double env_temp;
 
+    const char* const CasuHandler::DEVICE_NAMES[CasuHandler::DEVICE_COUNT] =
+    {
+        "IR", "Acc", "Temp", "Peltier", "Speaker", "Airflow", "DiagnosticLed"
+    };
+
+    const char* const CasuHandler::COMMAND_NAMES[CasuHandler::COMMAND_COUNT] =
+    {
+        "On", "Off"
+    };
+
+// -----------------------------------------------------------------------------
+
+    CasuHandler::CasuHandler()
+    {
+        for (int d = 0; d < DEVICE_COUNT; d++)
+        {
+            schedule_.addDevice(DEVICE_NAMES[d]);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
     /* virtual */
-    string CasuHandler::createObject(const std::string& data, 
-                                     WorldExt* world)
+    bool CasuHandler::createObject(const Spawn& spawn_msg, 
+                                   ObjectHandle handle,
+                                   WorldExt* world)
     {
-        string name = "";
-        Spawn spawn_msg;     
-        assert(spawn_msg.ParseFromString(data));
-        if (casus_.count(spawn_msg.name()) < 1)
+        return createCasu_(spawn_msg, handle, world, true) != 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int CasuHandler::createObjects(const std::vector<const Spawn*>& spawns,
+                                   const std::vector<ObjectHandle>& handles,
+                                   WorldExt* world)
+    {
+        std::vector<Point> positions;
+        positions.reserve(spawns.size());
+        for (size_t i = 0; i < spawns.size(); i++)
+        {
+            Casu* casu = createCasu_(*spawns[i], handles[i], world, false);
+            if (casu)
+            {
+                positions.push_back(casu->pos);
+            }
+        }
+        Casu::drawPeltiers(world, positions);
+        return positions.size();
+    }
+
+// -----------------------------------------------------------------------------
+
+    Casu* CasuHandler::createCasu_(const Spawn& spawn_msg,
+                                   ObjectHandle handle,
+                                   WorldExt* world,
+                                   bool drawPeltier)
+    {
+        if (casus_.get(handle) == 0)
         {
-            name = spawn_msg.name();
             Point pos(spawn_msg.pose().position().x(),
                       spawn_msg.pose().position().y());
             double yaw(spawn_msg.pose().orientation().z());
-            casus_[name] = new Casu(pos, yaw, world, env_temp);
-            casus_[name]->pos = pos;
-            casus_[name]->angle = yaw;
-            // casus_[name]->peltier->setHeatDiffusivity (world, WorldHeat::THERMAL_DIFFUSIVITY_COPPER);
+            Casu* casu = new Casu(pos, yaw, world, env_temp, 0, drawPeltier);
+            casu->pos = pos;
+            casu->angle = yaw;
+            casus_.add(handle, spawn_msg.name(), casu);
+            schedule_.addObject(handle);
+            // casu->peltier->setHeatDiffusivity (world, WorldHeat::THERMAL_DIFFUSIVITY_COPPER);
 
-            world->addObject(casus_[name]);
+            world->addObject(casu);
+            return casu;
         }
         else
         {
             cerr << "Casu "<< spawn_msg.name() << " already exists." << endl;
+            return 0;
         }
-        return name;
     }
 
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    int CasuHandler::handleIncoming(const std::string& name,
-                                    const std::string& device,
+    bool CasuHandler::parseIncoming(const std::string& device,
                                     const std::string& command,
-                                    const std::string& data)
+                                    const std::string& data,
+                                    Command& parsed) const
     {
-        int count = 0;
-        if (device == "DiagnosticLed")
+        parsed.device = lookup(DEVICE_NAMES, DEVICE_COUNT, device);
+        parsed.command = lookup(COMMAND_NAMES, COMMAND_COUNT, command);
+        switch (parsed.device)
         {
-            if (command == "On")
+        case DIAGNOSTICLED:
+            switch (parsed.command)
             {
-                ColorStamped color_msg;
-                assert(color_msg.ParseFromString(data));
-                casus_[name]->top_led->on( Enki::Color(color_msg.color().red(),
-                                                      color_msg.color().green(),
-                                                      color_msg.color().blue(),
-                                                      color_msg.color().alpha() ) );
-                count++;
+            case ON:  return parsePayload<ColorStamped>(data, parsed.payload);
+            case OFF: return true;
             }
-            else if (command == "Off")
+            break;
+        case PELTIER:
+            switch (parsed.command)
             {
-                casus_[name]->top_led->off( );
-                count++;
+            case ON:  return parsePayload<Temperature>(data, parsed.payload);
+            case OFF: return true;
             }
-            else
+            break;
+        case SPEAKER:
+            if (parsed.command == ON)
             {
-                cerr << "Unknown command for " << name << "/" << device << endl;
-            }         
+                return parsePayload<VibrationSetpoint>(data, parsed.payload);
+            }
+            break;
+        case AIRFLOW:
+            switch (parsed.command)
+            {
+            case ON:  return parsePayload<Airflow>(data, parsed.payload);
+            case OFF: return true;
+            }
+            break;
         }
-        else if (device == "Peltier")
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int CasuHandler::handleIncoming(const Command& command)
+    {
+        Casu* casu = casus_.get(command.handle);
+        switch (command.device)
         {
-            if (command == "On")
+        case DIAGNOSTICLED:
+            if (command.command == ON)
             {
-                Temperature temp_msg;
-                assert(temp_msg.ParseFromString(data));
-                casus_[name]->peltier->setHeat(temp_msg.temp());
-                casus_[name]->peltier->setSwitchedOn(true);
-                count++;
+                const ColorStamped& color_msg = static_cast<const ColorStamped&>(*command.payload);
+                casu->top_led->on( Enki::Color(color_msg.color().red(),
+                                               color_msg.color().green(),
+                                               color_msg.color().blue(),
+                                               color_msg.color().alpha() ) );
             }
-            else if (command == "Off")
+            else
             {
-                casus_[name]->peltier->setSwitchedOn(false);
-                count++;
+                casu->top_led->off( );
             }
-        }
-        else if (device == "Speaker")
-        {
-            if (command == "On")
+            break;
+        case PELTIER:
+            if (command.command == ON)
             {
-                VibrationSetpoint freq_msg;
-                assert (freq_msg.ParseFromString (data));
-                casus_[name]->vibration_source->setFrequency (freq_msg.freq ());
-                count++;
+                const Temperature& temp_msg = static_cast<const Temperature&>(*command.payload);
+                casu->peltier->setHeat(temp_msg.temp());
+                casu->peltier->setSwitchedOn(true);
             }
+            else
+            {
+                casu->peltier->setSwitchedOn(false);
+            }
+            break;
+        case SPEAKER:
+            {
+                const VibrationSetpoint& freq_msg = static_cast<const VibrationSetpoint&>(*command.payload);
+                casu->vibration_source->setFrequency (freq_msg.freq ());
+            }
+            break;
+        case AIRFLOW:
+            {
+                double intensity = 0;
+                if (command.command == ON)
+                {
+                    intensity = static_cast<const Airflow&>(*command.payload).intensity ();
+                }
+                BOOST_FOREACH(AirPump* p, casu->air_pumps)
+                {
+                    p->setIntensity (intensity);
+                }
+            }
+            break;
+        default:
+            return 0;
         }
-        else if (device == "Airflow")
-        {
-           if (command == "On")
-           {
-              Airflow airflow;
-              assert (airflow.ParseFromString (data));
-              BOOST_FOREACH(AirPump* p, casus_ [name]->air_pumps)
-              {
-                  p->setIntensity (airflow.intensity ());
-              }
-              count++;
-           }
-           else if (command == "Off")
-           {
-              BOOST_FOREACH(AirPump* p, casus_ [name]->air_pumps)
-              {
-                  p->setIntensity (0);
-              }
-              count++;
-           }
-        }
-        else
+        return 1;
+    }   
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int CasuHandler::snapshotOutgoing(double from, double to)
+    {
+        int count = 0;
+        BOOST_FOREACH(const ObjectIndex<Casu>::Entry& ca, casus_.entries())
         {
-            cerr << "Unknown device " << device << endl;
+            unsigned int due = 0;
+            for (int d = 0; d < DEVICE_COUNT; d++)
+            {
+                if (schedule_.isDue(ca.handle, d, from, to))
+                {
+                    due |= 1 << d;
+                }
+            }
+            if (due == 0)
+            {
+                continue;
+            }
+
+            const Casu* casu = ca.object;
+            Sample& sample = outgoing_.add();
+            sample.name = ca.name;
+            sample.due = due;
+
+            if (due & (1 << IR))
+            {
+                sample.ir_ranges.clear();
+                sample.ir_values.clear();
+                BOOST_FOREACH(IRSensor* ir, casu->range_sensors)
+                {
+                    sample.ir_ranges.push_back(ir->getDist());
+                    sample.ir_values.push_back(ir->getValue());
+                }
+            }
+            if (due & (1 << ACC))
+            {
+                sample.vibration_amplitudes.resize(casu->vibration_sensors.size());
+                sample.vibration_frequencies.resize(casu->vibration_sensors.size());
+                for (size_t i = 0; i < casu->vibration_sensors.size(); i++)
+                {
+                    sample.vibration_amplitudes[i] = casu->vibration_sensors[i]->getAmplitude();
+                    sample.vibration_frequencies[i] = casu->vibration_sensors[i]->getFrequency();
+                }
+                // Spectra are computed here, at the publish rate,
+                // rather than every step
+                sample.vibration_spectra.resize(Casu::VIBRATION_SPECTRUM_WINDOW > 0
+                                                ? casu->vibration_sensors.size() : 0);
+                for (size_t i = 0; i < sample.vibration_spectra.size(); i++)
+                {
+                    casu->vibration_sensors[i]->getSpectrum(Casu::VIBRATION_SPECTRUM_PEAKS,
+                                                            sample.vibration_spectra[i]);
+                }
+            }
+            if (due & (1 << TEMP))
+            {
+                sample.temperatures.clear();
+                BOOST_FOREACH(HeatSensor* h, casu->temp_sensors)
+                {
+                    sample.temperatures.push_back(h->getMeasuredHeat());
+                }
+            }
+            if (due & (1 << PELTIER))
+            {
+                sample.peltier_heat = casu->peltier->getHeat();
+                sample.peltier_on = casu->peltier->isSwitchedOn();
+            }
+            if (due & (1 << SPEAKER))
+            {
+                sample.speaker_frequency = casu->vibration_source->getFrequency();
+                sample.speaker_amplitude = casu->vibration_source->getMaximumAmplitude();
+            }
+            if (due & (1 << AIRFLOW))
+            {
+                sample.airflow_intensity = casu->air_pumps[0]->getIntensity();
+            }
+            if (due & (1 << DIAGNOSTICLED))
+            {
+                Color col = casu->top_led->getColor();
+                sample.led_r = col.r();
+                sample.led_g = col.g();
+                sample.led_b = col.b();
+                sample.led_on = casu->top_led->isSwitchedOn();
+            }
+            count++;
         }
         return count;
-    }   
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void CasuHandler::swapOutgoing()
+    {
+        outgoing_.swap();
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    unsigned long CasuHandler::droppedOutgoing() const
+    {
+        return outgoing_.dropped();
+    }
 
 // -----------------------------------------------------------------------------
 
@@ -149,139 +326,179 @@ namespace Enki
     int CasuHandler::sendOutgoing(socket_t& socket)
     {
         int count = 0;
-        BOOST_FOREACH(const CasuMap::value_type& ca, casus_)
+        for (size_t i = 0; i < outgoing_.size(); i++)
         {
+            const Sample& sample = outgoing_[i];
             std::string data;
             
             /* Publishing IR readings */
-            RangeArray ranges;
-            BOOST_FOREACH(IRSensor* ir, ca.second->range_sensors)
+            if (sample.due & (1 << IR))
             {
-                ranges.add_range(ir->getDist());                
-                ranges.add_raw_value(ir->getValue());
-            }
+                RangeArray ranges;
+                for (size_t j = 0; j < sample.ir_ranges.size(); j++)
+                {
+                    ranges.add_range(sample.ir_ranges[j]);                
+                    ranges.add_raw_value(sample.ir_values[j]);
+                }
             
-            ranges.SerializeToString(&data);
-            zmq::send_multipart(socket, ca.first, "IR", "Ranges", data);
+                ranges.SerializeToString(&data);
+                zmq::send_multipart(socket, sample.name, "IR", "Ranges", data);
+                count++;
+            }
 
             /* Publish vibration readings */
-            VibrationReadingArray vibrations;
-            BOOST_FOREACH (VibrationSensor *vs, ca.second->vibration_sensors)
+            if (sample.due & (1 << ACC))
             {
-                VibrationReading *vibrationReading = vibrations.add_reading ();
-                const std::vector<double> &amplitudes = vs->getAmplitude ();
-                const std::vector<double> &frequencies = vs->getFrequency ();
-                BOOST_FOREACH (double a, vs->getAmplitude ())
-                    vibrationReading->add_amplitude (a);
-                BOOST_FOREACH (double f, vs->getFrequency ())
-                    vibrationReading->add_freq (f);
-					// TODO
-					//  add vibration amplitude standard deviation
+                VibrationReadingArray vibrations;
+                for (size_t j = 0; j < sample.vibration_amplitudes.size(); j++)
+                {
+                    VibrationReading *vibrationReading = vibrations.add_reading ();
+                    BOOST_FOREACH (double a, sample.vibration_amplitudes[j])
+                        vibrationReading->add_amplitude (a);
+                    BOOST_FOREACH (double f, sample.vibration_frequencies[j])
+                        vibrationReading->add_freq (f);
+                    // The amplitude standard deviation is published
+                    // on Acc/Spectrum, when the sensors keep samples
+                }
+                vibrations.SerializeToString (&data);
+                zmq::send_multipart (socket, sample.name, "Acc", "Measurements", data);
+                count++;
+
+                if (!sample.vibration_spectra.empty())
+                {
+                    VibrationSpectrumArray spectra;
+                    BOOST_FOREACH (const SpectrumAnalyser::Features& f, sample.vibration_spectra)
+                    {
+                        VibrationSpectrum *spectrum = spectra.add_reading();
+                        BOOST_FOREACH (const SpectrumAnalyser::Peak& p, f.peaks)
+                        {
+                            spectrum->add_freq(p.frequency);
+                            spectrum->add_amplitude(p.amplitude);
+                        }
+                        spectrum->set_amplitude_mean(f.mean);
+                        spectrum->set_amplitude_stddev(f.standardDeviation);
+                        spectrum->set_amplitude_rms(f.rms);
+                        spectrum->set_amplitude_peak(f.peak);
+                        spectrum->set_samples(f.samples);
+                        spectrum->set_sample_rate(f.sampleRate);
+                    }
+                    spectra.SerializeToString(&data);
+                    zmq::send_multipart(socket, sample.name, "Acc", "Spectrum", data);
+                    count++;
+                }
             }
-            vibrations.SerializeToString (&data);
-            zmq::send_multipart (socket, ca.first, "Acc", "Measurements", data);
 
             /* Publish temperature sensor readings. */
-            TemperatureArray temperatures;
-            BOOST_FOREACH(HeatSensor* h, ca.second->temp_sensors)
+            if (sample.due & (1 << TEMP))
             {
-                temperatures.add_temp(h->getMeasuredHeat());
-            }
-            /* Add fake readings for additional sensors and estimates
-               that exist on real CASUs.
-               TODO: This should also be calibrated with measurements.
-            */
-            double temp_avg = (ca.second->temp_sensors[0]->getMeasuredHeat() +
-                               ca.second->temp_sensors[1]->getMeasuredHeat() +
-                               ca.second->temp_sensors[2]->getMeasuredHeat() +
-                               ca.second->temp_sensors[3]->getMeasuredHeat()) / 4.0;
-            // Bottom PCB sensor
-            temperatures.add_temp(temp_avg+1.0);
-            // Metal ring around CASU
-            temperatures.add_temp(temp_avg+0.5);
-            // Wax around CASU
-            temperatures.add_temp(temp_avg);
+                TemperatureArray temperatures;
+                BOOST_FOREACH(double t, sample.temperatures)
+                {
+                    temperatures.add_temp(t);
+                }
+                /* Add fake readings for additional sensors and estimates
+                   that exist on real CASUs.
+                   TODO: This should also be calibrated with measurements.
+                */
+                double temp_avg = (sample.temperatures[0] +
+                                   sample.temperatures[1] +
+                                   sample.temperatures[2] +
+                                   sample.temperatures[3]) / 4.0;
+                // Bottom PCB sensor
+                temperatures.add_temp(temp_avg+1.0);
+                // Metal ring around CASU
+                temperatures.add_temp(temp_avg+0.5);
+                // Wax around CASU
+                temperatures.add_temp(temp_avg);
                                   
-            temperatures.SerializeToString(&data);
-            zmq::send_multipart(socket, ca.first, "Temp", "Temperatures", data);
+                temperatures.SerializeToString(&data);
+                zmq::send_multipart(socket, sample.name, "Temp", "Temperatures", data);
+                count++;
+            }
 
             /* Publish actuator setpoints and states. */           
             
             /* Temperature setpoint */
-            Temperature temp_ref;
-            temp_ref.set_temp(ca.second->peltier->getHeat());
-            temp_ref.SerializeToString(&data);
-            if (ca.second->peltier->isSwitchedOn())
+            if (sample.due & (1 << PELTIER))
             {
-                zmq::send_multipart(socket, ca.first, "Peltier", "On", data);
+                Temperature temp_ref;
+                temp_ref.set_temp(sample.peltier_heat);
+                temp_ref.SerializeToString(&data);
+                if (sample.peltier_on)
+                {
+                    zmq::send_multipart(socket, sample.name, "Peltier", "On", data);
+                }
+                else
+                {
+                    zmq::send_multipart(socket, sample.name, "Peltier", "Off", data);
+                }                
+                count++;
             }
-            else
-            {
-                zmq::send_multipart(socket, ca.first, "Peltier", "Off", data);
-            }                
             
             /* Vibration setpoint */
-            VibrationSetpoint vib_ref;
-            vib_ref.set_freq(ca.second->vibration_source->getFrequency());
-            vib_ref.set_amplitude(ca.second->vibration_source->getMaximumAmplitude());
-            vib_ref.SerializeToString(&data);
-            //! TODO: WaveVibrationSource should implement an isSwitchedOn function!
-            if (ca.second->vibration_source->getFrequency())
+            if (sample.due & (1 << SPEAKER))
             {
-                zmq::send_multipart(socket, ca.first, "Speaker", "On", data);
-            }
-            else
-            {
-                zmq::send_multipart(socket, ca.first, "Speaker", "Off", data);
+                VibrationSetpoint vib_ref;
+                vib_ref.set_freq(sample.speaker_frequency);
+                vib_ref.set_amplitude(sample.speaker_amplitude);
+                vib_ref.SerializeToString(&data);
+                //! TODO: WaveVibrationSource should implement an isSwitchedOn function!
+                if (sample.speaker_frequency)
+                {
+                    zmq::send_multipart(socket, sample.name, "Speaker", "On", data);
+                }
+                else
+                {
+                    zmq::send_multipart(socket, sample.name, "Speaker", "Off", data);
+                }
+                count++;
             }
 
             /* Airflow setpoint */
-            Airflow air_ref;
-            air_ref.set_intensity(ca.second->air_pumps[0]->getIntensity());
-            air_ref.SerializeToString(&data);
-            //! TODO: AirPump should implement an isSwitchedOn function!
-            if (ca.second->air_pumps[0]->getIntensity())
+            if (sample.due & (1 << AIRFLOW))
             {
-                zmq::send_multipart(socket, ca.first, "Airflow", "On", data);
-            }
-            else
-            {
-                zmq::send_multipart(socket, ca.first, "Airflow", "Off", data);
+                Airflow air_ref;
+                air_ref.set_intensity(sample.airflow_intensity);
+                air_ref.SerializeToString(&data);
+                //! TODO: AirPump should implement an isSwitchedOn function!
+                if (sample.airflow_intensity)
+                {
+                    zmq::send_multipart(socket, sample.name, "Airflow", "On", data);
+                }
+                else
+                {
+                    zmq::send_multipart(socket, sample.name, "Airflow", "Off", data);
+                }
+                count++;
             }
 
             /* Diagnostic LED setpoint */
-            ColorStamped color_ref;
-            Color col = ca.second->top_led->getColor();
-            color_ref.mutable_color()->set_red(col.r());
-            color_ref.mutable_color()->set_green(col.g());
-            color_ref.mutable_color()->set_blue(col.b());
-            color_ref.SerializeToString(&data);
-            if (ca.second->top_led->isSwitchedOn())
+            if (sample.due & (1 << DIAGNOSTICLED))
             {
-                zmq::send_multipart(socket, ca.first, "DiagnosticLed", "On", data);
-            }
-            else
-            {
-                zmq::send_multipart(socket, ca.first, "DiagnosticLed", "Off", data);
+                ColorStamped color_ref;
+                color_ref.mutable_color()->set_red(sample.led_r);
+                color_ref.mutable_color()->set_green(sample.led_g);
+                color_ref.mutable_color()->set_blue(sample.led_b);
+                color_ref.SerializeToString(&data);
+                if (sample.led_on)
+                {
+                    zmq::send_multipart(socket, sample.name, "DiagnosticLed", "On", data);
+                }
+                else
+                {
+                    zmq::send_multipart(socket, sample.name, "DiagnosticLed", "Off", data);
+                }
+                count++;
             }
-
-            count++;
         }
         return count;
     }
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    PhysicalObject* CasuHandler::getObject(const std::string& name)
+    PhysicalObject* CasuHandler::getObject(ObjectHandle handle)
     {
-        if (casus_.count(name) > 0)
-        {
-            return casus_[name];
-        }
-        else
-        {
-            return 0;
-        }
+        return casus_.get(handle);
     }
 
 // -----------------------------------------------------------------------------
@@ -5,9 +5,12 @@
 #ifndef ENKI_CASU_HANDLER_H
 #define ENKI_CASU_HANDLER_H
 
-#include <map>
+#include <vector>
 
 #include "handlers/ObjectHandler.h"
+#include "handlers/ObjectIndex.h"
+#include "handlers/OutgoingBuffer.h"
+#include "extensions/SpectrumAnalyser.h"
 
 namespace Enki
 {
@@ -22,7 +25,7 @@ namespace Enki
     class CasuHandler : public ObjectHandler
     {
     public:
-        CasuHandler() { }
+        CasuHandler();
         virtual ~CasuHandler() { }
 
         //! Casu factory method
@@ -31,18 +34,37 @@ namespace Enki
           Keeps a pointer to the created robot, but does not
           delete it in the destructor.
 
-          \return Returns the name of the created robot.
+          \arg handle Handle interned for the robot name by the world.
+          \return False if the robot was not created, because an
+                  object with that handle already exists.
         */
-        virtual std::string createObject(const std::string& data, WorldExt* world);
+        virtual bool createObject(const AssisiMsg::Spawn& spawn,
+                                  ObjectHandle handle,
+                                  WorldExt* world);
+
+        //! Create Casus, drawing their peltier discs in one pass.
+        virtual int createObjects(const std::vector<const AssisiMsg::Spawn*>& spawns,
+                                  const std::vector<ObjectHandle>& handles,
+                                  WorldExt* world);
+
+        //! Validate incoming message
+        virtual bool parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const;
 
         //! Handle incoming message
         /*! Handles casu actuator commands.
 
          */
-        virtual int handleIncoming(const std::string& name,
-                                   const std::string& device,
-                                   const std::string& command,
-                                   const std::string& data);
+        virtual int handleIncoming(const Command& command);
+
+        //! Copy CASU sensor data and actuator states.
+        virtual int snapshotOutgoing(double from, double to);
+
+        virtual void swapOutgoing();
+
+        virtual unsigned long droppedOutgoing() const;
 
         //! Assemble outgoing messages.
         /*! Sends CASU sensor data messages.
@@ -50,11 +72,67 @@ namespace Enki
          */
         virtual int sendOutgoing(zmq::socket_t& socket);
 
-        virtual PhysicalObject* getObject(const std::string& name);
+        virtual PhysicalObject* getObject(ObjectHandle handle);
+
+        //! All Casus, in order of creation.
+        const ObjectIndex<Casu>& getCasus() const { return casus_; }
 
     private:
-        typedef std::map<std::string, Casu*> CasuMap;
-        CasuMap casus_;
+        //! Create a Casu, optionally drawing its peltier disc.
+        Casu* createCasu_(const AssisiMsg::Spawn& spawn,
+                          ObjectHandle handle,
+                          WorldExt* world,
+                          bool drawPeltier);
+
+        ObjectIndex<Casu> casus_;
+
+        //! Casu devices, in the order of DEVICE_NAMES.
+        enum Device
+        {
+            IR,
+            ACC,
+            TEMP,
+            PELTIER,
+            SPEAKER,
+            AIRFLOW,
+            DIAGNOSTICLED,
+            DEVICE_COUNT
+        };
+        static const char* const DEVICE_NAMES[DEVICE_COUNT];
+
+        //! Actuator commands, in the order of COMMAND_NAMES.
+        enum Action
+        {
+            ON,
+            OFF,
+            COMMAND_COUNT
+        };
+        static const char* const COMMAND_NAMES[COMMAND_COUNT];
+
+        //! Outgoing data of one Casu.
+        /*! Only the fields of the devices in the due mask,
+            bit (1 << device), are valid.
+         */
+        struct Sample
+        {
+            std::string name;
+            unsigned int due;
+            std::vector<double> ir_ranges;
+            std::vector<double> ir_values;
+            std::vector<std::vector<double> > vibration_amplitudes;
+            std::vector<std::vector<double> > vibration_frequencies;
+            // Empty if the sensors do not keep a window of samples
+            std::vector<SpectrumAnalyser::Features> vibration_spectra;
+            std::vector<double> temperatures;
+            double peltier_heat;
+            bool peltier_on;
+            double speaker_frequency;
+            double speaker_amplitude;
+            double airflow_intensity;
+            double led_r, led_g, led_b;
+            bool led_on;
+        };
+        OutgoingBuffer<Sample> outgoing_;
     };
 }
 
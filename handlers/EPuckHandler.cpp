@@ -10,7 +10,7 @@
 #include <zmq.hpp>
 #include "playground/zmq_helpers.hpp"
 
-#include <PhysicalEngine.h>
+#include "playground/WorldExt.h"
 
 #include "robots/e-puck/EPuck.h"
 #include "handlers/EPuckHandler.h"
@@ -32,107 +32,151 @@ namespace Enki
 {
 
 // -----------------------------------------------------------------------------
+
+    EPuckHandler::EPuckHandler()
+    {
+        schedule_.addDevice("base");
+        schedule_.addDevice("ir");
+    }
+
+// -----------------------------------------------------------------------------
+
     /* virtual */
-    string EPuckHandler::createObject(const std::string& data,
-                                      World* world)
+    bool EPuckHandler::createObject(const Spawn& spawn_msg,
+                                    ObjectHandle handle,
+                                    WorldExt* world)
     {
-        string name = "";
-        Spawn spawn_msg;
-        assert(spawn_msg.ParseFromString(data));
-        if (epucks_.count(spawn_msg.name()) < 1)
+        if (epucks_.get(handle) == 0)
         {
-            name = spawn_msg.name();
             Point pos(spawn_msg.pose().position().x(),
                       spawn_msg.pose().position().y());
             double yaw(spawn_msg.pose().orientation().z());
-            epucks_[name] = new EPuck;
-            epucks_[name]->pos = pos;
-            epucks_[name]->angle = yaw;
-            world->addObject(epucks_[name]);
+            EPuck* epuck = new EPuck;
+            epuck->pos = pos;
+            epuck->angle = yaw;
+            epucks_.add(handle, spawn_msg.name(), epuck);
+            schedule_.addObject(handle);
+            world->addObject(epuck);
+            return true;
         }
         else
         {
             cerr << "Robot " << spawn_msg.name() << " already exists!" << endl;
+            return false;
         }
-        return name;
     }
 
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    int EPuckHandler::handleIncoming(const std::string& name,
-                                     const std::string& device,
+    bool EPuckHandler::parseIncoming(const std::string& device,
                                      const std::string& command,
-                                     const std::string& data)
+                                     const std::string& data,
+                                     Command& parsed) const
+    {
+        if (device == "base" && command == "vel")
+        {
+            parsed.device = BASE;
+            parsed.command = 0;
+            return parsePayload<DiffDrive>(data, parsed.payload);
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int EPuckHandler::handleIncoming(const Command& command)
+    {
+        if (command.device == BASE)
+        {
+            const DiffDrive& drive = static_cast<const DiffDrive&>(*command.payload);
+            EPuck* epuck = epucks_.get(command.handle);
+            epuck->leftSpeed = drive.vel_left();
+            epuck->rightSpeed = drive.vel_right();
+            return 1;
+        }
+        return 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int EPuckHandler::snapshotOutgoing(double from, double to)
     {
         int count = 0;
-        if (device == "base")
+        BOOST_FOREACH(const ObjectIndex<EPuck>::Entry& ep, epucks_.entries())
         {
-            if (command == "vel")
+            if (!schedule_.isDue(ep.handle, IR, from, to))
             {
-                DiffDrive drive;
-                assert(drive.ParseFromString(data));
-                epucks_[name]->leftSpeed = drive.vel_left();
-                epucks_[name]->rightSpeed = drive.vel_right();
-                count++;
+                continue;
             }
-            else
-            {
-                cerr << "Unknown command " << command
-                     << " for " << name << "/" << device << endl;
-            }      
-        }
-        else
-        {
-            cerr << "Unknown device " << command << " for " << name << endl;
+
+            Sample& sample = outgoing_.add();
+            sample.name = ep.name;
+            sample.ranges[0] = ep.object->infraredSensor0.getDist();
+            sample.ranges[1] = ep.object->infraredSensor1.getDist();
+            sample.ranges[2] = ep.object->infraredSensor2.getDist();
+            sample.ranges[3] = ep.object->infraredSensor3.getDist();
+            sample.ranges[4] = ep.object->infraredSensor4.getDist();
+            sample.ranges[5] = ep.object->infraredSensor5.getDist();
+            sample.ranges[6] = ep.object->infraredSensor6.getDist();
+            sample.ranges[7] = ep.object->infraredSensor7.getDist();
+            count++;
         }
         return count;
     }
 
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void EPuckHandler::swapOutgoing()
+    {
+        outgoing_.swap();
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    unsigned long EPuckHandler::droppedOutgoing() const
+    {
+        return outgoing_.dropped();
+    }
+
 // -----------------------------------------------------------------------------
 
     /* virtual */
     int EPuckHandler::sendOutgoing(socket_t& socket)
     {
         int count = 0;
-        BOOST_FOREACH(const EPuckMap::value_type& ep, epucks_)
+        for (size_t i = 0; i < outgoing_.size(); i++)
         {
+            const Sample& sample = outgoing_[i];
+
             /* Publishing IR readings */
             
             // Send IR data (convert cm->m)
             RangeArray ranges;
-            ranges.add_range(ep.second->infraredSensor0.getDist());
-            ranges.add_range(ep.second->infraredSensor1.getDist());
-            ranges.add_range(ep.second->infraredSensor2.getDist());
-            ranges.add_range(ep.second->infraredSensor3.getDist());
-            ranges.add_range(ep.second->infraredSensor4.getDist());
-            ranges.add_range(ep.second->infraredSensor5.getDist());
-            ranges.add_range(ep.second->infraredSensor6.getDist());
-            ranges.add_range(ep.second->infraredSensor7.getDist());
+            for (int j = 0; j < 8; j++)
+            {
+                ranges.add_range(sample.ranges[j]);
+            }
             
             std::string data;
             ranges.SerializeToString(&data);
-            zmq::send_multipart(socket, ep.first, "ir", "ranges", data);
+            zmq::send_multipart(socket, sample.name, "ir", "ranges", data);
             count++;
 
             /* Publish other stuff as necessary ... */
         }
         return count;
     }
-
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    PhysicalObject* EPuckHandler::getObject(const std::string& name)
+    PhysicalObject* EPuckHandler::getObject(ObjectHandle handle)
     {
-        if (epucks_.count(name) > 0)
-        {
-            return epucks_[name];
-        }
-        else
-        {
-            return 0;
-        }
+        return epucks_.get(handle);
     }
 
 // -----------------------------------------------------------------------------
@@ -6,13 +6,13 @@
 #ifndef ENKI_EPUCK_HANDLER_H
 #define ENKI_EPUCK_HANDLER_H
 
-#include <map>
-
 #include "handlers/ObjectHandler.h"
+#include "handlers/ObjectIndex.h"
+#include "handlers/OutgoingBuffer.h"
 
 namespace Enki
 {
-    class World;
+    class WorldExt;
     class EPuck;
     
     //! Handling of EPuck robots
@@ -22,7 +22,7 @@ namespace Enki
     class EPuckHandler : public ObjectHandler
     {
     public:
-        EPuckHandler() { }
+        EPuckHandler();
         virtual ~EPuckHandler() { }
         
         //! Robot factory method
@@ -31,31 +31,58 @@ namespace Enki
             Keeps a pointer to the created robot, but does not
             delete it in the destructor.
 
-            \return Returns the name of the created robot.
+            \arg handle Handle interned for the robot name by the world.
+            \return False if the robot was not created, because an
+                    object with that handle already exists.
 
          */
-        virtual std::string createObject(const std::string& data,
-                                         World* world);
+        virtual bool createObject(const AssisiMsg::Spawn& spawn,
+                                  ObjectHandle handle,
+                                  WorldExt* world);
+
+        //! Validate incoming message
+        virtual bool parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const;
 
         //! Handle incoming message
         /*! Handles E-Puck motion commands.
 
          */
-        virtual int handleIncoming(const std::string& name,
-                                   const std::string& device,
-                                   const std::string& command,
-                                   const std::string& data);
+        virtual int handleIncoming(const Command& command);
+
+        //! Copy E-Puck sensor data.
+        virtual int snapshotOutgoing(double from, double to);
+
+        virtual void swapOutgoing();
+
+        virtual unsigned long droppedOutgoing() const;
 
         //! Assemble outgoing messages
         /*! Sends E-Puck sensor data messages.
          */
         virtual int sendOutgoing(zmq::socket_t& socket);
 
-        virtual PhysicalObject* getObject(const std::string& name);
+        virtual PhysicalObject* getObject(ObjectHandle handle);
 
     private:
-        typedef std::map<std::string, EPuck*> EPuckMap;
-        EPuckMap epucks_;
+        ObjectIndex<EPuck> epucks_;
+
+        //! E-Puck devices, also used as publish schedule indices.
+        enum Device
+        {
+            BASE,
+            IR
+        };
+
+        //! Outgoing IR ranges of one E-Puck.
+        struct Sample
+        {
+            std::string name;
+            double ranges[8];
+        };
+        OutgoingBuffer<Sample> outgoing_;
     };
 
 }
@@ -0,0 +1,107 @@
+/*
+
+ */
+
+#include "handlers/NameTable.h"
+
+namespace Enki
+{
+
+    // Initial number of hash table slots, must be a power of two.
+    static const std::size_t INITIAL_SLOTS = 64;
+
+// -----------------------------------------------------------------------------
+
+    NameTable::NameTable()
+        : slots_(INITIAL_SLOTS, NO_HANDLE)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    ObjectHandle NameTable::find(const std::string& name) const
+    {
+        return slots_[probe_(name, hash_(name))];
+    }
+
+// -----------------------------------------------------------------------------
+
+    ObjectHandle NameTable::intern(const std::string& name)
+    {
+        std::size_t hash = hash_(name);
+        std::size_t slot = probe_(name, hash);
+        if (slots_[slot] != NO_HANDLE)
+        {
+            return slots_[slot];
+        }
+
+        ObjectHandle handle = names_.size();
+        names_.push_back(name);
+        hashes_.push_back(hash);
+        slots_[slot] = handle;
+
+        // Keep the load factor below one half
+        if (2 * names_.size() > slots_.size())
+        {
+            grow_();
+        }
+        return handle;
+    }
+
+// -----------------------------------------------------------------------------
+
+    std::size_t NameTable::probe_(const std::string& name, std::size_t hash) const
+    {
+        std::size_t mask = slots_.size() - 1;
+        std::size_t slot = hash & mask;
+        while (slots_[slot] != NO_HANDLE)
+        {
+            ObjectHandle handle = slots_[slot];
+            if (hashes_[handle] == hash && names_[handle] == name)
+            {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void NameTable::grow_()
+    {
+        slots_.assign(2 * slots_.size(), NO_HANDLE);
+        std::size_t mask = slots_.size() - 1;
+        for (ObjectHandle handle = 0; handle < names_.size(); handle++)
+        {
+            std::size_t slot = hashes_[handle] & mask;
+            while (slots_[slot] != NO_HANDLE)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = handle;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    std::size_t NameTable::hash_(const std::string& name)
+    {
+        // 32 bit FNV-1a
+        unsigned int hash = 2166136261u;
+        for (std::size_t i = 0; i < name.size(); i++)
+        {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
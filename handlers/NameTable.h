@@ -0,0 +1,71 @@
+/*! \file  NameTable.h
+    \brief Interning of object names into dense integer handles.
+
+ */
+
+#ifndef ENKI_NAME_TABLE_H
+#define ENKI_NAME_TABLE_H
+
+#include <string>
+#include <vector>
+
+namespace Enki
+{
+
+    //! Dense integer handle of a named object.
+    typedef unsigned int ObjectHandle;
+
+    //! Value returned for names that have not been interned.
+    static const ObjectHandle NO_HANDLE = ~0u;
+
+    //! Maps names to dense handles, 0, 1, 2, ... in order of interning.
+    /*! Lookups use an open-addressing hash table with linear probing,
+        so a lookup hashes the name once and usually compares a single
+        string. Names are never removed.
+     */
+    class NameTable
+    {
+    public:
+        NameTable();
+
+        //! Handle of the given name, or NO_HANDLE if it was not interned.
+        ObjectHandle find(const std::string& name) const;
+
+        //! Handle of the given name, interning it if necessary.
+        ObjectHandle intern(const std::string& name);
+
+        //! Name of an interned handle.
+        const std::string& name(ObjectHandle handle) const
+        {
+            return names_[handle];
+        }
+
+        //! Number of interned names.
+        std::size_t size() const
+        {
+            return names_.size();
+        }
+
+    private:
+        //! Slot where name is stored, or the empty slot where it would go.
+        std::size_t probe_(const std::string& name, std::size_t hash) const;
+
+        //! Double the number of slots and reinsert all names.
+        void grow_();
+
+        static std::size_t hash_(const std::string& name);
+
+        std::vector<std::string> names_;
+        std::vector<std::size_t> hashes_;
+        // Hash table slots, holding handles or NO_HANDLE.
+        // The number of slots is a power of two.
+        std::vector<ObjectHandle> slots_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -6,16 +6,53 @@
 #ifndef ENKI_OBJECT_HANDLER_H
 #define ENKI_OBJECT_HANDLER_H
 
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message.h>
+
+#include "handlers/NameTable.h"
+#include "handlers/PublishSchedule.h"
 
 namespace zmq
 {
     class socket_t;
 }
 
+namespace AssisiMsg
+{
+    class Spawn;
+}
+
 namespace Enki
 {
     class WorldExt;
     class PhysicalObject;
+    class ObjectHandler;
+
+    //! An incoming message, parsed and validated by the I/O thread.
+    /*! Device and command are resolved to small integers, whose
+        meaning is defined by the handler (or by WorldExt for
+        simulation commands), so dispatching them is a switch.
+     */
+    struct Command
+    {
+        Command() : handler(0), handle(NO_HANDLE), device(-1), command(-1), payload(0), frames(0) { }
+        ~Command() { delete payload; delete frames; }
+
+        //! Handler of the addressed object, or 0 for simulation commands.
+        ObjectHandler* handler;
+        //! Addressed object.
+        ObjectHandle handle;
+        int device;
+        int command;
+        //! Text argument, used by simulation commands that take one.
+        std::string argument;
+        //! Parsed message data, or 0 if the command carries no data.
+        google::protobuf::Message* payload;
+        //! Encoded message frames, only kept while commands are captured.
+        std::string* frames;
+    };
     
     //! Abstract base class, defines the message-handling interface for Enki
     /*! Users should implement their own message handling according for each robot type.
@@ -31,38 +68,160 @@ namespace Enki
         /*! Override this method to create the appropriate
             object type.
 
+            \arg handle Handle interned for the object name by
+                        the world; the object is addressed by it
+                        from now on.
+            \return False if the object could not be created.
+         */
+        virtual bool createObject(const AssisiMsg::Spawn& spawn,
+                                  ObjectHandle handle,
+                                  WorldExt* world) = 0;
+
+        //! Create several objects of this type at once
+        /*! Called for the records of a SpawnBatch command. The
+            default implementation calls createObject for each record;
+            override it when the objects of a batch share work, such
+            as drawing into the world grids.
+
+            \arg handles Handles interned for the spawn names, in the
+                         same order as spawns.
+            \return Number of objects created.
          */
-        virtual std::string createObject(const std::string& data,
-                                         WorldExt* world) = 0;
+        virtual int createObjects(const std::vector<const AssisiMsg::Spawn*>& spawns,
+                                  const std::vector<ObjectHandle>& handles,
+                                  WorldExt* world)
+        {
+            int count = 0;
+            for (std::size_t i = 0; i < spawns.size(); i++)
+            {
+                if (createObject(*spawns[i], handles[i], world))
+                {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        //! Parse an incoming message
+        /*! Override this method to validate the commands of your
+            particular object. It is called from the I/O thread,
+            so it must not access the handled objects.
+
+            \arg parsed Its device, command and payload fields should
+                        be set. The payload is left at 0 if the
+                        command does not carry data.
+            \return False if the device or command is unknown,
+                    or if the data is not a valid message.
+         */
+        virtual bool parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const = 0;
 
         //! Handle incoming message
         /*! Override this method to handle incoming messages
-            for your particular object.
+            for your particular object. Called from the simulation
+            thread with a command produced by parseIncoming.
 
-            \arg sock The socket containing the message to be handled.
-                      It's a 0MQ multipart message, with the 
-                      first part(s) peeled off.
+         */
+        virtual int handleIncoming(const Command& command) = 0;
+
+        //! Take a snapshot of the outgoing data.
+        /*! Override this method to copy the sensor values, setpoints
+            and poses of your particular object into a buffer. It is
+            called from the simulation thread, and should do as little
+            work as possible; serialization happens in sendOutgoing.
 
+            Only the devices that are due according to the publish
+            schedule in the simulation time step (from, to] should
+            be copied.
+
+            \arg from Simulation time at the start of the step.
+            \arg to   Simulation time at the end of the step.
+            \return Number of samples added to the buffer.
          */
-        virtual int handleIncoming(const std::string& name,
-                                   const std::string& device,
-                                   const std::string& command,
-                                   const std::string& data) = 0;
+        virtual int snapshotOutgoing(double from, double to) = 0;
+
+        //! Hand the snapshots taken so far over to sendOutgoing.
+        /*! Called while neither snapshotOutgoing nor sendOutgoing run.
+         */
+        virtual void swapOutgoing() = 0;
+
+        //! Number of snapshot samples dropped so far.
+        /*! Samples are dropped, oldest first, when the publisher falls
+            so far behind that the snapshots reach the buffer limit.
+         */
+        virtual unsigned long droppedOutgoing() const = 0;
 
         //! Send outgoing messages.
-        /*! Override this method to send outgoing messages 
-            for your particular object.
+        /*! Override this method to serialize and send the snapshots
+            handed over by the last swapOutgoing. It is called from
+            the publisher thread, so it must not access the handled
+            objects.
 
             \arg sock Outgoing messages are written to socket sock.
             
          */
         virtual int sendOutgoing(zmq::socket_t& socket) = 0;
 
-        //! Get object by name.
-        /*! Returns pointer to the handled object "name", if it exists.
+        //! Get object by handle.
+        /*! Returns pointer to the handled object, if it exists.
             Returns 0 otherwise.
          */
-        virtual PhysicalObject* getObject(const std::string& name) = 0;
+        virtual PhysicalObject* getObject(ObjectHandle handle) = 0;
+
+        //! Whether an object with this handle exists.
+        /*! Override it together with teleportObject when some
+            objects of this type are not Enki objects.
+         */
+        virtual bool hasObject(ObjectHandle handle)
+        {
+            return getObject(handle) != 0;
+        }
+
+        //! Move an object that getObject does not return.
+        /*! \return False if there is no such object.
+         */
+        virtual bool teleportObject(ObjectHandle handle,
+                                    double x, double y, double yaw)
+        {
+            return false;
+        }
+
+        //! Publish periods of the devices of this object type.
+        PublishSchedule& getPublishSchedule() { return schedule_; }
+
+    protected:
+        //! Parse data into a new message of type T.
+        template<class T>
+        static bool parsePayload(const std::string& data,
+                                 google::protobuf::Message*& payload)
+        {
+            T* msg = new T;
+            if (!msg->ParseFromString(data))
+            {
+                delete msg;
+                return false;
+            }
+            payload = msg;
+            return true;
+        }
+
+        //! Index of name in an array of count names, or -1.
+        static int lookup(const char* const names[], int count,
+                          const std::string& name)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (name == names[i])
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        PublishSchedule schedule_;
     };
 
 }
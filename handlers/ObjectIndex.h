@@ -0,0 +1,101 @@
+/*! \file  ObjectIndex.h
+    \brief Objects of a handler, indexed by their handles.
+
+ */
+
+#ifndef ENKI_OBJECT_INDEX_H
+#define ENKI_OBJECT_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include "handlers/NameTable.h"
+
+namespace Enki
+{
+
+    //! The objects of one handler, addressable by handle.
+    /*! Handles are shared by all handlers, so the index from handle
+        to object is a vector with holes for the objects of other
+        handlers. The objects themselves are kept in a dense vector,
+        in order of creation, for iteration.
+     */
+    template<class T>
+    class ObjectIndex
+    {
+    public:
+        struct Entry
+        {
+            ObjectHandle handle;
+            std::string name;
+            T* object;
+        };
+        typedef std::vector<Entry> Entries;
+
+        //! Add an object.
+        /*! \return False if there is already an object with this handle.
+         */
+        bool add(ObjectHandle handle, const std::string& name, T* object)
+        {
+            if (get(handle) != 0)
+            {
+                return false;
+            }
+            if (handle >= index_.size())
+            {
+                index_.resize(handle + 1, NOT_HERE);
+            }
+            index_[handle] = entries_.size();
+            Entry entry;
+            entry.handle = handle;
+            entry.name = name;
+            entry.object = object;
+            entries_.push_back(entry);
+            return true;
+        }
+
+        //! Object with the given handle, or 0 if it is not in this index.
+        T* get(ObjectHandle handle) const
+        {
+            if (handle < index_.size() && index_[handle] != NOT_HERE)
+            {
+                return entries_[index_[handle]].object;
+            }
+            return 0;
+        }
+
+        //! Position in entries() of the object with the given handle.
+        /*! \return entries().size() if it is not in this index.
+         */
+        std::size_t position(ObjectHandle handle) const
+        {
+            if (handle < index_.size() && index_[handle] != NOT_HERE)
+            {
+                return index_[handle];
+            }
+            return entries_.size();
+        }
+
+        //! All objects, in order of creation.
+        const Entries& entries() const
+        {
+            return entries_;
+        }
+
+    private:
+        static const std::size_t NOT_HERE = ~std::size_t(0);
+
+        std::vector<std::size_t> index_;
+        Entries entries_;
+    };
+
+    template<class T>
+    const std::size_t ObjectIndex<T>::NOT_HERE;
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
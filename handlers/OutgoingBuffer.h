@@ -0,0 +1,117 @@
+/*! \file  OutgoingBuffer.h
+    \brief Double buffer of samples waiting to be published.
+
+ */
+
+#ifndef ENKI_OUTGOING_BUFFER_H
+#define ENKI_OUTGOING_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Enki
+{
+
+    //! Double buffer of samples to publish.
+    /*! The simulation thread adds samples to the back buffer, while
+        the publisher thread reads the front buffer. swap() exchanges
+        them and must only be called while the publisher thread is idle.
+
+        Sample slots are reused, so samples holding vectors keep their
+        capacity and the steady state does not allocate.
+
+        While the publisher thread is busy the back buffer keeps
+        growing. It holds at most limit samples; past that, each new
+        sample replaces the oldest one, and dropped() counts them.
+     */
+    template<class T>
+    class OutgoingBuffer
+    {
+    public:
+        //! Default number of samples the back buffer can hold.
+        static const std::size_t DEFAULT_LIMIT = 65536;
+
+        explicit OutgoingBuffer(std::size_t limit = DEFAULT_LIMIT)
+            : limit_(limit > 0 ? limit : 1), back_(0), dropped_(0)
+        {
+            size_[0] = size_[1] = 0;
+            start_[0] = start_[1] = 0;
+        }
+
+        //! Append a sample to the back buffer and return it.
+        /*! The returned slot may hold values of an older sample. If
+            the back buffer is full, it is the slot of the oldest
+            sample, which is dropped.
+         */
+        T& add()
+        {
+            std::vector<T>& back = buffers_[back_];
+            if (size_[back_] == limit_)
+            {
+                T& oldest = back[start_[back_]];
+                start_[back_] = (start_[back_] + 1) % limit_;
+                dropped_++;
+                return oldest;
+            }
+            if (size_[back_] == back.size())
+            {
+                back.push_back(T());
+            }
+            return back[size_[back_]++];
+        }
+
+        //! Number of samples in the back buffer.
+        std::size_t pending() const
+        {
+            return size_[back_];
+        }
+
+        //! Number of samples dropped because the back buffer was full.
+        unsigned long dropped() const
+        {
+            return dropped_;
+        }
+
+        //! Make the back buffer the front buffer and empty the new back.
+        void swap()
+        {
+            back_ = 1 - back_;
+            size_[back_] = 0;
+            start_[back_] = 0;
+        }
+
+        //! Number of samples in the front buffer.
+        std::size_t size() const
+        {
+            return size_[1 - back_];
+        }
+
+        //! Sample of the front buffer, from the oldest one.
+        const T& operator[](std::size_t i) const
+        {
+            const int front = 1 - back_;
+            std::size_t j = start_[front] + i;
+            if (j >= limit_)
+            {
+                j -= limit_;
+            }
+            return buffers_[front][j];
+        }
+
+    private:
+        std::size_t limit_;
+        std::vector<T> buffers_[2];
+        std::size_t size_[2];
+        // Index of the oldest sample, moved once the buffer is full
+        std::size_t start_[2];
+        int back_;
+        unsigned long dropped_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
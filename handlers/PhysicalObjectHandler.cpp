@@ -28,92 +28,143 @@ using namespace AssisiMsg;
 namespace Enki
 {
 
+// -----------------------------------------------------------------------------
+
+    PhysicalObjectHandler::PhysicalObjectHandler()
+    {
+        pos_device_ = schedule_.addDevice("Pos");
+    }
+
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    string PhysicalObjectHandler::createObject(const std::string& data, 
-                                     WorldExt* world)
+    bool PhysicalObjectHandler::createObject(const Spawn& msg, 
+                                             ObjectHandle handle,
+                                             WorldExt* world)
     {
-        string name = "";
-        Spawn msg;     
-        assert(msg.ParseFromString(data));
-        if (objects_.count(msg.name()) < 1)
+        if (objects_.get(handle) != 0)
         {
-            name = msg.name();
-            Point pos(msg.pose().position().x(),
-                      msg.pose().position().y());
-            double yaw(msg.pose().orientation().z());
-            objects_[name] = new PhysicalObject;
-            objects_[name]->pos = pos;
-            objects_[name]->angle = yaw;
-            if (msg.has_color())
-            {
-                objects_[name]->setColor(Color(msg.color().red(),
-                                               msg.color().green(),
-                                               msg.color().blue()));
-            }
-            if (msg.type() == "Cylinder")
-            {
-                objects_[name]->setCylindric(msg.cylinder().radius(),
-                                             msg.cylinder().height(),
-                                             msg.cylinder().mass());
-                world->addObject(objects_[name]);
-            }
-            else if (msg.type() == "Polygon")
-            {
-                Polygone p;
-                for (int i = 0; i < msg.polygon().vertices_size(); i++)
-                {
-                    p.push_back(Point(msg.polygon().vertices(i).x(),
-                                      msg.polygon().vertices(i).y()));
-                }
-                PhysicalObject::Hull hull(PhysicalObject::Part(p, msg.polygon().height()));
-                objects_[name]->setCustomHull(hull, msg.polygon().mass());
-                world->addObject(objects_[name]);
-            }
-            else
+            cerr << "Object "<< msg.name() << " already exists." << endl;
+            return false;
+        }
+
+        Point pos(msg.pose().position().x(),
+                  msg.pose().position().y());
+        double yaw(msg.pose().orientation().z());
+        PhysicalObject* object = new PhysicalObject;
+        object->pos = pos;
+        object->angle = yaw;
+        if (msg.has_color())
+        {
+            object->setColor(Color(msg.color().red(),
+                                   msg.color().green(),
+                                   msg.color().blue()));
+        }
+        if (msg.type() == "Cylinder")
+        {
+            object->setCylindric(msg.cylinder().radius(),
+                                 msg.cylinder().height(),
+                                 msg.cylinder().mass());
+        }
+        else if (msg.type() == "Polygon")
+        {
+            Polygone p;
+            for (int i = 0; i < msg.polygon().vertices_size(); i++)
             {
-                cerr << "Unknown object type: " << msg.type() << endl;
-                delete objects_[name];
-                objects_.erase(name);
+                p.push_back(Point(msg.polygon().vertices(i).x(),
+                                  msg.polygon().vertices(i).y()));
             }
+            PhysicalObject::Hull hull(PhysicalObject::Part(p, msg.polygon().height()));
+            object->setCustomHull(hull, msg.polygon().mass());
         }
         else
         {
-            cerr << "Object "<< msg.name() << " already exists." << endl;
+            cerr << "Unknown object type: " << msg.type() << endl;
+            delete object;
+            return false;
         }
-        return name;
+        objects_.add(handle, msg.name(), object);
+        schedule_.addObject(handle);
+        world->addObject(object);
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    bool PhysicalObjectHandler::parseIncoming(const std::string& device,
+                                              const std::string& command,
+                                              const std::string& data,
+                                              Command& parsed) const
+    {
+        // Physical objects do not accept commands
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    int PhysicalObjectHandler::handleIncoming(const Command& command)
+    {
+        return 0;
     }
 
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    int PhysicalObjectHandler::handleIncoming(const std::string& name,
-                                    const std::string& device,
-                                    const std::string& command,
-                                    const std::string& data)
+    int PhysicalObjectHandler::snapshotOutgoing(double from, double to)
     {
         int count = 0;
+        BOOST_FOREACH(const ObjectIndex<PhysicalObject>::Entry& ca, objects_.entries())
+        {
+            if (!schedule_.isDue(ca.handle, pos_device_, from, to))
+            {
+                continue;
+            }
 
+            Sample& sample = outgoing_.add();
+            sample.name = ca.name;
+            sample.x = ca.object->pos.x;
+            sample.y = ca.object->pos.y;
+            sample.yaw = ca.object->angle;
+            count++;
+        }
         return count;
     }
 
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void PhysicalObjectHandler::swapOutgoing()
+    {
+        outgoing_.swap();
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    unsigned long PhysicalObjectHandler::droppedOutgoing() const
+    {
+        return outgoing_.dropped();
+    }
+
 // -----------------------------------------------------------------------------
 
     /* virtual */
     int PhysicalObjectHandler::sendOutgoing(socket_t& socket)
     {
         int count = 0;
-        BOOST_FOREACH(const ObjectMap::value_type& ca, objects_)
+        for (size_t i = 0; i < outgoing_.size(); i++)
         {
+            const Sample& sample = outgoing_[i];
             std::string data;
 
             PoseStamped pose;
-            pose.mutable_pose()->mutable_position()->set_x(ca.second->pos.x);
-            pose.mutable_pose()->mutable_position()->set_y(ca.second->pos.y);
-            pose.mutable_pose()->mutable_orientation()->set_z(ca.second->angle);
+            pose.mutable_pose()->mutable_position()->set_x(sample.x);
+            pose.mutable_pose()->mutable_position()->set_y(sample.y);
+            pose.mutable_pose()->mutable_orientation()->set_z(sample.yaw);
             pose.SerializeToString(&data);
-            zmq::send_multipart(socket, ca.first, "Pos", "Get", data);
+            zmq::send_multipart(socket, sample.name, "Pos", "Get", data);
 
             /* Publish other stuff as necessary ... */
 
@@ -124,16 +175,9 @@ namespace Enki
 // -----------------------------------------------------------------------------
 
     /* virtual */
-    PhysicalObject* PhysicalObjectHandler::getObject(const std::string& name)
+    PhysicalObject* PhysicalObjectHandler::getObject(ObjectHandle handle)
     {
-        if (objects_.count(name) > 0)
-        {
-            return objects_[name];
-        }
-        else
-        {
-            return 0;
-        }
+        return objects_.get(handle);
     }
 
 // -----------------------------------------------------------------------------
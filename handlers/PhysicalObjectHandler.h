@@ -10,9 +10,9 @@
 #ifndef ENKI_PHYSICAL_OBJECT_HANDLER_H
 #define ENKI_PHYSICAL_OBJECT_HANDLER_H
 
-#include <map>
-
 #include "handlers/ObjectHandler.h"
+#include "handlers/ObjectIndex.h"
+#include "handlers/OutgoingBuffer.h"
 
 namespace Enki
 {
@@ -27,7 +27,7 @@ namespace Enki
     class PhysicalObjectHandler : public ObjectHandler
     {
     public:
-        PhysicalObjectHandler() { }
+        PhysicalObjectHandler();
         virtual ~PhysicalObjectHandler() { }
 
         //! Casu factory method
@@ -36,18 +36,32 @@ namespace Enki
           Keeps a pointer to the created object, but does not
           delete it in the destructor.
 
-          \return Returns the name of the created object.
+          \arg handle Handle interned for the object name by the world.
+          \return False if the object was not created, because an
+                  object with that handle already exists or the type is unknown.
         */
-        virtual std::string createObject(const std::string& data, WorldExt* world);
+        virtual bool createObject(const AssisiMsg::Spawn& spawn,
+                                  ObjectHandle handle,
+                                  WorldExt* world);
+
+        //! Validate incoming message
+        virtual bool parseIncoming(const std::string& device,
+                                   const std::string& command,
+                                   const std::string& data,
+                                   Command& parsed) const;
 
         //! Handle incoming message
         /*! Handles casu actuator commands.
 
          */
-        virtual int handleIncoming(const std::string& name,
-                                   const std::string& device,
-                                   const std::string& command,
-                                   const std::string& data);
+        virtual int handleIncoming(const Command& command);
+
+        //! Copy object poses.
+        virtual int snapshotOutgoing(double from, double to);
+
+        virtual void swapOutgoing();
+
+        virtual unsigned long droppedOutgoing() const;
 
         //! Assemble outgoing messages.
         /*! Sends CASU sensor data messages.
@@ -55,11 +69,21 @@ namespace Enki
          */
         virtual int sendOutgoing(zmq::socket_t& socket);
 
-        virtual PhysicalObject* getObject(const std::string& name);
+        virtual PhysicalObject* getObject(ObjectHandle handle);
 
     private:
-        typedef std::map<std::string, PhysicalObject*> ObjectMap;
-        ObjectMap objects_;
+        ObjectIndex<PhysicalObject> objects_;
+
+        //! Index of the pose device in the publish schedule.
+        int pos_device_;
+
+        //! Outgoing pose of one object.
+        struct Sample
+        {
+            std::string name;
+            double x, y, yaw;
+        };
+        OutgoingBuffer<Sample> outgoing_;
     };
 }
 
@@ -0,0 +1,101 @@
+/*
+
+ */
+
+#include <cmath>
+
+#include "handlers/PublishSchedule.h"
+
+namespace Enki
+{
+
+    // Fractional part of the golden ratio. Multiples of it modulo one
+    // are spread as evenly as possible over [0, 1).
+    static const double GOLDEN_FRACTION = 0.6180339887498949;
+
+// -----------------------------------------------------------------------------
+
+    PublishSchedule::PublishSchedule(double period)
+        : period_(period), objects_(0)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    int PublishSchedule::addDevice(const std::string& device)
+    {
+        devices_.push_back(device);
+        periods_.push_back(period_);
+        explicit_.push_back(false);
+        return devices_.size() - 1;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void PublishSchedule::setPeriod(double period)
+    {
+        period_ = period;
+        for (std::size_t i = 0; i < periods_.size(); i++)
+        {
+            if (!explicit_[i])
+            {
+                periods_[i] = period;
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool PublishSchedule::setPeriod(const std::string& device, double period)
+    {
+        for (std::size_t i = 0; i < devices_.size(); i++)
+        {
+            if (devices_[i] == device)
+            {
+                periods_[i] = period;
+                explicit_[i] = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    double PublishSchedule::addObject(ObjectHandle handle)
+    {
+        double phase = objects_ * GOLDEN_FRACTION;
+        phase -= std::floor(phase);
+        if (handle >= phases_.size())
+        {
+            phases_.resize(handle + 1, 0.0);
+        }
+        phases_[handle] = phase;
+        objects_++;
+        return phase;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    bool PublishSchedule::isDue(double period, double phase,
+                                double from, double to)
+    {
+        if (period < 0.0)
+        {
+            return false;
+        }
+        if (period == 0.0)
+        {
+            return true;
+        }
+        return std::floor(to / period + phase) > std::floor(from / period + phase);
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,94 @@
+/*! \file  PublishSchedule.h
+    \brief Per-device publish periods with staggered phases.
+
+ */
+
+#ifndef ENKI_PUBLISH_SCHEDULE_H
+#define ENKI_PUBLISH_SCHEDULE_H
+
+#include <string>
+#include <vector>
+
+#include "handlers/NameTable.h"
+
+namespace Enki
+{
+
+    //! Decides when the sensor data of a device should be published.
+    /*! Every device has a publish period, either set explicitly or
+        inherited from the handler default. Publish instants are
+        multiples of the period on the simulation clock, shifted by a
+        per-object phase offset. The offsets follow the golden ratio
+        sequence, so the objects of a large swarm are spread evenly
+        over the period instead of all publishing on the same step.
+
+        The schedule is stateless with respect to time: a device is
+        due in the step (from, to] if a publish instant falls inside
+        it. This way publish times are derived from the simulation
+        clock and do not accumulate drift.
+
+        Devices are identified by the index returned by addDevice,
+        objects by their handle.
+     */
+    class PublishSchedule
+    {
+    public:
+        //! Create a schedule where all devices use the given period.
+        PublishSchedule(double period = 0.3);
+
+        //! Register a device name.
+        /*! \return The device index, devices are numbered from 0
+                    in order of registration.
+         */
+        int addDevice(const std::string& device);
+
+        //! Set the default period, used by devices without their own.
+        void setPeriod(double period);
+
+        //! Set the publish period of a device.
+        /*! A period of zero means the device is published in every step,
+            a negative period disables publishing of the device.
+
+            \return False if the device was not registered.
+         */
+        bool setPeriod(const std::string& device, double period);
+
+        //! Publish period of the given device.
+        double getPeriod(int device) const
+        {
+            return periods_[device];
+        }
+
+        //! Register an object and assign its phase offset.
+        /*! \return The phase offset, as a fraction of the period.
+         */
+        double addObject(ObjectHandle handle);
+
+        //! Check if a device of an object should publish in step (from, to].
+        bool isDue(ObjectHandle handle, int device, double from, double to) const
+        {
+            return isDue(periods_[device], phases_[handle], from, to);
+        }
+
+        //! Check if there is a publish instant in step (from, to].
+        /*! Publish instants are (k - phase) * period, for integer k.
+         */
+        static bool isDue(double period, double phase, double from, double to);
+
+    private:
+        double period_;
+        std::vector<std::string> devices_;
+        std::vector<double> periods_;
+        // Whether the period of a device was set explicitly
+        std::vector<bool> explicit_;
+        std::vector<double> phases_;
+        unsigned int objects_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
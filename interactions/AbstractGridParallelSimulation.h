@@ -7,6 +7,7 @@
 
 #include "interactions/AbstractGridSimulation.h"
 #include "extensions/ExtendedWorld.h"
+#include "extensions/Trace.h"
 
 namespace Enki
 {
@@ -24,6 +25,10 @@ namespace Enki
 	 * for the signal from the main thread.  Also the main thread must wait
 	 * for the worker threads to finish updating their rectangular blocks.
 	 *
+	 * <p> With a parallelism level of zero no worker thread is created:
+	 * the whole grid is updated by the main thread.  Worker threads are
+	 * stopped and joined when the grid is destroyed.
+	 *
 	 * <p> Template {@code class G} should be a specialisation of this class
 	 * and should provide a method with the following signature: {@code void
 	 * update(double deltaTime, int xmin, int ymin, int xmax, int ymax)}.
@@ -102,9 +107,14 @@ namespace Enki
 			 */
 			boost::interprocess::interprocess_semaphore *fine;
 			/**
-			 * The thread that is using this thread information and state.
+			 * The thread that is using this thread information and state,
+			 * or {@code NULL} if the block is updated by the main thread.
 			 */
 			boost::thread *thread;
+			/**
+			 * Whether the worker thread should exit when it is woken up.
+			 */
+			bool stop;
 			/**
 			 * Construct a new worker thread information.
 			 */
@@ -115,7 +125,9 @@ namespace Enki
 				ymax (processBorder (ags->size.y, borderFlag, ags->size.x > ags->size.y  ?  ags->size.y  : (index + 1) * ags->size.y / howMany)),
 				grid (ags),
 				wait (0),
-				fine (fine)
+				fine (fine),
+				thread (NULL),
+				stop (false)
 			{
 			}
 		};
@@ -137,7 +149,12 @@ namespace Enki
 		{
 			while (true) {
 				threadState->wait.wait ();
+				if (threadState->stop) {
+					return ;
+				}
+				ASSISI_TRACE_BEGIN ("AbstractGridParallelSimulation::updateGrid");
 				threadState->grid->updateGrid (threadState->deltaTime, threadState->xmin, threadState->ymin, threadState->xmax, threadState->ymax);
+				ASSISI_TRACE_END ("AbstractGridParallelSimulation::updateGrid");
 				threadState->fine->post ();
 			}
 		}
@@ -175,18 +192,28 @@ namespace Enki
 			this->initFields (parallelismLevel, grid, borderFlag);
 		}
 		/**
-		 * Destructor.
-		 *
-		 * TODO: stop threads.
+		 * Destructor.  Stop and join the worker threads.
 		 */
-		virtual ~AbstractGridParallelSimulation () {}
+		virtual ~AbstractGridParallelSimulation ()
+		{
+			BOOST_FOREACH (ThreadState *threadState, this->threadsState) {
+				if (threadState->thread != NULL) {
+					threadState->stop = true;
+					threadState->wait.post ();
+					threadState->thread->join ();
+					delete threadState->thread;
+				}
+				delete threadState;
+			}
+			delete this->fine;
+		}
 
 	public:
 		/**
-		 * Return the number of threads that are created for the given
+		 * Return the number of blocks the grid is divided in for the given
 		 * concurrency level.  A value of zero means no concurrency: there is
-		 * only one thread.  A value of one means take advantage of all
-		 * available CPU multi threading capabilities.
+		 * only one block, updated by the main thread.  A value of one means
+		 * take advantage of all available CPU multi threading capabilities.
 		 *
 		 * @param parallelismLevel The parallelism level to be used.
 		 */
@@ -208,10 +235,14 @@ namespace Enki
 		{
 			const unsigned int numberThreads = AbstractGridParallelSimulation::numberThreads (parallelismLevel);
 			this->fine = new boost::interprocess::interprocess_semaphore (0);
+			if (parallelismLevel <= 0) {
+				this->threadsState.push_back (new ThreadState (grid, borderFlag, 0, 1, this->fine));
+				return ;
+			}
 			int i = numberThreads - 1;
 			this->threadsState.reserve (numberThreads);
 			while (i >= 0) {
-				std::cout << "Created thread " << (numberThreads - i) << " of " << numberThreads << '\n';
+				std::cerr << "Created thread " << (numberThreads - i) << " of " << numberThreads << '\n';
 				ThreadState *threadState = new ThreadState (grid, borderFlag, i, numberThreads, this->fine);
 				threadState->thread = new boost::thread (AbstractGridParallelSimulation::updatePartialGrid, threadState);
 				this->threadsState.push_back (threadState);
@@ -221,12 +252,20 @@ namespace Enki
 	protected:
 		/**
 		 * Updates the grid cells.  Wake up all the worker threads and wait
-		 * for them to finish updating their respective rectangular block.
-		 * After that we update field {@code adtIndex}.
+		 * for them to finish updating their respective rectangular block,
+		 * or update the whole grid if there are no worker threads.  After
+		 * that we update field {@code adtIndex}.
 		 */
 		void updateState (double deltaTime)
 		{
 			int nextAdtIndex = 1 - this->adtIndex;
+			if (this->threadsState.front ()->thread == NULL) {
+				// serial grid, updated by this thread
+				ThreadState *threadState = this->threadsState.front ();
+				threadState->grid->updateGrid (deltaTime, threadState->xmin, threadState->ymin, threadState->xmax, threadState->ymax);
+				this->adtIndex = nextAdtIndex;
+				return ;
+			}
 			// wake up working threads
 			BOOST_FOREACH (ThreadState *threadState, this->threadsState) {
 				threadState->deltaTime = deltaTime;
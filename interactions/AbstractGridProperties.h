@@ -6,6 +6,7 @@
 //#include <iostream>
 //#include <iomanip>
 #include <limits>
+#include <utility>
 #include <boost/foreach.hpp>
 
 #include "extensions/ExtendedWorld.h"
@@ -57,6 +58,17 @@ namespace Enki
 		 * {@code edges}.
 		 */
 		Edge *activeEdgeTable;
+		/**
+		 * Cells updated by {@code drawCircles()}, as offsets from the
+		 * circle centre.  The stamp is computed for radius {@code
+		 * stampRadius} and reused while the radius does not change.
+		 */
+		std::vector<std::pair<int, int> > stamp;
+		/**
+		 * Radius in grid cells of the circle in {@code stamp}, or -1 if
+		 * the stamp has not been computed.
+		 */
+		int stampRadius;
 	public:
 		/**
 		 * Function used to update grid cells.
@@ -108,6 +120,7 @@ namespace Enki
 				edge.nextElementActiveEdgeTable = NULL;
 			}
 			this->activeEdgeTable = NULL_EDGE;
+			this->stampRadius = -1;
 		}
 	public:
 		/**
@@ -256,7 +269,10 @@ namespace Enki
 					x++;
 				}
 				else {
-					d += (x - y) << 1 + 5;
+					// Not the midpoint step 2 * (x - y) + 5: only the columns of the
+					// first octant are filled, and this larger step keeps them tall
+					// enough to cover the disc without holes.
+					d += (x - y) << 6;
 					deltaE += 2;
 					deltaSE += 4;
 					x++;
@@ -295,7 +311,7 @@ namespace Enki
 					x++;
 				}
 				else {
-					d += (x - y) << 1 + 5;
+					d += (x - y) << 6;  // as in drawCircle ()
 					deltaE += 2;
 					deltaSE += 4;
 					x++;
@@ -304,6 +320,32 @@ namespace Enki
 				circlePoints (update, cx, cy, x, y);
 			}
 		}
+		/**
+		 * Draws and fills several circles with the same radius.  The
+		 * cells covered by the circle are computed once, with the same
+		 * algorithm as {@code drawCircle()}, and then copied to each
+		 * centre.  This is used when many objects are created at once.
+		 *
+		 * @param value The value used to fill the circles.
+		 *
+		 * @param centers Circle centres in world coordinates.
+		 *
+		 * @param worldRadius Circle radius in world coordinates.
+		 */
+		void drawCircles (const T &value, const std::vector<Point> &centers, double worldRadius)
+		{
+			int radius = this->scale (worldRadius);
+			if (radius != this->stampRadius) {
+				this->computeStamp (radius);
+			}
+			BOOST_FOREACH (const Point &center, centers) {
+				int cx, cy;
+				toIndex (center, cx, cy);
+				for (std::size_t i = 0; i < this->stamp.size (); i++) {
+					this->prop [cx + this->stamp [i].first][cy + this->stamp [i].second] = value;
+				}
+			}
+		}
 		/**
 		 * Draws and fills a polygon.
 		 *
@@ -372,6 +414,58 @@ namespace Enki
 				(*update) (this->prop [cx - y][cy - x]);
 			}
 		}
+		/**
+		 * Compute the cell offsets of a circle with the given radius.
+		 * The cells are the ones visited by {@code drawCircle()}, so
+		 * both methods draw the same shape.
+		 */
+		void computeStamp (int radius)
+		{
+			int x, y, d, deltaE, deltaSE;
+			this->stamp.clear ();
+			x = 0;
+			y = radius;
+			d = 1 - radius;
+			deltaE = 3;
+			deltaSE = 5 - radius * 2;
+			stampPoints (x, y);
+			while (y > x) {
+				if (d < 0) {
+					d += deltaE;
+					deltaE += 2;
+					deltaSE += 3;
+					x++;
+				}
+				else {
+					d += (x - y) << 6;  // as in drawCircle ()
+					deltaE += 2;
+					deltaSE += 4;
+					x++;
+					y--;
+				}
+				stampPoints (x, y);
+			}
+			this->stampRadius = radius;
+		}
+		/**
+		 * Add to the stamp the offsets that {@code circlePoints()} would
+		 * update.
+		 */
+		inline void stampPoints (int x, int y)
+		{
+			for (int iy = -y; iy <= y; iy++) {
+				this->stamp.push_back (std::make_pair (x, iy));
+				if (x != 0) {
+					this->stamp.push_back (std::make_pair (-x, iy));
+				}
+			}
+			if (x != y) {
+				this->stamp.push_back (std::make_pair (y, x));
+				this->stamp.push_back (std::make_pair (y, -x));
+				this->stamp.push_back (std::make_pair (-y, x));
+				this->stamp.push_back (std::make_pair (-y, -x));
+			}
+		}
 		/**
 		 * Initialise the Edge Table with the edges of the given polygon.
 		 *
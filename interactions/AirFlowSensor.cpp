@@ -1,11 +1,14 @@
 #include "AirFlowSensor.h"
 #include "AirPump.h"
+#include "WorldStimulus.h"
 
 using namespace Enki;
 
 AirFlowSensor::AirFlowSensor (double range, Enki::Robot* owner, Enki::Vector relativePosition, double relativeOrientation):
 	LocalInteraction (range, owner),
-	Component (owner, relativePosition, relativeOrientation)
+	Component (owner, relativePosition, relativeOrientation),
+	mapSensed (false),
+	worldStimulus (NULL)
 {
 }
 
@@ -17,12 +20,24 @@ void AirFlowSensor::
 init (double dt, Enki::World* w)
 {
 	this->intensity = Vector (0, 0);
+	this->airFlowCouplings.rewind ();
 	Component::init ();
+	ExtendedWorld *world = dynamic_cast<ExtendedWorld *> (w);
+	this->mapSensed = world != NULL && world->worldStimulus != NULL;
+	if (this->mapSensed) {
+		this->worldStimulus = world->worldStimulus;
+		if (!this->deferReading (world)) {
+			this->evaluateReading ();
+		}
+	}
 }
 
 void AirFlowSensor::
 objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 {
+	if (this->mapSensed) {
+		return ;
+	}
 	AirPump *airPump = dynamic_cast<AirPump *>(po);
 	// Not an air pump
 	if (airPump == NULL) {
@@ -33,12 +48,32 @@ objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 		return ;
 	}
 
-	this->intensity += airPump->getAirFlowAt (this->absolutePosition);
+	if (this->isOwnerImmovable () && airPump->isOwnerImmovable ()) {
+		const Vector *coupling = this->airFlowCouplings.find (po, airPump->absolutePosition, this->absolutePosition);
+		if (coupling == NULL) {
+			coupling = this->airFlowCouplings.store (po, airPump->absolutePosition, this->absolutePosition, airPump->getAirFlowDirectionAt (this->absolutePosition));
+		}
+		this->intensity += airPump->getAirFlow (*coupling);
+	}
+	else {
+		this->intensity += airPump->getAirFlowAt (this->absolutePosition);
+	}
 }
 
 void AirFlowSensor::
 finalize (double dt, Enki::World* w)
 {
+	if (this->mapSensed) {
+		// already in the sensor frame, or not read yet
+		return ;
+	}
 	Matrix22 rot (-this->absoluteOrientation);
 	this->intensity = rot * this->intensity;
 }
+
+void AirFlowSensor::
+evaluateReading () const
+{
+	Matrix22 rot (-this->absoluteOrientation);
+	this->intensity = rot * this->worldStimulus->getAirFlowAt (this->absolutePosition, this->Component::owner);
+}
@@ -10,22 +10,26 @@
 
 #include <enki/Interaction.h>
 #include "Component.h"
+#include "extensions/DemandDrivenSensor.h"
+#include "extensions/StaticCouplings.h"
 
 namespace Enki {
 
+	class WorldStimulus;
+
 	/**
 	 * Simple implementation of an air flow sensor.  We add the intensity of all
 	 * air pumps within the radius of this sensor and the radius of the air pump.
 	 */
 	class AirFlowSensor:
 		public LocalInteraction,
-		public Component
+		public Component,
+		public DemandDrivenSensor
 	{
-	public:
 		/**
 		 * Air flow intensity measured by this sensor.
 		 */
-		Vector intensity;
+		mutable Vector intensity;
 	public:
 		/**
 		 * @param range Maximum distance an air pump can be in order to sense
@@ -45,11 +49,14 @@ namespace Enki {
 		 */
 		virtual ~AirFlowSensor ();
 		/**
-		 *  Reset air flow intensity.  Called every {@code w->step()}.
+		 *  Reset air flow intensity.  Called every {@code w->step()}.  If the
+		 *  world has an air flow map, the intensity is read from the map,
+		 *  when it is next read if the world senses on demand.
 		 */
 		virtual void init (double dt, Enki::World* w);
 		/**
-		 * Interact with the given object only if it is an {@code AirPump} object.
+		 * Interact with the given object only if it is an {@code AirPump} object
+		 * and the intensity was not read from the air flow map.
 		 */
 		virtual void objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po);
 		/**
@@ -57,6 +64,41 @@ namespace Enki {
 		 * orientation.
 		 */
 		virtual void finalize (double dt, Enki::World* w);
+		/**
+		 * Return the air flow intensity measured by this sensor, in the
+		 * sensor frame.
+		 */
+		const Vector &getIntensity () const
+		{
+			this->updateReading ();
+			return this->intensity;
+		}
+		/**
+		 * Air flow sensors give the air flow at the time they are read.
+		 */
+		virtual bool needsEveryStep () const
+		{
+			return false;
+		}
+	protected:
+		/**
+		 * Read the intensity from the air flow map.
+		 */
+		virtual void evaluateReading () const;
+	private:
+		/**
+		 * Whether the intensity of this step was read from the air flow map.
+		 */
+		bool mapSensed;
+		/**
+		 * Air flow map of the world, if the intensity is read from it.
+		 */
+		WorldStimulus *worldStimulus;
+		/**
+		 * Air flow direction of the air pumps of immovable robots at this
+		 * sensor, used when this sensor robot is also immovable.
+		 */
+		StaticCouplings<Vector> airFlowCouplings;
 	};
 
 }
@@ -37,11 +37,28 @@ init (double dt, Enki::World* w)
 
 Vector AirPump::getAirFlowAt (const Point &position) const
 {
-	Vector delta = position - this->absolutePosition;
 	if (this->intensity < std::numeric_limits<double>::epsilon ()) {
 		return Vector (0, 0);
 	}
-	else if (delta.norm2 () > this->LocalInteraction::r * this->LocalInteraction::r) {
+	else {
+		return this->getAirFlow (this->getAirFlowDirectionAt (position));
+	}
+}
+
+Vector AirPump::getAirFlow (const Vector &direction) const
+{
+	if (this->intensity < std::numeric_limits<double>::epsilon ()) {
+		return Vector (0, 0);
+	}
+	else {
+		return direction * this->intensity;
+	}
+}
+
+Vector AirPump::getAirFlowDirectionAt (const Point &position) const
+{
+	Vector delta = position - this->absolutePosition;
+	if (delta.norm2 () > this->LocalInteraction::r * this->LocalInteraction::r) {
 		return Vector (0, 0);
 	}
 	else {
@@ -57,11 +74,8 @@ Vector AirPump::getAirFlowAt (const Point &position) const
 			return Vector (0, 0);
 		}
 		else {
-			// double x = intensity * cos (this->absoluteOrientation);
-			// double y = intensity * sin (this->absoluteOrientation);
-			double x = intensity * cos (deltangle);
-			double y = intensity * sin (deltangle);
-			return Vector (x, y);
+			// return Vector (cos (this->absoluteOrientation), sin (this->absoluteOrientation));
+			return Vector (cos (deltangle), sin (deltangle));
 		}
 	}
 }
@@ -63,13 +63,26 @@ namespace Enki {
 		 * vector (0,0) is returned.
 		 */
 		Vector getAirFlowAt (const Point &position) const;
+		/**
+		 * Return the direction of the air flow at the given absolute
+		 * position, whatever the air flow intensity.
+
+		 * <p> If the position is outside the air pump range or outside the
+		 * circle sector, vector (0,0) is returned.
+		 */
+		Vector getAirFlowDirectionAt (const Point &position) const;
+		/**
+		 * Return the air flow in the given direction, computed by method
+		 * {@code getAirFlowDirectionAt()}, at the current intensity.
+		 */
+		Vector getAirFlow (const Vector &direction) const;
 
 		double getIntensity () const
 		{
 			return this->intensity;
 		}
 
-		double setIntensity (double v)
+		void setIntensity (double v)
 		{
 			this->intensity = v;
 		}
@@ -11,10 +11,12 @@ HeatSensor (Robot* owner, Vector relativePosition,
 				double ambientTemperature
 				):
 	Component (owner, relativePosition, Component::OMNIDIRECTIONAL), 
+	measuredHeat (ambientTemperature),
+	worldHeat (NULL),
+	worldHeatIndex (0),
 	minMeasurableHeat (minMeasurableHeat),
 	maxMeasurableHeat (maxMeasurableHeat),
-	thermalResponseTime (thermalResponseTime),
-	measuredHeat (ambientTemperature)
+	thermalResponseTime (thermalResponseTime)
 {
 }
 
@@ -23,12 +25,22 @@ HeatSensor (Robot* owner, Vector relativePosition,
 				double minMeasurableHeat, double maxMeasurableHeat
 				):
 	Component (owner, relativePosition, Component::OMNIDIRECTIONAL), 
+	worldHeat (NULL),
+	worldHeatIndex (0),
 	minMeasurableHeat (minMeasurableHeat),
 	maxMeasurableHeat (maxMeasurableHeat),
 	thermalResponseTime (-1)
 {
 }
 
+HeatSensor::
+~HeatSensor ()
+{
+	if (this->worldHeat != NULL) {
+		this->worldHeat->removeSensor (this);
+	}
+}
+
 void HeatSensor::
 init (double dt, PhysicSimulation* ps)
 {
@@ -38,12 +50,25 @@ init (double dt, PhysicSimulation* ps)
 void HeatSensor::
 step (double dt, PhysicSimulation* ps)
 {
+	if (this->worldHeat != NULL) {
+		// sampled with the other sensors by the heat model
+		return ;
+	}
 	WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (ps);
 	if (worldHeat != NULL) {
 		this->measuredHeat = worldHeat->getHeatAt (this->absolutePosition);
+		worldHeat->addSensor (this);
 		// double factor = std::min (1.0, this->thermalResponseTime * dt);
 		// this->measuredHeat =
 		// 	factor * worldHeat->getHeatAt (this->absolutePosition)
 		// 	+ (1 - factor) * this->measuredHeat;
 	}
 }
+
+void HeatSensor::
+evaluateReading () const
+{
+	if (this->worldHeat != NULL) {
+		this->measuredHeat = this->worldHeat->getSensedHeatAt (this->absolutePosition);
+	}
+}
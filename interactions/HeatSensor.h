@@ -10,16 +10,30 @@
 #include <enki/Interaction.h>
 
 #include "extensions/Component.h"
+#include "extensions/DemandDrivenSensor.h"
 #include "extensions/PhysicInteraction.h"
 
 namespace Enki
 {
+	class WorldHeat;
+
 	class HeatSensor:
 		// public PhysicalObject,
 		public PhysicInteraction,
-		public Component
+		public Component,
+		public DemandDrivenSensor
 	{
-		double measuredHeat;
+		friend class WorldHeat;
+		mutable double measuredHeat;
+		/**
+		 * Heat model that samples this sensor with the other ones, or
+		 * {@code NULL} until the sensor first senses a heat model.
+		 */
+		WorldHeat *worldHeat;
+		/**
+		 * Index of this sensor in the sensors of the heat model.
+		 */
+		size_t worldHeatIndex;
 	public:
 		const double minMeasurableHeat;
 		const double maxMeasurableHeat;
@@ -43,10 +57,20 @@ namespace Enki
 		HeatSensor (
 			Enki::Robot* owner, Enki::Vector relativePosition,
 			double minMeasurableHeat, double maxMeasurableHeat);
+		virtual ~HeatSensor ();
 		double getMeasuredHeat () const
 		{
+			this->updateReading ();
 			return this->measuredHeat;
 		}
+		/**
+		 * Heat sensors read the temperature of the heat model without
+		 * filtering it.
+		 */
+		virtual bool needsEveryStep () const
+		{
+			return false;
+		}
 		/**
 		 * Update the measured heat if the object is a heat actuator.
 		 *
@@ -56,6 +80,8 @@ namespace Enki
 		 */
 		virtual void init (double dt, PhysicSimulation* w);
 		virtual void step (double dt, PhysicSimulation* w);
+	protected:
+		virtual void evaluateReading () const;
 	};
 }
 
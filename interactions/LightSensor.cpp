@@ -9,20 +9,26 @@
 
 #include "LightSensor.h"
 #include "LightSource.h"
+#include "LightSourceFromAbove.h"
+#include "WorldStimulus.h"
 
 using namespace Enki;
 
 LightSensor::LightSensor (double range, Enki::Robot* owner, Enki::Vector relativePosition, double orientation, double wavelength):
 	LocalInteraction (range, owner),
 	Component (owner, relativePosition, orientation),
-	wavelength (wavelength)
+	wavelength (wavelength),
+	mapSensed (false),
+	worldStimulus (NULL)
 {
 }
 
 LightSensor::LightSensor (const LightSensor& orig):
 	LocalInteraction (orig.LocalInteraction::r, orig.LocalInteraction::owner),
 	Component (orig),
-	wavelength (orig.wavelength)
+	wavelength (orig.wavelength),
+	mapSensed (false),
+	worldStimulus (NULL)
 {
 }
 
@@ -34,13 +40,30 @@ void LightSensor::
 init (double dt, Enki::World* w)
 {
 	this->intensity = 0;
+	this->lightCouplings.rewind ();
 	Component::init ();
+	ExtendedWorld *world = dynamic_cast<ExtendedWorld *> (w);
+	this->mapSensed = world != NULL && world->worldStimulus != NULL;
+	if (this->mapSensed) {
+		this->worldStimulus = world->worldStimulus;
+		if (!this->deferReading (world)) {
+			this->evaluateReading ();
+		}
+	}
 }
 
 void LightSensor::
-objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
+evaluateReading () const
 {
+	this->intensity = this->worldStimulus->getLightAt (this->absolutePosition, this->wavelength, this->Component::owner);
+}
 
+void LightSensor::
+objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
+{
+	if (this->mapSensed) {
+		return ;
+	}
 	LightSource *lightSource = dynamic_cast<LightSource *>(po);
 	if (lightSource == NULL) {
 		return ;
@@ -50,5 +73,18 @@ objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 		return ;
 	}
 
-	this->intensity += lightSource->getIntensityAt (this->absolutePosition, this->wavelength);
+	LightSourceFromAbove *lightSourceFromAbove = dynamic_cast<LightSourceFromAbove *>(po);
+	if (lightSourceFromAbove != NULL && this->isOwnerImmovable () && lightSource->isOwnerImmovable ()) {
+		const double *coupling = this->lightCouplings.find (po, lightSource->absolutePosition, this->absolutePosition);
+		if (coupling == NULL) {
+			double fraction =
+				lightSourceFromAbove->getSpatialFactorAt (this->absolutePosition)
+				* lightSourceFromAbove->getSpectralFactor (this->wavelength);
+			coupling = this->lightCouplings.store (po, lightSource->absolutePosition, this->absolutePosition, fraction);
+		}
+		this->intensity += lightSourceFromAbove->getMaxIntensity () * *coupling;
+	}
+	else {
+		this->intensity += lightSource->getIntensityAt (this->absolutePosition, this->wavelength);
+	}
 }
@@ -10,9 +10,13 @@
 
 #include <enki/Interaction.h>
 #include "Component.h"
+#include "extensions/DemandDrivenSensor.h"
+#include "extensions/StaticCouplings.h"
 
 namespace Enki
 {
+	class WorldStimulus;
+
 	/**
 	 * A light sensor that reacts maximally to a single wavelength.
 
@@ -24,7 +28,8 @@ namespace Enki
 	 */
 	class LightSensor :
 		public LocalInteraction,
-		public Component
+		public Component,
+		public DemandDrivenSensor
 	{
 	public:
 		/**
@@ -47,23 +52,48 @@ namespace Enki
 
 		virtual ~LightSensor ();
 		/**
-		 *  Reset light intensity.  Called every {@code w->step()}.
+		 *  Reset light intensity.  Called every {@code w->step()}.  If the
+		 *  world has a light map, the intensity is read from the map, when
+		 *  it is next read if the world senses on demand.
 		 */
 		virtual void init (double dt, Enki::World* w);
 		/**
 		 * Interact with the given object only if it is a {@code LightSource}
-		 * object.
+		 * object and the intensity was not read from the light map.
 		 */
 		virtual void objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po);
 		/**
 		 * Get the light intensity measured by this light sensor.
 		 */
-		double getIntensity () const { return this->intensity; }
+		double getIntensity () const { this->updateReading (); return this->intensity; }
+		/**
+		 * Light sensors give the intensity at the time they are read.
+		 */
+		virtual bool needsEveryStep () const { return false; }
+	protected:
+		/**
+		 * Read the intensity from the light map.
+		 */
+		virtual void evaluateReading () const;
 	private:
 		/**
 		 * Light intensity measured by this light sensor.
 		 */
-		double intensity;
+		mutable double intensity;
+		/**
+		 * Whether the intensity of this step was read from the light map.
+		 */
+		bool mapSensed;
+		/**
+		 * Light map of the world, if the intensity is read from it.
+		 */
+		WorldStimulus *worldStimulus;
+		/**
+		 * Fraction of the maximum intensity of the light sources of
+		 * immovable robots that reaches this sensor, used when this sensor
+		 * robot is also immovable.
+		 */
+		StaticCouplings<double> lightCouplings;
 	};
 }
 
@@ -49,10 +49,22 @@ init (double dt, Enki::World* w)
 
 double LightSourceFromAbove::
 getIntensityAt (const Point& position, double wavelength) const
+{
+    return maxIntensity
+        * getSpatialFactorAt (position)
+        * getSpectralFactor (wavelength);
+}
+
+double LightSourceFromAbove::
+getSpatialFactorAt (const Point& position) const
 {
     double distance = (absolutePosition - position).norm ();
+    return (-tanh (k * distance - radius) + 1) / 2;
+}
+
+double LightSourceFromAbove::
+getSpectralFactor (double wavelength) const
+{
     double wavelengthDiff = peakWavelength - wavelength;
-    return maxIntensity
-        * (-tanh (k * distance - radius) + 1) / 2
-        * exp (-wavelengthDiff * wavelengthDiff / 2 / sigma / sigma);
+    return exp (-wavelengthDiff * wavelengthDiff / 2 / sigma / sigma);
 }
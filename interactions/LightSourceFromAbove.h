@@ -60,6 +60,23 @@ namespace Enki {
 		virtual void init (double dt, Enki::World* w);
 
 		virtual double getIntensityAt (const Point& position, double wavelength) const;
+		/**
+		 * Fraction of the maximum intensity that reaches the given
+		 * position, for the peak wavelength.
+		 */
+		double getSpatialFactorAt (const Point& position) const;
+		/**
+		 * Fraction of the intensity that is emitted in the given
+		 * wavelength.
+		 */
+		double getSpectralFactor (double wavelength) const;
+		/**
+		 * Current maximum intensity of this light source.
+		 */
+		double getMaxIntensity () const
+		{
+			return this->maxIntensity;
+		}
 
         //! Turn the light source on.
         /*!
@@ -38,8 +38,8 @@
 #include <limits>
 #include <algorithm>
 
-#include "robots/Bee.h"
-#include "robots/Casu.h"
+#include "extensions/ExtendedWorld.h"
+#include "WorldRayCaster.h"
 
 /*!	\file ObjectSensor.cpp
 	\brief Implementation of the object type sensor
@@ -54,7 +54,9 @@ namespace Enki
 		height(height),
 		orientation(orientation),
 		range(range),
-        object_type("None"),
+        object_kind(OBJECT_NONE),
+        object_hit(NULL),
+        rayCaster(NULL),
 		aperture(15.*M_PI/180.),
 		alpha(1/cos(aperture)),
 		rayCount(3),
@@ -91,7 +93,8 @@ namespace Enki
 	void ObjectSensor::init(double dt, World* w)
 	{
         // Initialize detected object type to None.
-        object_type = "None";
+        object_kind = OBJECT_NONE;
+        object_hit = NULL;
 
 		// fill initial values with very large value; will be replaced if smaller distance is found
 		std::fill(&rayDists[0], &rayDists[rayCount], range);
@@ -106,6 +109,11 @@ namespace Enki
 			absRayAngles[i] = absOrientation + rayAngles[i];
 		// calculate current position of center of central ray
 		absSmartPos = rot * smartPos + absPos;
+
+		ExtendedWorld *world = dynamic_cast<ExtendedWorld *>(w);
+		rayCaster = world != NULL ? world->worldRayCaster : NULL;
+		if (rayCaster)
+			rayCaster->addSensor(this);
 	}
 	
 	// robot bounding circle overlaps with po
@@ -113,6 +121,9 @@ namespace Enki
 	// modified by yvan.bourquin@epfl.ch to take into account the exact bounding surface
 	void ObjectSensor::objectStep (double dt, World *w, PhysicalObject *po)
 	{
+		// the rays are cast by the world ray caster on finalize()
+		if (rayCaster)
+			return;
 		
         // if we see over the object get out of here
 		if (height > po->getHeight())
@@ -151,18 +162,7 @@ namespace Enki
 					// compute distance of intersection with bounding circle
 					dist = (sqrt(v1.norm2()-distsc2) - sqrt(r2-distsc2));
 					dist = std::max(dist, 0.);
-					if (updateRay(i, dist))
-                    {
-                        object_type = "Physical";
-                        if (dynamic_cast<Bee*>(po))
-                        {
-                            object_type = "Bee";
-                        }
-                        else if (dynamic_cast<Casu*>(po))
-                        {
-                            object_type = "Casu";
-                        }
-                    }
+					hitObject(i, dist, po);
 				}
 			}
 		}
@@ -189,18 +189,7 @@ namespace Enki
 						
 						// check intersection with polygon
 						dist = distanceToPolygon(absRayAngles[i], it->getTransformedShape());
-						if (updateRay(i, dist))
-                        {
-                            object_type = "Physical";
-                            if (dynamic_cast<Bee*>(po))
-                            {
-                                object_type = "Bee";
-                            }
-                            else if (dynamic_cast<Casu*>(po))
-                            {
-                                object_type = "Casu";
-                            }
-                        }
+						hitObject(i, dist, po);
 					}
 				}
 			}
@@ -251,7 +240,8 @@ namespace Enki
 					dist *= range;
 					if (updateRay(i, dist))
                     {
-                        object_type = "Wall";
+                        object_kind = OBJECT_WALL;
+                        object_hit = NULL;
                     }
 				}
 			}
@@ -282,7 +272,8 @@ namespace Enki
 						dist = std::max(bp, bm);
 					if (updateRay(i, dist))
                     {
-                        object_type = "Wall";
+                        object_kind = OBJECT_WALL;
+                        object_hit = NULL;
                     }
 				}
 			}
@@ -296,9 +287,28 @@ namespace Enki
 	// we combine all the sensor values
 	void ObjectSensor::finalize(double dt, World* w)
 	{
+		// the first sensor finalized casts the rays of all sensors
+		if (rayCaster)
+			rayCaster->cast(w);
 		finalValue = rayValues[0] + rayValues[1] + rayValues[2];
-		finalValue = std::max(0., std::min(m, gaussianRand(finalValue, noiseSd)));
+		finalValue = std::max(0., std::min(m, ExtendedWorld::gaussianNoise(w, finalValue, noiseSd)));
 		finalDist = inverseResponseFunction(finalValue);
+        if (object_hit)
+        {
+            const ExtendedRobot *robot = dynamic_cast<const ExtendedRobot*>(object_hit);
+            if (robot)
+                object_kind = robot->getKind();
+        }
+	}
+	
+	void ObjectSensor::hitObject(size_t i, double dist, const PhysicalObject *po)
+	{
+		if (updateRay(i, dist))
+		{
+			// the kind is found on finalize(), once per step
+			object_kind = OBJECT_PHYSICAL;
+			object_hit = po;
+		}
 	}
 	
 	bool ObjectSensor::updateRay(size_t i, double dist)
@@ -362,8 +372,13 @@ namespace Enki
 	double ObjectSensor::distanceToPolygon(double rayAngle, const Polygone &p) const 
 	{
 		// compute ray segment in global coordinates
-		Point absEnd = absPos + Vector(cos(rayAngle), sin(rayAngle)) * range;
-		Segment ray(absPos.x, absPos.y, absEnd.x, absEnd.y);
+		return distanceToPolygon(absPos, Vector(cos(rayAngle), sin(rayAngle)) * range, p);
+	}
+	
+	double ObjectSensor::distanceToPolygon(const Point &origin, const Vector &segment, const Polygone &p)
+	{
+		Point absEnd = origin + segment;
+		Segment ray(origin.x, origin.y, absEnd.x, absEnd.y);
 
 		const int n = p.size();         // number of points in the polygon
 		double tE = 0.0;          // the maximum entering segment parameter
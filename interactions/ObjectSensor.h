@@ -40,12 +40,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <valarray>
 #undef min
 
+#include "extensions/ExtendedRobot.h"
+
 /*!	\file ObjectSensor.h
 	\brief Header of the "object type" sensor
 */
 
 namespace Enki
 {
+	class WorldRayCaster;
+
 	//! A object type sensor.
 	/*! \ingroup interaction 
 	
@@ -56,6 +60,9 @@ namespace Enki
 	During objectStep() and wallsStep() it casts the three rays,
 	separated by an angle of 15 degrees. Distances are in cm. For negative distance values, i.e. a sensor inside an object, wall, etc., the value of the sensor response function at distance 0 will be used. If a ray fails to touch the object, the distance returned will be HUGE_VAL; the sensor response function will return a 0 sensor response for this case.
 	
+	If the world has a WorldRayCaster, objectStep() does nothing: the sensor queues
+	itself on init() and the caster casts the rays against objects on finalize().
+	
 	Upon finalize(), it computes finalValue and finalDist.
 	It does so first using the following equation for each ray:
 	
@@ -100,8 +107,12 @@ namespace Enki
 		const double orientation;
 		//! Actual detection range
 		const double range;
-        //! Type of the detected object
-        std::string object_type;
+        //! Kind of the detected object, resolved on finalize() if an object was hit
+        ObjectKind object_kind;
+        //! Closest object hit by a ray, or NULL if it is a wall or nothing
+        const PhysicalObject *object_hit;
+        //! Ray caster of the world that casts the rays against objects instead of objectStep(), or NULL
+        WorldRayCaster *rayCaster;
 		//! Aperture angle
 		const double aperture;
 		//! 1/cos(aperture)
@@ -175,17 +186,28 @@ namespace Enki
 		double getAbsoluteOrientation(void) const { return absOrientation; }
 		//! Return the number of rays
 		unsigned getRayCount(void) const { return rayCount; }
+		//! Return the absolute angle of a ray, updated at each time step on init()
+		double getAbsoluteRayAngle(unsigned i) const { return absRayAngles[i]; }
+		//! Return the height above ground of the sensor
+		double getHeight(void) const { return height; }
 		//! Return the aperture of the sensor
 		double getAperture(void) const { return aperture; }
 		//! Return the range of the sensor
 		double getRange(void) const { return range; }
-        //! Return the type of the detected object
-        const std::string& getType(void) const { return object_type; }
+        //! Return the kind of the detected object
+        ObjectKind getKind(void) const { return object_kind; }
+        //! Return the name of the kind of the detected object
+        const char *getType(void) const { return objectKindName(object_kind); }
 		//! Return the radius for the smallest circle enclosing all rays
 		double getSmartRadius(void) const { return smartRadius; }
 		//! Return current position of the center of the smartRadius, i.e. center of the smallest circle enclosing all rays in relative (robot) coordinates
 		Point getAbsSmartPos(void) const { return absSmartPos; }
 		
+		//! If dist is smaller than the current distance of ray i, update the ray and record po as the detected object
+		void hitObject(size_t i, double dist, const PhysicalObject *po);
+		//! Returns distance from origin to convex polygon p along segment, or HUGE_VAL if there is no intersection
+		static double distanceToPolygon(const Point &origin, const Vector &segment, const Polygone &p);
+		
 	protected:
 		//! If dist is smaller than current ray distance, update distance and response value
 		bool updateRay(size_t i, double dist);
@@ -37,3 +37,16 @@ double QuadraticVibrationSource::getWaveAt (const Point &position, double time)
 	double squareDistance = (this->absolutePosition - position).norm2 ();
 	return this->amplitude / (this->decayConstant * squareDistance + 1);
 }
+
+void QuadraticVibrationSource::
+addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const
+{
+	const double x = this->absolutePosition.x;
+	const double y = this->absolutePosition.y;
+	const size_t n = positions.size ();
+	for (size_t i = 0; i < n; i++) {
+		const double dx = positions [i].x - x;
+		const double dy = positions [i].y - y;
+		waves [i] += this->amplitude / (this->decayConstant * (dx * dx + dy * dy) + 1);
+	}
+}
@@ -59,6 +59,8 @@ namespace Enki
 		virtual ~QuadraticVibrationSource ();
 
 		virtual double getWaveAt (const Point &position, double time) const;
+
+		virtual void addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const;
 	private:
 
 	};
@@ -4,6 +4,7 @@
 #include "VibrationSensor.h"
 #include "VibrationSource.h"
 #include "WaveVibrationSource.h"
+#include "WorldVibration.h"
 
 using namespace Enki;
 
@@ -15,29 +16,47 @@ VibrationSensor
 	:
 	LocalInteraction (range, owner),
 	Component (owner, relativePosition, orientation), 
+	totalElapsedTime (0),
 	maxMeasurableFrequency (maxMeasurableFrequency),
 	amplitudeStandardDeviationGaussianNoise (amplitudeStandardDeviationGaussianNoise),
 	frequencyStandardDeviationGaussianNoise (frequencyStandardDeviationGaussianNoise),
 	amplitudeValues (),
 	frequencyValues (),
-	totalElapsedTime (0)
+	fieldSensed (false),
+	worldVibration (NULL),
+	world (NULL),
+	analyser (NULL),
+	nextSample (0),
+	sampleCount (0),
+	sampleInterval (0)
 {
 }
 
 VibrationSensor::VibrationSensor (const VibrationSensor& orig):
 	LocalInteraction (orig.LocalInteraction::r, orig.LocalInteraction::owner),
 	Component (orig),
+	totalElapsedTime (0),
 	maxMeasurableFrequency (orig.maxMeasurableFrequency),
 	amplitudeStandardDeviationGaussianNoise (orig.amplitudeStandardDeviationGaussianNoise),
 	frequencyStandardDeviationGaussianNoise (orig.frequencyStandardDeviationGaussianNoise),
 	amplitudeValues (0),
 	frequencyValues (0),
-	totalElapsedTime (0)
+	fieldSensed (false),
+	worldVibration (NULL),
+	world (NULL),
+	analyser (NULL),
+	nextSample (0),
+	sampleCount (0),
+	sampleInterval (0)
 {
+	if (orig.analyser != NULL) {
+		this->setSpectrumWindow (orig.analyser->getWindow ());
+	}
 }
 
 VibrationSensor::~VibrationSensor ()
 {
+	delete this->analyser;
 }
 
 void VibrationSensor::
@@ -45,13 +64,41 @@ init (double dt, Enki::World* w)
 {
 	this->amplitudeValues.clear ();
 	this->frequencyValues.clear ();
+	this->waveCouplings.rewind ();
 	Component::init ();
+	this->world = w;
+	ExtendedWorld *world = dynamic_cast<ExtendedWorld *> (w);
+	this->fieldSensed = world != NULL && world->worldVibration != NULL;
+	if (this->fieldSensed) {
+		this->worldVibration = world->worldVibration;
+		if (!this->deferReading (world)) {
+			this->evaluateReading ();
+		}
+	}
 	// std::cout << "initialisation step for vibration sensor " << this->value << '\n';
 }
 
+void VibrationSensor::
+evaluateReading () const
+{
+	WorldVibration::Reading reading = this->worldVibration->getVibrationAt (this->absolutePosition, this->Component::owner);
+	const WaveVibrationSource *waveVibrationSource = dynamic_cast<const WaveVibrationSource *> (reading.source);
+	if (waveVibrationSource != NULL) {
+		double value = waveVibrationSource->getFrequency ();
+		value = std::min (value, this->maxMeasurableFrequency);
+		value = ExtendedWorld::gaussianNoise (this->world, value, value * this->frequencyStandardDeviationGaussianNoise);
+		this->frequencyValues.push_back (value);
+		value = ExtendedWorld::gaussianNoise (this->world, reading.amplitude, fabs (reading.amplitude * this->amplitudeStandardDeviationGaussianNoise));
+		this->amplitudeValues.push_back (value);
+	}
+}
+
 void VibrationSensor::
 objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 {
+	if (this->fieldSensed) {
+		return ;
+	}
 	VibrationSource *vibrationSource = dynamic_cast<VibrationSource *>(po);
 	if (vibrationSource == NULL) {
 		return ;
@@ -79,10 +126,25 @@ objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 	if (waveVibrationSource != NULL) {
 		value = waveVibrationSource->getFrequency ();
 		value = std::min (value, this->maxMeasurableFrequency);
-		value = gaussianRand (value, value * this->frequencyStandardDeviationGaussianNoise);
+		value = ExtendedWorld::gaussianNoise (w, value, value * this->frequencyStandardDeviationGaussianNoise);
 		this->frequencyValues.push_back (value);
-		value = waveVibrationSource->getWaveAt (this->absolutePosition, this->totalElapsedTime);
-		value = gaussianRand (value, fabs (value * this->amplitudeStandardDeviationGaussianNoise));
+		if (this->isOwnerImmovable () && waveVibrationSource->isOwnerImmovable ()) {
+			const WaveCoupling *coupling = this->waveCouplings.find (po, waveVibrationSource->absolutePosition, this->absolutePosition);
+			if (coupling == NULL
+			    || coupling->amplitudeQuadraticDecay != waveVibrationSource->amplitudeQuadraticDecay
+			    || coupling->velocity != waveVibrationSource->velocity) {
+				WaveCoupling newCoupling;
+				waveVibrationSource->getCouplingAt (this->absolutePosition, newCoupling.attenuation, newCoupling.delay);
+				newCoupling.amplitudeQuadraticDecay = waveVibrationSource->amplitudeQuadraticDecay;
+				newCoupling.velocity = waveVibrationSource->velocity;
+				coupling = this->waveCouplings.store (po, waveVibrationSource->absolutePosition, this->absolutePosition, newCoupling);
+			}
+			value = waveVibrationSource->getWave (coupling->attenuation, coupling->delay, this->totalElapsedTime);
+		}
+		else {
+			value = waveVibrationSource->getWaveAt (this->absolutePosition, this->totalElapsedTime);
+		}
+		value = ExtendedWorld::gaussianNoise (w, value, fabs (value * this->amplitudeStandardDeviationGaussianNoise));
 		this->amplitudeValues.push_back (value);
 	}
 	this->totalElapsedTime += dt;
@@ -91,6 +153,46 @@ objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po)
 void VibrationSensor::
 finalize (double dt, Enki::World* w)
 {
+	if (this->analyser == NULL) {
+		return ;
+	}
+	double sample = 0;
+	for (size_t i = 0; i < this->amplitudeValues.size (); i++) {
+		sample += this->amplitudeValues [i];
+	}
+	this->samples [this->nextSample] = sample;
+	this->nextSample = (this->nextSample + 1) % this->samples.size ();
+	this->sampleCount = std::min (this->sampleCount + 1, (unsigned) this->samples.size ());
+	this->sampleInterval = dt;
+}
+
+void VibrationSensor::
+setSpectrumWindow (unsigned window)
+{
+	delete this->analyser;
+	this->analyser = window > 0 ? new SpectrumAnalyser (window) : NULL;
+	this->samples.assign (this->analyser != NULL ? this->analyser->getWindow () : 0, 0);
+	this->nextSample = 0;
+	this->sampleCount = 0;
+}
+
+void VibrationSensor::
+getSpectrum (unsigned peaks, SpectrumAnalyser::Features &features)
+{
+	if (this->analyser == NULL) {
+		features.peaks.clear ();
+		features.samples = 0;
+		return ;
+	}
+	// oldest samples are after the next one when the ring is full
+	const unsigned size = this->samples.size ();
+	const unsigned start = this->sampleCount < size ? 0 : this->nextSample;
+	const double *ring = &this->samples [0];
+	this->analyser->analyse (
+		ring + start, std::min (size - start, this->sampleCount),
+		ring, this->sampleCount < size ? 0 : start,
+		this->sampleInterval > 0 ? 1 / this->sampleInterval : 0,
+		peaks, features);
 }
 
 
@@ -14,9 +14,14 @@
 #include <enki/Interaction.h>
 
 #include "extensions/Component.h"
+#include "extensions/DemandDrivenSensor.h"
+#include "extensions/StaticCouplings.h"
+#include "extensions/SpectrumAnalyser.h"
 
 namespace Enki
 {
+	class WorldVibration;
+
 	/**
 	 * Represents a vibration sensor.
 	 *
@@ -24,7 +29,8 @@ namespace Enki
 	 */
 	class VibrationSensor
 		: public LocalInteraction,
-		  public Component
+		  public Component,
+		  public DemandDrivenSensor
 	{
 		/**
 		 * How much time has passed.  The enki simulator does not store how
@@ -58,7 +64,7 @@ namespace Enki
 		 * attribute with the sensed vibration according to the vibration
 		 * model.
 		 */
-		std::vector<double> amplitudeValues;
+		mutable std::vector<double> amplitudeValues;
 		/**
 		 * Measured frequency in the current simulation iteration.
 		 *
@@ -67,7 +73,58 @@ namespace Enki
 		 * attribute with the sensed vibration according to the vibration
 		 * model.
 		 */
-		std::vector<double> frequencyValues;
+		mutable std::vector<double> frequencyValues;
+		/**
+		 * Whether the current values were read from the world vibration
+		 * field, in which case the vibration sources are ignored.
+		 */
+		bool fieldSensed;
+		/**
+		 * Vibration field of the world, if the values are read from it.
+		 */
+		WorldVibration *worldVibration;
+		/**
+		 * World of the current step, whose noise generator draws the noise
+		 * of the values.
+		 */
+		Enki::World *world;
+		/**
+		 * Attenuation and propagation delay of the wave of a source that
+		 * does not move, with the source parameters they were computed
+		 * with.
+		 */
+		struct WaveCoupling
+		{
+			double attenuation;
+			double delay;
+			double amplitudeQuadraticDecay;
+			double velocity;
+		};
+		/**
+		 * Couplings with the wave vibration sources of immovable robots,
+		 * used when this sensor robot is also immovable.
+		 */
+		StaticCouplings<WaveCoupling> waveCouplings;
+		/**
+		 * Analyser of the sensed wave, or {@code NULL} if this sensor does
+		 * not keep a window of samples.
+		 */
+		SpectrumAnalyser *analyser;
+		/**
+		 * Ring of the last samples of the sensed wave, the sum of the
+		 * amplitudes of each step.  Allocated with the analyser.
+		 */
+		std::vector<double> samples;
+		/**
+		 * Position in {@code samples} of the next sample, and number of
+		 * samples in the ring.
+		 */
+		unsigned nextSample;
+		unsigned sampleCount;
+		/**
+		 * Time between samples, the time step of the last step.
+		 */
+		double sampleInterval;
 	public:
 		VibrationSensor (
 			double range, Enki::Robot* owner,
@@ -84,6 +141,7 @@ namespace Enki
 		 */
 		const std::vector<double> &getAmplitude () const
 		{
+			this->updateReading ();
 			return this->amplitudeValues;
 		}
 		/**
@@ -91,12 +149,26 @@ namespace Enki
 		 */
 		const std::vector<double> &getFrequency () const
 		{
+			this->updateReading ();
 			return this->frequencyValues;
 		}
+		/**
+		 * A sensor that keeps a window of samples must sense every step.
+		 * Otherwise it gives the vibration at the time it is read.
+		 */
+		virtual bool needsEveryStep () const
+		{
+			return this->analyser != NULL;
+		}
 		/**
 		 * Initialise the measured amplitude and frequency in the current
 		 * iteration step.
 		 *
+		 * <p> If the world has a vibration field, the sensor reads a single
+		 * value from it: the superposed wave of the sources of other
+		 * robots, and the frequency of the strongest of them.  The value is
+		 * read when it is next read if the world senses on demand.
+		 *
 		 * @param dt time step.
 		 *
 		 * @param w world where the interaction takes place.
@@ -111,9 +183,41 @@ namespace Enki
 		 * @param w world where the interaction takes place.
 		 */
 		virtual void objectStep (double dt, Enki::World* w, Enki::PhysicalObject *po);
-
-
+		/**
+		 * Add the sensed wave to the ring of samples, if this sensor keeps
+		 * one.
+		 */
 		virtual void finalize (double dt, Enki::World* w);
+		/**
+		 * Keep the sensed wave of the last steps, so that its spectrum can
+		 * be computed by {@code getSpectrum()}.  The wave is sampled once
+		 * per step, so the highest frequency that can be detected is half
+		 * the step rate.
+		 *
+		 * @param window Number of samples, rounded up to a power of two,
+		 * or zero to stop keeping samples.
+		 */
+		void setSpectrumWindow (unsigned window);
+		/**
+		 * Whether this sensor keeps a window of samples.
+		 */
+		bool hasSpectrum () const
+		{
+			return this->analyser != NULL;
+		}
+		/**
+		 * Compute the dominant frequencies and the amplitude statistics of
+		 * the samples in the window.  Frequencies are only computed once
+		 * the window is full.
+		 *
+		 * @param peaks Maximum number of dominant frequencies.
+		 */
+		void getSpectrum (unsigned peaks, SpectrumAnalyser::Features &features);
+	protected:
+		/**
+		 * Read the amplitude and frequency from the vibration field.
+		 */
+		virtual void evaluateReading () const;
 	};
 
 }
@@ -1,4 +1,5 @@
 #include "VibrationSource.h"
+#include "NotSimulated.h"
 
 using namespace Enki;
 
@@ -26,3 +27,14 @@ init (double dt, Enki::World* w)
 	Component::init ();
 }
 
+void VibrationSource::
+addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const
+{
+	for (size_t i = 0; i < positions.size (); i++) {
+		try {
+			waves [i] += this->getWaveAt (positions [i], time);
+		}
+		catch (NotSimulated *ns) {
+		}
+	}
+}
@@ -9,6 +9,7 @@
 #define VIBRATION_SOURCE
 
 #include <iostream>
+#include <vector>
 
 #include <enki/Interaction.h>
 #include <enki/PhysicalEngine.h>
@@ -51,6 +52,16 @@ namespace Enki
 		 * given position and time.
 		 */
 		virtual double getWaveAt (const Point &position, double time) const = 0;
+		/**
+		 * Add the vibration amplitude produced by this source at each of
+		 * the given positions to the corresponding element of {@code
+		 * waves}, which must have the same size as {@code positions}.
+		 *
+		 * <p> This implementation calls {@code getWaveAt()} for each
+		 * position.  Subclasses override it with a loop that the compiler
+		 * can vectorise.
+		 */
+		virtual void addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const;
 	};
 }
 
@@ -1,9 +1,9 @@
 #include <boost/math/constants/constants.hpp>
 #include <math.h>
 
-#include <enki/Random.h>
-
 #include "WaveVibrationSource.h"
+#include "extensions/ExtendedWorld.h"
+#include "extensions/FastMath.h"
 
 using namespace Enki;
 
@@ -14,11 +14,13 @@ WaveVibrationSource::WaveVibrationSource
 	 double phase,
 	 double velocity,
 	 double amplitudeQuadraticDecay,
-	 double noise)
+	 double noise,
+	 World *world)
 	:
 	VibrationSource (range, owner, relativePosition, OMNIDIRECTIONAL),
 	noise (noise),
 	frequency (0),
+	world (world),
 	maximumAmplitude (maximumAmplitude),
 	velocity (velocity),
 	phase (phase),
@@ -30,6 +32,7 @@ WaveVibrationSource::WaveVibrationSource (const WaveVibrationSource& orig):
 	VibrationSource (orig),
 	frequency (orig.frequency),
 	noise (orig.noise),
+	world (orig.world),
 	maximumAmplitude (orig.maximumAmplitude),
 	velocity (orig.velocity),
 	phase (orig.phase),
@@ -45,19 +48,57 @@ void WaveVibrationSource::
 setFrequency (double value)
 {
 	// std::cout << "setFrequency (" << value << ")" << std::endl;
-	this->frequency = value + (2 * uniformRand () - 1) / 2 * this->noise;
+	this->frequency = value + (2 * ExtendedWorld::uniformNoise (this->world) - 1) / 2 * this->noise;
 }
 
 double WaveVibrationSource::getWaveAt (const Point &position, double time) const
+{
+	double attenuation, delay;
+	this->getCouplingAt (position, attenuation, delay);
+	return this->getWave (attenuation, delay, time);
+}
+
+void WaveVibrationSource::
+getCouplingAt (const Point &position, double &attenuation, double &delay) const
 {
 	double distance2 = (this->absolutePosition - position).norm2 ();
 	double distance = sqrt (distance2);
+	attenuation = 1 / (1 + distance2 * this->amplitudeQuadraticDecay);
+	delay = distance / this->velocity;
+}
+
+double WaveVibrationSource::
+getWave (double attenuation, double delay, double time) const
+{
 	return
 		this->maximumAmplitude
 		* std::sin (
 			2 * boost::math::constants::pi<double> ()
 			* this->frequency
-			* (time + distance / this->velocity + this->phase)
+			* (time + delay + this->phase)
 		)
-		/ (1 + distance2 * this->amplitudeQuadraticDecay);
+		* attenuation;
+}
+
+void WaveVibrationSource::
+addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const
+{
+	const double x = this->absolutePosition.x;
+	const double y = this->absolutePosition.y;
+	const double amplitude = this->maximumAmplitude;
+	const double frequency = this->frequency;
+	const double slowness = 1 / this->velocity;
+	const double decay = this->amplitudeQuadraticDecay;
+	const double start = time + this->phase;
+	const size_t n = positions.size ();
+	for (size_t i = 0; i < n; i++) {
+		const double dx = positions [i].x - x;
+		const double dy = positions [i].y - y;
+		const double distance2 = dx * dx + dy * dy;
+		const double distance = std::sqrt (distance2);
+		waves [i] +=
+			amplitude
+			* fastSinTurns (frequency * (start + distance * slowness))
+			/ (1 + distance2 * decay);
+	}
 }
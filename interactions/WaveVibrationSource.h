@@ -46,6 +46,11 @@ namespace Enki
 		 * added an uniform number from the range [-n,+n].
 		 */
 		const double noise;
+		/**
+		 * World whose noise generator draws the frequency noise, or
+		 * {@code NULL} for the global Enki generator.
+		 */
+		World *world;
 	public:
 		/**
 		 * Current vibration amplitude of this source.
@@ -68,13 +73,32 @@ namespace Enki
 
 		WaveVibrationSource (double range, Robot* owner, Vector relativePosition,
 			double maximumAmplitude, double phase, double velocity,
-			double amplitudeQuadraticDecay, double noise);
+			double amplitudeQuadraticDecay, double noise, World *world = NULL);
 
 		WaveVibrationSource (const WaveVibrationSource& orig);
 
 		virtual ~WaveVibrationSource ();
 
 		virtual double getWaveAt (const Point &position, double time) const;
+		/**
+		 * Compute the part of the wave at the given position that only
+		 * depends on the distance: the amplitude attenuation and the
+		 * propagation delay.
+		 */
+		void getCouplingAt (const Point &position, double &attenuation, double &delay) const;
+		/**
+		 * Return the wave at a position with the given attenuation and
+		 * propagation delay, computed by method {@code getCouplingAt()}.
+		 */
+		double getWave (double attenuation, double delay, double time) const;
+		/**
+		 * Add the wave at each of the given positions to {@code waves}.
+		 * The sine is computed by {@code fastSinTurns()}, so each value
+		 * differs from the one of {@code getWaveAt()} by less than {@code
+		 * maximumAmplitude * 1e-9}, plus the rounding error of the phase,
+		 * which grows with the time and the frequency.
+		 */
+		virtual void addWavesAt (const std::vector<Point> &positions, double time, std::vector<double> &waves) const;
 
 		/**
 		 * Sets the frequency of this wave source.  The real frequency
@@ -2,6 +2,7 @@
 #include <stdio.h>
 
 #include "WorldHeat.h"
+#include "HeatSensor.h"
 
 using namespace Enki;
 using namespace std;
@@ -19,15 +20,18 @@ WorldHeat (const ExtendedWorld *world, double normalHeat, double gridScale, doub
 	AbstractGridParallelSimulation (concurrencyLevel, this, false),
 #endif
 	AbstractGridProperties (),
-	initFlag (true),
-	normalHeat (normalHeat),
+	partialAlpha (
+		100 * 100 // gridScale is in centimetres
+		/ (gridScale * gridScale)),
 	logStream (NULL),
 	logRate (logRate - 1),
 	iterationsToNextLog (logRate),
 	relativeTime (0),
-	partialAlpha (
-		100 * 100 // gridScale is in centimetres
-		/ (gridScale * gridScale))
+	cellDissipation (CELL_DISSIPATION),
+	interpolate (false),
+	world (NULL),
+	normalHeat (normalHeat),
+	initFlag (true)
 {
 }
 
@@ -40,15 +44,18 @@ WorldHeat (const Vector &size, const Vector &origin, double normalHeat, double g
 	AbstractGridParallelSimulation (concurrencyLevel, this, false),
 #endif
 	AbstractGridProperties (),
-	initFlag (false),
-	normalHeat (normalHeat),
+	partialAlpha (
+		100 * 100 // gridScale is in centimetres
+		/ (gridScale * gridScale)),
 	logStream (NULL),
 	logRate (logRate - 1),
 	iterationsToNextLog (logRate),
 	relativeTime (0),
-	partialAlpha (
-		100 * 100 // gridScale is in centimetres
-		/ (gridScale * gridScale))
+	cellDissipation (CELL_DISSIPATION),
+	interpolate (false),
+	world (NULL),
+	normalHeat (normalHeat),
+	initFlag (false)
 {
 }
 
@@ -92,6 +99,9 @@ worldHeatFromFile (string filename, double concurrencyLevel, int logRate)
 WorldHeat::
 ~WorldHeat ()
 {
+	for (size_t i = 0; i < this->sensors.size (); i++) {
+		this->sensors [i]->worldHeat = NULL;
+	}
 	if (this->logStream != NULL) {
 		cout << "Closing heat log\n";
 		this->logStream->flush ();
@@ -116,6 +126,95 @@ double WorldHeat::getHeatAt (const Vector &pos) const
 	return this->grid [this->adtIndex][x][y];
 }
 
+void WorldHeat::
+getHeatsAt (const std::vector<Point> &positions, std::vector<double> &heats) const
+{
+	const size_t n = positions.size ();
+	const std::vector<std::vector<double> > &current = this->grid [this->adtIndex];
+	heats.resize (n);
+	if (!this->interpolate) {
+		this->sampleCells.resize (2 * n);
+		for (size_t i = 0; i < n; i++) {
+			// same as toIndex for cells inside the grid
+			this->sampleCells [2 * i] = (int) floor ((positions [i].x - this->origin.x) / this->gridScale + 0.5);
+			this->sampleCells [2 * i + 1] = (int) floor ((positions [i].y - this->origin.y) / this->gridScale + 0.5);
+		}
+		for (size_t i = 0; i < n; i++) {
+			heats [i] = current [this->sampleCells [2 * i]][this->sampleCells [2 * i + 1]];
+		}
+		return ;
+	}
+	for (size_t i = 0; i < n; i++) {
+		heats [i] = this->getInterpolatedHeatAt (positions [i]);
+	}
+}
+
+double WorldHeat::
+getSensedHeatAt (const Point &position) const
+{
+	return this->interpolate
+		? this->getInterpolatedHeatAt (position)
+		: this->getHeatAt (position);
+}
+
+double WorldHeat::
+getInterpolatedHeatAt (const Point &position) const
+{
+	const std::vector<std::vector<double> > &current = this->grid [this->adtIndex];
+	const int lastX = (int) this->size.x - 2;
+	const int lastY = (int) this->size.y - 2;
+	const double fx = (position.x - this->origin.x) / this->gridScale;
+	const double fy = (position.y - this->origin.y) / this->gridScale;
+	const int x = std::max (0, std::min (lastX, (int) floor (fx)));
+	const int y = std::max (0, std::min (lastY, (int) floor (fy)));
+	const double tx = std::max (0.0, std::min (1.0, fx - x));
+	const double ty = std::max (0.0, std::min (1.0, fy - y));
+	return
+		(1 - tx) * ((1 - ty) * current [x][y] + ty * current [x][y + 1])
+		+ tx * ((1 - ty) * current [x + 1][y] + ty * current [x + 1][y + 1]);
+}
+
+void WorldHeat::
+addSensor (HeatSensor *sensor)
+{
+	sensor->worldHeat = this;
+	sensor->worldHeatIndex = this->sensors.size ();
+	this->sensors.push_back (sensor);
+}
+
+void WorldHeat::
+removeSensor (HeatSensor *sensor)
+{
+	const size_t index = sensor->worldHeatIndex;
+	this->sensors [index] = this->sensors.back ();
+	this->sensors [index]->worldHeatIndex = index;
+	this->sensors.pop_back ();
+	sensor->worldHeat = NULL;
+}
+
+void WorldHeat::
+sampleSensors ()
+{
+	const size_t n = this->sensors.size ();
+	if (this->world != NULL && this->world->sensingOnDemand) {
+		// read when the sensors are read
+		for (size_t i = 0; i < n; i++) {
+			this->sensors [i]->deferReading (this->world);
+		}
+		return ;
+	}
+	this->sensorPositions.resize (n);
+	for (size_t i = 0; i < n; i++) {
+		HeatSensor *sensor = this->sensors [i];
+		sensor->Component::init ();
+		this->sensorPositions [i] = sensor->absolutePosition;
+	}
+	this->getHeatsAt (this->sensorPositions, this->sensorHeats);
+	for (size_t i = 0; i < n; i++) {
+		this->sensors [i]->measuredHeat = this->sensorHeats [i];
+	}
+}
+
 void WorldHeat::
 setHeatAt (const Vector &pos, double value)
 {
@@ -144,6 +243,7 @@ setHeatDiffusivityAt (const Point &pos, double value)
 void WorldHeat::
 initParameters (const ExtendedWorld *world)
 {
+	this->world = world;
 	if (this->initFlag) {
 		for (int x = 0; x < this->size.x; x++) {
 			for (int y = 0; y < this->size.y; y++) {
@@ -159,6 +259,8 @@ initParameters (const ExtendedWorld *world)
 void WorldHeat::
 initStateComputing (double deltaTime)
 {
+	// before heat actuators change the grid in this step
+	this->sampleSensors ();
 }
 
 void WorldHeat::
@@ -174,30 +276,19 @@ computeNextState (double deltaTime)
 		}
 	}
 #ifdef WORLDHEAT_SERIAL
-	const int nextAdtIndex = 1 - this->adtIndex;
-	const double alpha = this->partialAlpha * deltaTime;
-	for (int x = 1; x < this->size.x - 1; x++) {
-		for (int y = 1; y < this->size.y - 1; y++) {
-			const double currentHeat = this->grid [this->adtIndex][x][y];
-			const double deltaHeat =
-				(
-				 + (this->grid [this->adtIndex][x][y + 1] - currentHeat) * this->prop [x][y + 1]
-				 + (this->grid [this->adtIndex][x][y - 1] - currentHeat) * this->prop [x][y - 1]
-				 + (this->grid [this->adtIndex][x + 1][y] - currentHeat) * this->prop [x + 1][y]
-				 + (this->grid [this->adtIndex][x - 1][y] - currentHeat) * this->prop [x - 1][y]
-				 + (this->normalHeat - currentHeat ) * CELL_DISSIPATION
-				 ) * alpha
-				;
-			this->grid [nextAdtIndex][x][y] =
-				this->grid [this->adtIndex][x][y] + deltaHeat;
-		}
-	}
-	this->adtIndex = nextAdtIndex;
+	this->updateSerial (deltaTime);
 #else
 	AbstractGridParallelSimulation::updateState (deltaTime);
 #endif
 }
 
+void WorldHeat::
+updateSerial (double deltaTime)
+{
+	this->updateGrid (deltaTime, 1, 1, this->size.x - 1, this->size.y - 1);
+	this->adtIndex = 1 - this->adtIndex;
+}
+
 void WorldHeat::
 updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax)
 {
@@ -212,7 +303,7 @@ updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax)
 				 + (this->grid [this->adtIndex][x][y - 1] - currentHeat) * this->prop [x][y - 1]
 				 + (this->grid [this->adtIndex][x + 1][y] - currentHeat) * this->prop [x + 1][y]
 				 + (this->grid [this->adtIndex][x - 1][y] - currentHeat) * this->prop [x - 1][y]
-				 + (this->normalHeat - currentHeat ) * CELL_DISSIPATION
+				 + (this->normalHeat - currentHeat ) * this->cellDissipation
 				 ) * alpha
 				;
 			this->grid [nextAdtIndex][x][y] =
@@ -13,6 +13,8 @@
 
 namespace Enki
 {
+	class HeatSensor;
+
 	/**
 	 * Provides a simulation of heat to be used in Enki.
 
@@ -27,6 +29,12 @@ namespace Enki
 	 * used to computed the temperature in the next iteration.  An {@code
 	 * AbstractGridProperties} instance is used to store grid properties,
 	 * namely heat diffusivity.
+
+	 * <p> Heat sensors register with the heat model the first time they
+	 * sense it.  The model samples all of them in one pass when it starts
+	 * computing the next state, before any actuator changes the grid.  If
+	 * the world senses on demand, each sensor reads the grid when its
+	 * heat is read instead.
 	 */
 	class WorldHeat :
 #ifdef WORLDHEAT_SERIAL
@@ -68,6 +76,35 @@ namespace Enki
 		 * simulation time.
 		 */
 		double relativeTime;
+		/**
+		 * Heat lost by cells directly to the outside world.  Initialised
+		 * with {@code CELL_DISSIPATION}, so worlds in the same process can
+		 * use different values.
+		 */
+		double cellDissipation;
+		/**
+		 * Registered heat sensors and their absolute positions in the last
+		 * sampling.
+		 */
+		std::vector<HeatSensor *> sensors;
+		std::vector<Point> sensorPositions;
+		std::vector<double> sensorHeats;
+		/**
+		 * Whether heat sampled at a position is interpolated between the
+		 * four nearest cells, instead of being the heat of the nearest
+		 * cell.
+		 */
+		bool interpolate;
+		/**
+		 * Cell indexes computed by {@code getHeatsAt()}, kept to avoid
+		 * allocating them in every call.
+		 */
+		mutable std::vector<int> sampleCells;
+		/**
+		 * World of this heat model, set by {@code initParameters()}.  If
+		 * it senses on demand, the sensors are not sampled in every step.
+		 */
+		const ExtendedWorld *world;
 	public:
 		/**
 		 * Normal environmental heat used to compute heat at world borders.
@@ -92,6 +129,11 @@ namespace Enki
 		 */
 		const bool initFlag;
 		WorldHeat (const Vector &size, const Vector &origin, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate = 1);
+		/**
+		 * Bilinear interpolation of the heat of the four cells around the
+		 * given position.
+		 */
+		double getInterpolatedHeatAt (const Point &position) const;
 		
 	public:
 		WorldHeat (const ExtendedWorld *world, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate = 1);
@@ -109,10 +151,48 @@ namespace Enki
 
 		double getHeatAt (const Vector &pos) const;
 		void setHeatAt (const Vector &pos, double value);
+		/**
+		 * Compute the heat at each of the given positions.  Cell indexes
+		 * are computed for all positions before the grid is read, so that
+		 * both loops are simple enough to be vectorised.
+		 */
+		void getHeatsAt (const std::vector<Point> &positions, std::vector<double> &heats) const;
+		/**
+		 * Return the heat at the given position as a heat sensor reads it,
+		 * interpolated if {@code setInterpolation(true)} was called.
+		 */
+		double getSensedHeatAt (const Point &position) const;
+		/**
+		 * Set whether heat sensors and {@code getHeatsAt()} interpolate
+		 * between the four nearest cells.  By default they read the nearest
+		 * cell, as {@code getHeatAt()} does.
+		 */
+		void setInterpolation (bool value)
+		{
+			this->interpolate = value;
+		}
+		/**
+		 * Sample the given sensor with the others, until it is removed.
+		 */
+		void addSensor (HeatSensor *sensor);
+		void removeSensor (HeatSensor *sensor);
 
 		double getHeatDiffusivityAt (const Point &position) const;
 		void setHeatDiffusivityAt (const Point &position, double value);
 
+		/**
+		 * Set the heat lost by cells directly to the outside world, in
+		 * this heat model only.
+		 */
+		void setCellDissipation (double value)
+		{
+			this->cellDissipation = value;
+		}
+		double getCellDissipation () const
+		{
+			return this->cellDissipation;
+		}
+
 		/**
 		 * When a heat actuator turns off, we have to recompute the heat
 		 * distribution in the world.  We do this for a certain number of
@@ -135,6 +215,11 @@ namespace Enki
 		//  */
 		// virtual void handleObjectAction (const PhysicalObject *po);
 
+		/**
+		 * Update the measured heat of all registered sensors, or mark it
+		 * as stale if the world senses on demand.
+		 */
+		void sampleSensors ();
 		/**
 		 * Computes the next state of this physic interaction.
 		 *
@@ -187,6 +272,12 @@ namespace Enki
 	// 	 */
 	// 	double updateGrid (double deltaTime);
 	public:
+		/**
+		 * Update the whole grid in the calling thread.  This is the
+		 * reference kernel, used by {@code computeNextState()} when
+		 * compiled with {@code WORLDHEAT_SERIAL}.
+		 */
+		void updateSerial (double deltaTime);
 		/**
 		 * Update part of the grid.
 		 */
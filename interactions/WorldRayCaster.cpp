@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+
+#include "WorldRayCaster.h"
+#include "ObjectSensor.h"
+
+using namespace Enki;
+
+WorldRayCaster::
+WorldRayCaster (double cellSize):
+	cellSize (cellSize),
+	gridX (0),
+	gridY (0),
+	gridCellSize (cellSize),
+	columns (0),
+	rows (0),
+	mark (0)
+{
+	this->firstRay.push_back (0);
+}
+
+void WorldRayCaster::
+addSensor (ObjectSensor *sensor)
+{
+	const Point origin = sensor->getAbsolutePosition ();
+	const double length = sensor->getRange ();
+	for (unsigned i = 0; i < sensor->getRayCount (); i++) {
+		const double angle = sensor->getAbsoluteRayAngle (i);
+		this->rayOriginX.push_back (origin.x);
+		this->rayOriginY.push_back (origin.y);
+		this->rayDirectionX.push_back (std::cos (angle));
+		this->rayDirectionY.push_back (std::sin (angle));
+		this->rayLength.push_back (length);
+	}
+	this->sensors.push_back (sensor);
+	this->firstRay.push_back (this->rayOriginX.size ());
+}
+
+void WorldRayCaster::
+cast (const World *world)
+{
+	if (this->sensors.empty ()) {
+		return ;
+	}
+	this->buildGrid (world);
+	this->rayDistance.assign (this->rayOriginX.size (), HUGE_VAL);
+	this->rayHit.assign (this->rayOriginX.size (), NULL);
+	for (size_t s = 0; s < this->sensors.size (); s++) {
+		this->castSensor (s);
+	}
+	for (size_t s = 0; s < this->sensors.size (); s++) {
+		for (size_t r = this->firstRay [s]; r < this->firstRay [s + 1]; r++) {
+			if (this->rayHit [r] != NULL) {
+				this->sensors [s]->hitObject (r - this->firstRay [s], this->rayDistance [r], this->rayHit [r]);
+			}
+		}
+	}
+	this->sensors.clear ();
+	this->firstRay.resize (1);
+	this->rayOriginX.clear ();
+	this->rayOriginY.clear ();
+	this->rayDirectionX.clear ();
+	this->rayDirectionY.clear ();
+	this->rayLength.clear ();
+}
+
+void WorldRayCaster::
+buildGrid (const World *world)
+{
+	this->objects.assign (world->objects.begin (), world->objects.end ());
+	const size_t n = this->objects.size ();
+	this->objectX.resize (n);
+	this->objectY.resize (n);
+	this->objectRadius.resize (n);
+	double minX = HUGE_VAL, minY = HUGE_VAL, maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+	for (size_t o = 0; o < n; o++) {
+		const PhysicalObject *po = this->objects [o];
+		this->objectX [o] = po->pos.x;
+		this->objectY [o] = po->pos.y;
+		this->objectRadius [o] = po->getRadius ();
+		minX = std::min (minX, po->pos.x - this->objectRadius [o]);
+		minY = std::min (minY, po->pos.y - this->objectRadius [o]);
+		maxX = std::max (maxX, po->pos.x + this->objectRadius [o]);
+		maxY = std::max (maxY, po->pos.y + this->objectRadius [o]);
+	}
+	if (n == 0) {
+		minX = minY = maxX = maxY = 0;
+	}
+	// enlarge the cells if there would be many more cells than objects
+	const double maximumCells = 4.0 * n + 64;
+	const double area = (maxX - minX) * (maxY - minY);
+	this->gridCellSize = std::max (this->cellSize, std::sqrt (area / maximumCells));
+	this->gridX = minX;
+	this->gridY = minY;
+	this->columns = (int) ((maxX - minX) / this->gridCellSize) + 1;
+	this->rows = (int) ((maxY - minY) / this->gridCellSize) + 1;
+	// counting sort of the objects by the cells their bounding circle
+	// overlaps
+	const size_t cells = (size_t) this->columns * this->rows;
+	this->cellStart.assign (cells + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t o = 0; o < n; o++) {
+			const int x0 = (int) ((this->objectX [o] - this->objectRadius [o] - this->gridX) / this->gridCellSize);
+			const int y0 = (int) ((this->objectY [o] - this->objectRadius [o] - this->gridY) / this->gridCellSize);
+			const int x1 = std::min (this->columns - 1, (int) ((this->objectX [o] + this->objectRadius [o] - this->gridX) / this->gridCellSize));
+			const int y1 = std::min (this->rows - 1, (int) ((this->objectY [o] + this->objectRadius [o] - this->gridY) / this->gridCellSize));
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					const size_t cell = (size_t) y * this->columns + x;
+					if (pass == 0) {
+						this->cellStart [cell + 1]++;
+					}
+					else {
+						this->cellObjects [this->cellStart [cell]++] = o;
+					}
+				}
+			}
+		}
+		if (pass == 0) {
+			for (size_t c = 0; c < cells; c++) {
+				this->cellStart [c + 1] += this->cellStart [c];
+			}
+			this->cellObjects.resize (this->cellStart [cells]);
+		}
+		else {
+			// filling advanced each start to the next cell's start
+			for (size_t c = cells; c > 0; c--) {
+				this->cellStart [c] = this->cellStart [c - 1];
+			}
+			this->cellStart [0] = 0;
+		}
+	}
+	this->objectMark.assign (n, 0);
+	this->mark = 0;
+}
+
+void WorldRayCaster::
+castSensor (size_t index)
+{
+	const ObjectSensor *sensor = this->sensors [index];
+	const Point smartPosition = sensor->getAbsSmartPos ();
+	const double smartRadius = sensor->getSmartRadius ();
+	const double height = sensor->getHeight ();
+	// objects in the cells that the circle enclosing the rays overlaps
+	const int x0 = std::max (0, (int) std::floor ((smartPosition.x - smartRadius - this->gridX) / this->gridCellSize));
+	const int y0 = std::max (0, (int) std::floor ((smartPosition.y - smartRadius - this->gridY) / this->gridCellSize));
+	const int x1 = std::min (this->columns - 1, (int) std::floor ((smartPosition.x + smartRadius - this->gridX) / this->gridCellSize));
+	const int y1 = std::min (this->rows - 1, (int) std::floor ((smartPosition.y + smartRadius - this->gridY) / this->gridCellSize));
+	this->mark++;
+	this->candidates.clear ();
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			const size_t cell = (size_t) y * this->columns + x;
+			for (unsigned i = this->cellStart [cell]; i < this->cellStart [cell + 1]; i++) {
+				const unsigned o = this->cellObjects [i];
+				if (this->objectMark [o] == this->mark) {
+					continue;
+				}
+				this->objectMark [o] = this->mark;
+				const double dx = this->objectX [o] - smartPosition.x;
+				const double dy = this->objectY [o] - smartPosition.y;
+				const double radiusSum = this->objectRadius [o] + smartRadius;
+				if (dx * dx + dy * dy <= radiusSum * radiusSum
+				    && this->objects [o] != sensor->owner
+				    && height <= this->objects [o]->getHeight ()) {
+					this->candidates.push_back (o);
+				}
+			}
+		}
+	}
+	const size_t first = this->firstRay [index];
+	const size_t last = this->firstRay [index + 1];
+	for (size_t c = 0; c < this->candidates.size (); c++) {
+		const unsigned o = this->candidates [c];
+		const PhysicalObject *po = this->objects [o];
+		const double r2 = this->objectRadius [o] * this->objectRadius [o];
+		if (po->isCylindric ()) {
+			for (size_t r = first; r < last; r++) {
+				// squared distance from the circle centre to the ray line
+				const double vx = this->objectX [o] - this->rayOriginX [r];
+				const double vy = this->objectY [o] - this->rayOriginY [r];
+				const double along = vx * this->rayDirectionX [r] + vy * this->rayDirectionY [r];
+				const double across2 = vx * vx + vy * vy - along * along;
+				const double dist = across2 <= r2
+					? std::max (std::fabs (along) - std::sqrt (r2 - across2), 0.)
+					: HUGE_VAL;
+				if (dist < this->rayDistance [r]) {
+					this->rayDistance [r] = dist;
+					this->rayHit [r] = po;
+				}
+			}
+		}
+		else {
+			for (size_t r = first; r < last; r++) {
+				const double vx = this->objectX [o] - this->rayOriginX [r];
+				const double vy = this->objectY [o] - this->rayOriginY [r];
+				const double along = vx * this->rayDirectionX [r] + vy * this->rayDirectionY [r];
+				const double across2 = vx * vx + vy * vy - along * along;
+				if (across2 >= r2) {
+					continue;
+				}
+				const Point origin (this->rayOriginX [r], this->rayOriginY [r]);
+				const Vector segment (this->rayDirectionX [r] * this->rayLength [r], this->rayDirectionY [r] * this->rayLength [r]);
+				for (PhysicalObject::Hull::const_iterator it = po->getHull ().begin (); it != po->getHull ().end (); ++it) {
+					if (height > it->getHeight ()) {
+						continue;
+					}
+					const double dist = ObjectSensor::distanceToPolygon (origin, segment, it->getTransformedShape ());
+					if (dist < this->rayDistance [r]) {
+						this->rayDistance [r] = dist;
+						this->rayHit [r] = po;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,116 @@
+#ifndef __WORLD_RAY_CASTER_H
+#define __WORLD_RAY_CASTER_H
+
+#include <vector>
+
+#include <enki/PhysicalEngine.h>
+
+namespace Enki
+{
+	class ObjectSensor;
+
+	/**
+	 * Casts the rays of all object sensors of the world at once, instead
+	 * of each sensor testing its rays against every object that Enki
+	 * presents to it.
+	 *
+	 * <p> Object sensors queue themselves when they are initialised.  The
+	 * first sensor that is finalised casts the rays of all queued
+	 * sensors: objects are sorted in a uniform grid by their bounding
+	 * circle, and each sensor only tests the objects in the cells that
+	 * its rays can reach.  Rays and objects are stored in arrays of
+	 * coordinates, so that the tests of the rays of a sensor against a
+	 * cylindrical object are a loop without calls.  The closest hit of
+	 * each ray is then given back to its sensor.  Walls are still tested
+	 * by each sensor, as that test is cheap.
+	 */
+	class WorldRayCaster
+	{
+		/**
+		 * Minimum cell size of the object grid, in cm.
+		 */
+		const double cellSize;
+		/**
+		 * Sensors queued in the current step.  The rays of sensor {@code
+		 * i} are in range {@code [firstRay [i], firstRay [i + 1])}.
+		 */
+		std::vector<ObjectSensor *> sensors;
+		std::vector<size_t> firstRay;
+		/**
+		 * Origin, unit direction and length of each ray.
+		 */
+		std::vector<double> rayOriginX;
+		std::vector<double> rayOriginY;
+		std::vector<double> rayDirectionX;
+		std::vector<double> rayDirectionY;
+		std::vector<double> rayLength;
+		/**
+		 * Distance to the closest object hit by each ray, and that object.
+		 */
+		std::vector<double> rayDistance;
+		std::vector<const PhysicalObject *> rayHit;
+		/**
+		 * Objects of the world and their bounding circle.
+		 */
+		std::vector<const PhysicalObject *> objects;
+		std::vector<double> objectX;
+		std::vector<double> objectY;
+		std::vector<double> objectRadius;
+		/**
+		 * Object grid.  The objects that overlap cell {@code c} are in
+		 * range {@code [cellStart [c], cellStart [c + 1])} of {@code
+		 * cellObjects}.
+		 */
+		double gridX, gridY, gridCellSize;
+		int columns, rows;
+		std::vector<unsigned> cellStart;
+		std::vector<unsigned> cellObjects;
+		/**
+		 * Objects already tested by the current sensor have this sensor's
+		 * mark, as an object can be in several cells.
+		 */
+		std::vector<unsigned> objectMark;
+		unsigned mark;
+		/**
+		 * Objects that the current sensor can see.
+		 */
+		std::vector<unsigned> candidates;
+	public:
+		/**
+		 * Create a ray caster.
+		 *
+		 * @param cellSize Minimum cell size of the object grid, in cm.  The
+		 * cells are enlarged if the objects are so spread out that the
+		 * grid would have many more cells than objects.
+		 */
+		WorldRayCaster (double cellSize);
+		/**
+		 * Queue the rays of a sensor that has computed its absolute
+		 * position for this step.
+		 */
+		void addSensor (ObjectSensor *sensor);
+		/**
+		 * Cast the rays of the queued sensors, give each sensor its
+		 * closest hits and empty the queue.  Does nothing if the queue is
+		 * empty.
+		 */
+		void cast (const World *world);
+	private:
+		/**
+		 * Sort the objects of the world in the grid.
+		 */
+		void buildGrid (const World *world);
+		/**
+		 * Find the closest object hit by each ray of a sensor.
+		 */
+		void castSensor (size_t index);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
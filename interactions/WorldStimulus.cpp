@@ -0,0 +1,374 @@
+#include <cmath>
+#include <limits>
+
+#include "WorldStimulus.h"
+#include "LightSourceFromAbove.h"
+#include "AirPump.h"
+
+using namespace Enki;
+
+WorldStimulus::
+WorldStimulus (const ExtendedWorld *world, double gridScale, double borderSize):
+	AbstractGrid (world, gridScale, borderSize),
+	world (world),
+	dirty (true)
+{
+}
+
+WorldStimulus::
+~WorldStimulus ()
+{
+}
+
+double WorldStimulus::
+getLightAt (const Point &position, double wavelength, const PhysicalObject *exclude)
+{
+	this->update ();
+	std::map<double, LightMap>::iterator found = this->lightMaps.find (wavelength);
+	if (found == this->lightMaps.end ()) {
+		found = this->lightMaps.insert (std::make_pair (wavelength, LightMap ())).first;
+		this->computeLightMap (found->second, wavelength);
+	}
+	const LightMap &map = found->second;
+	int x, y;
+	double dx, dy;
+	this->cellAt (position, x, y, dx, dy);
+	double result =
+		(1 - dx) * (1 - dy) * map [x][y]
+		+ dx * (1 - dy) * map [x + 1][y]
+		+ (1 - dx) * dy * map [x][y + 1]
+		+ dx * dy * map [x + 1][y + 1];
+	if (exclude != NULL) {
+		typedef std::multimap<const PhysicalObject *, const LightSourceFromAbove *>::const_iterator OwnerIterator;
+		std::pair<OwnerIterator, OwnerIterator> own = this->lightSourcesByOwner.equal_range (exclude);
+		for (OwnerIterator i = own.first; i != own.second; ++i) {
+			const Stamp &stamp = this->lightStamps [i->second];
+			result -= stamp.intensity * i->second->getSpectralFactor (wavelength) * sample (stamp, x, y, dx, dy);
+		}
+	}
+	for (size_t i = 0; i < this->mobileLightSources.size (); i++) {
+		const LightSourceFromAbove *source = this->mobileLightSources [i];
+		if (exclude == NULL || source->Component::owner != exclude) {
+			result += source->getIntensityAt (position, wavelength);
+		}
+	}
+	return result;
+}
+
+Vector WorldStimulus::
+getAirFlowAt (const Point &position, const PhysicalObject *exclude)
+{
+	this->update ();
+	int x, y;
+	double dx, dy;
+	this->cellAt (position, x, y, dx, dy);
+	const std::vector<std::vector<Vector> > &map = this->airFlowMap;
+	Vector result =
+		map [x][y] * ((1 - dx) * (1 - dy))
+		+ map [x + 1][y] * (dx * (1 - dy))
+		+ map [x][y + 1] * ((1 - dx) * dy)
+		+ map [x + 1][y + 1] * (dx * dy);
+	if (exclude != NULL) {
+		typedef std::multimap<const PhysicalObject *, const AirPump *>::const_iterator OwnerIterator;
+		std::pair<OwnerIterator, OwnerIterator> own = this->airPumpsByOwner.equal_range (exclude);
+		for (OwnerIterator i = own.first; i != own.second; ++i) {
+			const Stamp &stamp = this->airFlowStamps [i->second];
+			result -= sampleDirection (stamp, x, y, dx, dy) * stamp.intensity;
+		}
+	}
+	for (size_t i = 0; i < this->mobileAirPumps.size (); i++) {
+		const AirPump *airPump = this->mobileAirPumps [i];
+		if (exclude == NULL || airPump->Component::owner != exclude) {
+			result += airPump->getAirFlowAt (position);
+		}
+	}
+	return result;
+}
+
+void WorldStimulus::
+initParameters (const ExtendedWorld *world)
+{
+	this->world = world;
+	this->lightStamps.clear ();
+	this->airFlowStamps.clear ();
+	this->lightMaps.clear ();
+	this->airFlowMap.assign (this->size.x, std::vector<Vector> (this->size.y, Vector (0, 0)));
+	this->lightSourcesByOwner.clear ();
+	this->airPumpsByOwner.clear ();
+	this->dirty = true;
+}
+
+void WorldStimulus::
+initStateComputing (double deltaTime)
+{
+}
+
+void WorldStimulus::
+computeNextState (double deltaTime)
+{
+	this->dirty = true;
+}
+
+void WorldStimulus::
+update ()
+{
+	if (!this->dirty) {
+		return ;
+	}
+	// sources added, moved or removed change the maps as a whole
+	bool newLightSources = false;
+	bool newAirPumps = false;
+	for (LightStamps::iterator i = this->lightStamps.begin (); i != this->lightStamps.end (); ++i) {
+		i->second.seen = false;
+	}
+	for (AirFlowStamps::iterator i = this->airFlowStamps.begin (); i != this->airFlowStamps.end (); ++i) {
+		i->second.seen = false;
+	}
+	this->mobileLightSources.clear ();
+	this->mobileAirPumps.clear ();
+	for (World::ObjectsIterator i = this->world->objects.begin (); i != this->world->objects.end (); ++i) {
+		LightSourceFromAbove *lightSource = dynamic_cast<LightSourceFromAbove *> (*i);
+		if (lightSource != NULL) {
+			lightSource->Component::init ();
+			if (lightSource->getMass () >= 0) {
+				this->mobileLightSources.push_back (lightSource);
+				continue;
+			}
+			const Point &position = lightSource->getAbsolutePosition ();
+			const double intensity = lightSource->getMaxIntensity ();
+			LightStamps::iterator found = this->lightStamps.find (lightSource);
+			if (found != this->lightStamps.end ()
+			    && found->second.position.x == position.x
+			    && found->second.position.y == position.y) {
+				Stamp &stamp = found->second;
+				stamp.seen = true;
+				if (stamp.intensity != intensity) {
+					for (std::map<double, LightMap>::iterator m = this->lightMaps.begin (); m != this->lightMaps.end (); ++m) {
+						this->addLight (m->second, m->first, lightSource, stamp, intensity - stamp.intensity);
+					}
+					stamp.intensity = intensity;
+				}
+				continue;
+			}
+			const double range = lightSource->LocalInteraction::r;
+			Stamp stamp = this->newStamp (lightSource->Component::owner, position, range);
+			stamp.weight.resize (stamp.width * stamp.height);
+			for (int x = 0; x < stamp.width; x++) {
+				for (int y = 0; y < stamp.height; y++) {
+					const Point where (this->origin.x + (stamp.x + x) * this->gridScale, this->origin.y + (stamp.y + y) * this->gridScale);
+					stamp.weight [x * stamp.height + y] =
+						(where - position).norm2 () <= range * range
+						? lightSource->getSpatialFactorAt (where)
+						: 0;
+				}
+			}
+			stamp.intensity = intensity;
+			this->lightStamps [lightSource] = stamp;
+			newLightSources = true;
+			continue;
+		}
+		AirPump *airPump = dynamic_cast<AirPump *> (*i);
+		if (airPump != NULL) {
+			airPump->Component::init ();
+			if (airPump->getMass () >= 0) {
+				this->mobileAirPumps.push_back (airPump);
+				continue;
+			}
+			const Point &position = airPump->getAbsolutePosition ();
+			const double intensity = airFlowIntensity (airPump);
+			AirFlowStamps::iterator found = this->airFlowStamps.find (airPump);
+			if (found != this->airFlowStamps.end ()
+			    && found->second.position.x == position.x
+			    && found->second.position.y == position.y) {
+				Stamp &stamp = found->second;
+				stamp.seen = true;
+				if (stamp.intensity != intensity) {
+					this->addAirFlow (stamp, intensity - stamp.intensity);
+					stamp.intensity = intensity;
+				}
+				continue;
+			}
+			const double range = airPump->LocalInteraction::r;
+			Stamp stamp = this->newStamp (airPump->Component::owner, position, range);
+			stamp.direction.resize (stamp.width * stamp.height);
+			for (int x = 0; x < stamp.width; x++) {
+				for (int y = 0; y < stamp.height; y++) {
+					const Point where (this->origin.x + (stamp.x + x) * this->gridScale, this->origin.y + (stamp.y + y) * this->gridScale);
+					stamp.direction [x * stamp.height + y] = airPump->getAirFlowDirectionAt (where);
+				}
+			}
+			stamp.intensity = intensity;
+			this->airFlowStamps [airPump] = stamp;
+			newAirPumps = true;
+		}
+	}
+	// sources that are no longer in the world
+	for (LightStamps::iterator i = this->lightStamps.begin (); i != this->lightStamps.end (); ) {
+		if (i->second.seen) {
+			++i;
+		}
+		else {
+			this->lightStamps.erase (i++);
+			newLightSources = true;
+		}
+	}
+	for (AirFlowStamps::iterator i = this->airFlowStamps.begin (); i != this->airFlowStamps.end (); ) {
+		if (i->second.seen) {
+			++i;
+		}
+		else {
+			this->airFlowStamps.erase (i++);
+			newAirPumps = true;
+		}
+	}
+	if (newLightSources) {
+		this->lightSourcesByOwner.clear ();
+		for (LightStamps::iterator i = this->lightStamps.begin (); i != this->lightStamps.end (); ++i) {
+			this->lightSourcesByOwner.insert (std::make_pair (i->second.owner, i->first));
+		}
+		for (std::map<double, LightMap>::iterator m = this->lightMaps.begin (); m != this->lightMaps.end (); ++m) {
+			this->computeLightMap (m->second, m->first);
+		}
+	}
+	if (newAirPumps) {
+		this->airPumpsByOwner.clear ();
+		for (AirFlowStamps::iterator i = this->airFlowStamps.begin (); i != this->airFlowStamps.end (); ++i) {
+			this->airPumpsByOwner.insert (std::make_pair (i->second.owner, i->first));
+		}
+		this->computeAirFlowMap ();
+	}
+	this->dirty = false;
+}
+
+WorldStimulus::Stamp WorldStimulus::
+newStamp (const PhysicalObject *owner, const Point &position, double range) const
+{
+	Stamp result;
+	result.owner = owner;
+	result.position = position;
+	result.intensity = 0;
+	result.seen = true;
+	int x0, y0, x1, y1;
+	this->toIndex (position - Vector (range, range), x0, y0);
+	this->toIndex (position + Vector (range, range), x1, y1);
+	x0 = std::max (x0, 0);
+	y0 = std::max (y0, 0);
+	x1 = std::min (x1, (int) this->size.x - 1);
+	y1 = std::min (y1, (int) this->size.y - 1);
+	result.x = x0;
+	result.y = y0;
+	result.width = std::max (x1 - x0 + 1, 0);
+	result.height = std::max (y1 - y0 + 1, 0);
+	return result;
+}
+
+void WorldStimulus::
+addLight (LightMap &map, double wavelength, const LightSourceFromAbove *source, const Stamp &stamp, double intensity)
+{
+	const double factor = intensity * source->getSpectralFactor (wavelength);
+	if (factor == 0) {
+		return ;
+	}
+	for (int x = 0; x < stamp.width; x++) {
+		std::vector<double> &column = map [stamp.x + x];
+		for (int y = 0; y < stamp.height; y++) {
+			column [stamp.y + y] += factor * stamp.weight [x * stamp.height + y];
+		}
+	}
+}
+
+void WorldStimulus::
+addAirFlow (const Stamp &stamp, double intensity)
+{
+	if (intensity == 0) {
+		return ;
+	}
+	for (int x = 0; x < stamp.width; x++) {
+		std::vector<Vector> &column = this->airFlowMap [stamp.x + x];
+		for (int y = 0; y < stamp.height; y++) {
+			column [stamp.y + y] += stamp.direction [x * stamp.height + y] * intensity;
+		}
+	}
+}
+
+void WorldStimulus::
+computeLightMap (LightMap &map, double wavelength)
+{
+	map.assign (this->size.x, std::vector<double> (this->size.y, 0));
+	for (LightStamps::const_iterator i = this->lightStamps.begin (); i != this->lightStamps.end (); ++i) {
+		this->addLight (map, wavelength, i->first, i->second, i->second.intensity);
+	}
+}
+
+void WorldStimulus::
+computeAirFlowMap ()
+{
+	this->airFlowMap.assign (this->size.x, std::vector<Vector> (this->size.y, Vector (0, 0)));
+	for (AirFlowStamps::const_iterator i = this->airFlowStamps.begin (); i != this->airFlowStamps.end (); ++i) {
+		this->addAirFlow (i->second, i->second.intensity);
+	}
+}
+
+void WorldStimulus::
+cellAt (const Point &position, int &x, int &y, double &dx, double &dy) const
+{
+	const double fx = (position.x - this->origin.x) / this->gridScale;
+	const double fy = (position.y - this->origin.y) / this->gridScale;
+	x = std::max (0, std::min ((int) std::floor (fx), (int) this->size.x - 2));
+	y = std::max (0, std::min ((int) std::floor (fy), (int) this->size.y - 2));
+	dx = std::max (0.0, std::min (fx - x, 1.0));
+	dy = std::max (0.0, std::min (fy - y, 1.0));
+}
+
+/* static */ double WorldStimulus::
+sample (const Stamp &stamp, int x, int y, double dx, double dy)
+{
+	double result = 0;
+	for (int i = 0; i < 2; i++) {
+		const int sx = x + i - stamp.x;
+		if (sx < 0 || sx >= stamp.width) {
+			continue;
+		}
+		for (int j = 0; j < 2; j++) {
+			const int sy = y + j - stamp.y;
+			if (sy < 0 || sy >= stamp.height) {
+				continue;
+			}
+			result += (i ? dx : 1 - dx) * (j ? dy : 1 - dy) * stamp.weight [sx * stamp.height + sy];
+		}
+	}
+	return result;
+}
+
+/* static */ Vector WorldStimulus::
+sampleDirection (const Stamp &stamp, int x, int y, double dx, double dy)
+{
+	Vector result (0, 0);
+	for (int i = 0; i < 2; i++) {
+		const int sx = x + i - stamp.x;
+		if (sx < 0 || sx >= stamp.width) {
+			continue;
+		}
+		for (int j = 0; j < 2; j++) {
+			const int sy = y + j - stamp.y;
+			if (sy < 0 || sy >= stamp.height) {
+				continue;
+			}
+			result += stamp.direction [sx * stamp.height + sy] * ((i ? dx : 1 - dx) * (j ? dy : 1 - dy));
+		}
+	}
+	return result;
+}
+
+/* static */ double WorldStimulus::
+airFlowIntensity (const AirPump *airPump)
+{
+	const double intensity = airPump->getIntensity ();
+	return intensity < std::numeric_limits<double>::epsilon () ? 0 : intensity;
+}
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,187 @@
+#ifndef __WORLD_STIMULUS_H
+#define __WORLD_STIMULUS_H
+
+#include <map>
+#include <vector>
+
+#include "extensions/ExtendedWorld.h"
+#include "interactions/AbstractGrid.h"
+
+namespace Enki
+{
+	class LightSourceFromAbove;
+	class AirPump;
+
+	/**
+	 * Light and air flow of the world, cached in grids.  Light sources
+	 * and air pumps that do not move, such as the ones of the CASUs, are
+	 * rasterised once into a stamp that holds their contribution, at unit
+	 * intensity, to the cells within their range.  The maps are the sum
+	 * of the stamps scaled by the source intensities, and are only
+	 * updated when the intensity of a source changes, or when sources are
+	 * added or removed.  Reading the light or air flow at a position is a
+	 * bilinear interpolation of the four surrounding cells.
+	 *
+	 * <p> Sources that move, which have a positive mass, are not
+	 * rasterised.  They are evaluated directly when the maps are read.
+	 *
+	 * <p> The sensors of a robot do not sense the sources of the same
+	 * robot.  Their stamps are subtracted from the map value.  Mapped
+	 * sources are sensed up to their own range, whatever the range of the
+	 * sensor.
+	 *
+	 * <p> There is a light map for each wavelength that is read.
+	 */
+	class WorldStimulus :
+		public AbstractGrid
+	{
+	private:
+		/**
+		 * Contribution of a source to the cells around it, at unit
+		 * intensity.
+		 */
+		struct Stamp
+		{
+			/**
+			 * Robot of the source.
+			 */
+			const PhysicalObject *owner;
+			/**
+			 * Position of the source when the stamp was computed.
+			 */
+			Point position;
+			/**
+			 * Intensity of the source added to the maps.
+			 */
+			double intensity;
+			/**
+			 * First cell and size of the stamp.
+			 */
+			int x, y, width, height;
+			/**
+			 * Fraction of the maximum intensity that reaches each cell.
+			 * Only used by light sources.
+			 */
+			std::vector<double> weight;
+			/**
+			 * Direction of the air flow in each cell.  Only used by air
+			 * pumps.
+			 */
+			std::vector<Vector> direction;
+			/**
+			 * Whether the source was found when the sources were last
+			 * checked.
+			 */
+			bool seen;
+		};
+		typedef std::map<const LightSourceFromAbove *, Stamp> LightStamps;
+		typedef std::map<const AirPump *, Stamp> AirFlowStamps;
+		typedef std::vector<std::vector<double> > LightMap;
+		/**
+		 * World whose light sources and air pumps are rasterised.
+		 */
+		const ExtendedWorld *world;
+		/**
+		 * Whether the world was stepped since the sources were checked.
+		 */
+		bool dirty;
+		LightStamps lightStamps;
+		AirFlowStamps airFlowStamps;
+		/**
+		 * Light map of each wavelength read so far.
+		 */
+		std::map<double, LightMap> lightMaps;
+		std::vector<std::vector<Vector> > airFlowMap;
+		/**
+		 * Mapped sources of each robot, used to remove their contribution
+		 * from the readings of the robot own sensors.
+		 */
+		std::multimap<const PhysicalObject *, const LightSourceFromAbove *> lightSourcesByOwner;
+		std::multimap<const PhysicalObject *, const AirPump *> airPumpsByOwner;
+		/**
+		 * Sources that are not rasterised, found when the sources were
+		 * last checked.
+		 */
+		std::vector<const LightSourceFromAbove *> mobileLightSources;
+		std::vector<const AirPump *> mobileAirPumps;
+	public:
+		/**
+		 * Construct the light and air flow maps of the given world.
+		 *
+		 * @param gridScale Length of a cell, in cm.
+		 */
+		WorldStimulus (const ExtendedWorld *world, double gridScale, double borderSize);
+		virtual ~WorldStimulus ();
+		/**
+		 * Return the light intensity of the given wavelength at the given
+		 * position, without the sources of the given robot.
+		 */
+		double getLightAt (const Point &position, double wavelength, const PhysicalObject *exclude = NULL);
+		/**
+		 * Return the air flow at the given position, without the air pumps
+		 * of the given robot.
+		 */
+		Vector getAirFlowAt (const Point &position, const PhysicalObject *exclude = NULL);
+
+		virtual void initParameters (const ExtendedWorld *world);
+		virtual void initStateComputing (double deltaTime);
+		/**
+		 * Mark the sources as to be checked.  They are checked when the maps
+		 * are next read, after commands have changed the intensities.
+		 */
+		virtual void computeNextState (double deltaTime);
+	private:
+		/**
+		 * Compute the stamps of new sources, and update the maps with the
+		 * sources whose intensity changed.
+		 */
+		void update ();
+		/**
+		 * Compute the stamp of a source with the given range.  Only the
+		 * cells are set.
+		 */
+		Stamp newStamp (const PhysicalObject *owner, const Point &position, double range) const;
+		/**
+		 * Add the light of a source at the given intensity to a map.
+		 */
+		void addLight (LightMap &map, double wavelength, const LightSourceFromAbove *source, const Stamp &stamp, double intensity);
+		/**
+		 * Add the air flow of a pump at the given intensity to the map.
+		 */
+		void addAirFlow (const Stamp &stamp, double intensity);
+		/**
+		 * Compute a light map from all the stamps.
+		 */
+		void computeLightMap (LightMap &map, double wavelength);
+		/**
+		 * Compute the air flow map from all the stamps.
+		 */
+		void computeAirFlowMap ();
+		/**
+		 * Cell at the bottom left of a position, and the position in that
+		 * cell, used by bilinear interpolation.
+		 */
+		void cellAt (const Point &position, int &x, int &y, double &dx, double &dy) const;
+		/**
+		 * Bilinear interpolation of the weights of a stamp.
+		 */
+		static double sample (const Stamp &stamp, int x, int y, double dx, double dy);
+		/**
+		 * Bilinear interpolation of the directions of a stamp.
+		 */
+		static Vector sampleDirection (const Stamp &stamp, int x, int y, double dx, double dy);
+		/**
+		 * Air flow intensity of a pump.  Pumps with minimal intensity do
+		 * not produce air flow.
+		 */
+		static double airFlowIntensity (const AirPump *airPump);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
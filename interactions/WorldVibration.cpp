@@ -0,0 +1,192 @@
+#include <cmath>
+
+#include "WorldVibration.h"
+#include "WaveVibrationSource.h"
+#include "NotSimulated.h"
+
+using namespace Enki;
+
+WorldVibration::
+WorldVibration (const ExtendedWorld *world, double gridScale, double borderSize, double parallelismLevel):
+	AbstractGrid (world, gridScale, borderSize),
+	AbstractGridParallelSimulation (parallelismLevel, this, true),
+	world (world),
+	time (0),
+	dirty (true)
+{
+	for (int i = 0; i < 2; i++) {
+		this->strongest [i].resize (this->size.x);
+		this->envelope [i].resize (this->size.x);
+		for (int x = 0; x < this->size.x; x++) {
+			this->strongest [i][x].resize (this->size.y, -1);
+			this->envelope [i][x].resize (this->size.y, 0);
+		}
+	}
+}
+
+WorldVibration::
+~WorldVibration ()
+{
+}
+
+double WorldVibration::
+getVibrationAt (const Point &position)
+{
+	this->update ();
+	int x, y;
+	this->cellAt (position, x, y);
+	return this->grid [this->adtIndex][x][y];
+}
+
+WorldVibration::Reading WorldVibration::
+getVibrationAt (const Point &position, const PhysicalObject *exclude)
+{
+	this->update ();
+	int x, y;
+	this->cellAt (position, x, y);
+	Reading result;
+	result.amplitude = this->grid [this->adtIndex][x][y];
+	// remove the waves of the excluded sources, at the cell centre where
+	// they were added
+	const Point where (this->origin.x + x * this->gridScale, this->origin.y + y * this->gridScale);
+	typedef std::multimap<const PhysicalObject *, const VibrationSource *>::const_iterator OwnerIterator;
+	std::pair<OwnerIterator, OwnerIterator> own = this->sourcesByOwner.equal_range (exclude);
+	for (OwnerIterator i = own.first; i != own.second; ++i) {
+		const VibrationSource *source = i->second;
+		const double range = source->LocalInteraction::r;
+		if ((where - source->getAbsolutePosition ()).norm2 () <= range * range) {
+			try {
+				result.amplitude -= source->getWaveAt (where, this->time);
+			}
+			catch (NotSimulated *ns) {
+			}
+		}
+	}
+	result.source = NULL;
+	for (int i = 0; i < 2 && result.source == NULL; i++) {
+		const int index = this->strongest [i][x][y];
+		if (index < 0) {
+			break;
+		}
+		if (this->sources [index]->Component::owner != exclude) {
+			result.source = this->sources [index];
+		}
+	}
+	return result;
+}
+
+void WorldVibration::
+initParameters (const ExtendedWorld *world)
+{
+	this->world = world;
+	for (int i = 0; i < 2; i++) {
+		this->grid [i].assign (this->size.x, std::vector<double> (this->size.y, 0));
+	}
+	this->dirty = true;
+}
+
+void WorldVibration::
+initStateComputing (double deltaTime)
+{
+}
+
+void WorldVibration::
+computeNextState (double deltaTime)
+{
+	this->dirty = true;
+}
+
+void WorldVibration::
+update ()
+{
+	if (!this->dirty && this->time == this->world->getAbsoluteTime ()) {
+		return ;
+	}
+	this->time = this->world->getAbsoluteTime ();
+	this->sources.clear ();
+	this->sourcesByOwner.clear ();
+	for (World::ObjectsIterator i = this->world->objects.begin (); i != this->world->objects.end (); ++i) {
+		VibrationSource *source = dynamic_cast<VibrationSource *> (*i);
+		if (source != NULL) {
+			// sources may not have been moved yet in this step
+			source->Component::init ();
+			this->sources.push_back (source);
+			this->sourcesByOwner.insert (std::make_pair (source->Component::owner, source));
+		}
+	}
+	AbstractGridParallelSimulation::updateState (0);
+	this->dirty = false;
+}
+
+void WorldVibration::
+updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax)
+{
+	const int nextAdtIndex = 1 - this->adtIndex;
+	for (int x = xmin; x < xmax; x++) {
+		for (int y = ymin; y < ymax; y++) {
+			this->grid [nextAdtIndex][x][y] = 0;
+			this->strongest [0][x][y] = this->strongest [1][x][y] = -1;
+			this->envelope [0][x][y] = this->envelope [1][x][y] = 0;
+		}
+	}
+	for (int i = 0; i < (int) this->sources.size (); i++) {
+		const VibrationSource *source = this->sources [i];
+		const WaveVibrationSource *wave = dynamic_cast<const WaveVibrationSource *> (source);
+		const Point &centre = source->getAbsolutePosition ();
+		const double range = source->LocalInteraction::r;
+		// cells of this block within range of the source
+		int x0, y0, x1, y1;
+		this->toIndex (centre - Vector (range, range), x0, y0);
+		this->toIndex (centre + Vector (range, range), x1, y1);
+		x0 = std::max (x0, xmin);
+		y0 = std::max (y0, ymin);
+		x1 = std::min (x1 + 1, xmax);
+		y1 = std::min (y1 + 1, ymax);
+		for (int x = x0; x < x1; x++) {
+			for (int y = y0; y < y1; y++) {
+				const Point where (this->origin.x + x * this->gridScale, this->origin.y + y * this->gridScale);
+				const double distance2 = (where - centre).norm2 ();
+				if (distance2 > range * range) {
+					continue;
+				}
+				double value;
+				try {
+					value = source->getWaveAt (where, this->time);
+				}
+				catch (NotSimulated *ns) {
+					continue;
+				}
+				this->grid [nextAdtIndex][x][y] += value;
+				// keep the two sources with the largest envelope
+				const double envelope =
+					wave != NULL
+					? wave->maximumAmplitude / (1 + distance2 * wave->amplitudeQuadraticDecay)
+					: std::fabs (value);
+				if (this->strongest [0][x][y] < 0 || envelope > this->envelope [0][x][y]) {
+					this->strongest [1][x][y] = this->strongest [0][x][y];
+					this->envelope [1][x][y] = this->envelope [0][x][y];
+					this->strongest [0][x][y] = i;
+					this->envelope [0][x][y] = envelope;
+				}
+				else if (this->strongest [1][x][y] < 0 || envelope > this->envelope [1][x][y]) {
+					this->strongest [1][x][y] = i;
+					this->envelope [1][x][y] = envelope;
+				}
+			}
+		}
+	}
+}
+
+void WorldVibration::
+cellAt (const Point &position, int &x, int &y) const
+{
+	this->toIndex (position, x, y);
+	x = std::max (0, std::min (x, (int) this->size.x - 1));
+	y = std::max (0, std::min (y, (int) this->size.y - 1));
+}
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
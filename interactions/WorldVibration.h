@@ -0,0 +1,133 @@
+#ifndef __WORLD_VIBRATION_H
+#define __WORLD_VIBRATION_H
+
+#include <map>
+#include <vector>
+
+#include "extensions/ExtendedWorld.h"
+#include "interactions/AbstractGridParallelSimulation.h"
+#include "interactions/VibrationSource.h"
+
+namespace Enki
+{
+	/**
+	 * Vibration field of the world, sampled on a grid.  Once per time
+	 * step, the first time the field is read, every vibration source adds
+	 * its wave to the cells within its range, so reading the field at a
+	 * position is a cell lookup.  The cost of a step depends on the number
+	 * of cells covered by the sources, and no longer on the number of
+	 * sources times the number of sensors.
+	 *
+	 * <p> Besides the superposed wave, each cell keeps the two sources
+	 * with the largest amplitude envelope at the cell.  Sensors use them
+	 * to report the frequency of the strongest source that is not on
+	 * their own robot.
+	 *
+	 * <p> The field is computed at the world absolute time.  Cells are
+	 * computed by the worker threads of {@code
+	 * AbstractGridParallelSimulation}, each one taking a block of cells.
+	 */
+	class WorldVibration :
+		public AbstractGridParallelSimulation<WorldVibration, double>
+	{
+	public:
+		/**
+		 * A source with its contribution removed from a cell value.
+		 */
+		struct Reading
+		{
+			/**
+			 * Wave at the position, without the excluded sources.
+			 */
+			double amplitude;
+			/**
+			 * Strongest source at the position that was not excluded, or
+			 * {@code NULL} if there is none in range.
+			 */
+			const VibrationSource *source;
+		};
+	private:
+		/**
+		 * World whose vibration sources are rasterised.
+		 */
+		const ExtendedWorld *world;
+		/**
+		 * Time of the field in the grid.
+		 */
+		double time;
+		/**
+		 * Whether the world was stepped since the field was computed.
+		 */
+		bool dirty;
+		/**
+		 * Vibration sources of the last computed field.
+		 */
+		std::vector<VibrationSource *> sources;
+		/**
+		 * Sources of each robot, used to remove their contribution from
+		 * the readings of the robot own sensors.
+		 */
+		std::multimap<const PhysicalObject *, const VibrationSource *> sourcesByOwner;
+		/**
+		 * Index in {@code sources} of the strongest and second strongest
+		 * source of each cell, or -1.
+		 */
+		std::vector<std::vector<int> > strongest [2];
+		/**
+		 * Amplitude envelopes of the sources in {@code strongest}.  Only
+		 * used while the field is computed.
+		 */
+		std::vector<std::vector<double> > envelope [2];
+	public:
+		/**
+		 * Construct a vibration field for the given world.
+		 *
+		 * @param gridScale Length of a cell, in cm.
+		 *
+		 * @param parallelismLevel Percentage of the CPU threads used to
+		 * compute the field.
+		 */
+		WorldVibration (const ExtendedWorld *world, double gridScale, double borderSize, double parallelismLevel);
+		virtual ~WorldVibration ();
+		/**
+		 * Return the vibration amplitude at the given position.
+		 */
+		double getVibrationAt (const Point &position);
+		/**
+		 * Return the vibration at the given position, without the waves of
+		 * the sources of the given robot.
+		 */
+		Reading getVibrationAt (const Point &position, const PhysicalObject *exclude);
+
+		virtual void initParameters (const ExtendedWorld *world);
+		virtual void initStateComputing (double deltaTime);
+		/**
+		 * Mark the field as out of date.  It is computed again when it is
+		 * next read, after the robots have been updated.
+		 */
+		virtual void computeNextState (double deltaTime);
+		/**
+		 * Add the waves of all sources to the cells of a block.  Called by
+		 * the worker threads.
+		 */
+		void updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax);
+	private:
+		/**
+		 * Compute the field if the world was stepped since the last
+		 * computation.
+		 */
+		void update ();
+		/**
+		 * Index of the cell at the given position, clamped to the grid.
+		 */
+		void cellAt (const Point &position, int &x, int &y) const;
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,337 @@
+/* Headless scalability benchmark of the simulation.
+
+   Builds synthetic arenas in-process, with CASUs on a grid and bees
+   wandering at random, runs them for a fixed number of steps without
+   the ZMQ interface or the viewer, and prints the results as JSON.
+
+   Options that accept a comma separated list (casus, bees, radius,
+   heat_scale, parallelism) are combined, one run per combination, to
+   produce scaling curves.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#include "extensions/ExtendedWorld.h"
+#include "extensions/PerfCounters.h"
+
+#include "SyntheticArena.h"
+
+using namespace std;
+using namespace Enki;
+
+namespace po = boost::program_options;
+
+//! Same step as the playground
+static const double DELTA_TIME = .03;
+static const unsigned PHYSICS_OVERSAMPLING = 3;
+
+//! Parameters of one synthetic arena.
+struct Scenario
+{
+    int casus;
+    int bees;
+    double radius;
+    double heat_scale;
+    double parallelism;
+};
+
+//! Parameters shared by all runs.
+struct Settings
+{
+    unsigned ticks;
+    unsigned warmup;
+    double env_temp;
+    double casu_temp;
+    double casu_spacing;
+    int border_size;
+    //! Steps between changes of the bee wheel speeds
+    unsigned wander_period;
+    unsigned seed;
+};
+
+//! Measurements of one run.
+struct Result
+{
+    bool valid;
+    double setup_seconds;
+    double run_seconds;
+    long rss_kb;
+    long peak_rss_kb;
+    vector<PerfCounters::Summary> phases;
+};
+
+// -----------------------------------------------------------------------------
+
+//! Resident set size of the process, in kB.
+static long currentRss()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f)
+    {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//! Peak resident set size of the process, in kB.
+static long peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+//! Parse a comma separated list of values.
+template<typename T>
+static bool parseList(const string& text, vector<T>& values)
+{
+    vector<string> items;
+    boost::split(items, text, boost::is_any_of(","));
+    BOOST_FOREACH(string item, items)
+    {
+        boost::trim(item);
+        try
+        {
+            values.push_back(boost::lexical_cast<T>(item));
+        }
+        catch (boost::bad_lexical_cast&)
+        {
+            cerr << "Invalid value " << item << " in list " << text << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Build the arena of a scenario, run it and measure it.
+static Result runScenario(const Scenario& scenario, const Settings& settings)
+{
+    Result result;
+    result.valid = false;
+
+    double start = PerfCounters::now();
+    ArenaSettings arena_settings;
+    arena_settings.casus = scenario.casus;
+    arena_settings.bees = scenario.bees;
+    arena_settings.radius = scenario.radius;
+    arena_settings.heat_scale = scenario.heat_scale;
+    arena_settings.parallelism = scenario.parallelism;
+    arena_settings.env_temp = settings.env_temp;
+    arena_settings.casu_temp = settings.casu_temp;
+    arena_settings.casu_spacing = settings.casu_spacing;
+    arena_settings.border_size = settings.border_size;
+    // Same arena for every run with the same parameters
+    SyntheticArena arena(arena_settings, ModelParameters(), settings.seed);
+    if (!arena.validParameters(DELTA_TIME))
+    {
+        cerr << "Parameters of heat model are not valid for heat scale "
+             << scenario.heat_scale << endl;
+        return result;
+    }
+    ExtendedWorld* world = arena.getWorld();
+    result.setup_seconds = PerfCounters::now() - start;
+
+    for (unsigned t = 0; t < settings.warmup + settings.ticks; t++)
+    {
+        if (t == settings.warmup)
+        {
+            start = PerfCounters::now();
+        }
+        if (t % settings.wander_period == 0)
+        {
+            arena.wander();
+        }
+        world->step(DELTA_TIME, PHYSICS_OVERSAMPLING);
+    }
+    result.run_seconds = PerfCounters::now() - start;
+    result.rss_kb = currentRss();
+    result.peak_rss_kb = peakRss();
+    world->perfCounters.summarize(result.phases);
+    result.valid = true;
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+static void printResult(ostream& os, const Scenario& scenario,
+                        const Settings& settings, const Result& result)
+{
+    os << "    {\"casus\": " << scenario.casus
+       << ", \"bees\": " << scenario.bees
+       << ", \"radius\": " << scenario.radius
+       << ", \"heat_scale\": " << scenario.heat_scale
+       << ", \"parallelism\": " << scenario.parallelism
+       << ", \"valid\": " << (result.valid ? "true" : "false");
+    if (result.valid)
+    {
+        os << ",\n     \"ticks\": " << settings.ticks
+           << ", \"setup_seconds\": " << result.setup_seconds
+           << ", \"run_seconds\": " << result.run_seconds
+           << ", \"ticks_per_second\": " << settings.ticks / result.run_seconds
+           << ", \"realtime_factor\": "
+           << settings.ticks * DELTA_TIME / result.run_seconds
+           << ",\n     \"rss_kb\": " << result.rss_kb
+           << ", \"peak_rss_kb\": " << result.peak_rss_kb
+           << ",\n     \"phases\": [";
+        for (size_t i = 0; i < result.phases.size(); i++)
+        {
+            const PerfCounters::Summary& phase = result.phases[i];
+            os << (i == 0 ? "\n" : ",\n")
+               << "       {\"name\": \"" << phase.name << "\""
+               << ", \"mean\": " << phase.mean
+               << ", \"p50\": " << phase.p50
+               << ", \"p95\": " << phase.p95
+               << ", \"p99\": " << phase.p99
+               << ", \"max\": " << phase.max << "}";
+        }
+        os << "]";
+    }
+    os << "}";
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    string casus_list, bees_list, radius_list, heat_scale_list, parallelism_list;
+    string output_file_name;
+    Settings settings;
+
+    po::options_description desc("Recognized options");
+    desc.add_options
+        ()
+        ("help,h", "produce help message")
+        ("casus,n", po::value<string>(&casus_list)->default_value("9"),
+         "number of CASUs, comma separated list")
+        ("bees,m", po::value<string>(&bees_list)->default_value("50"),
+         "number of bees, comma separated list")
+        ("radius,r", po::value<string>(&radius_list)->default_value("20"),
+         "arena radius in cm, comma separated list")
+        ("heat_scale,s", po::value<string>(&heat_scale_list)->default_value("0.5"),
+         "heat model scale, comma separated list")
+        ("parallelism,p", po::value<string>(&parallelism_list)->default_value("1"),
+         "heat model parallelism level, comma separated list")
+        ("ticks,t", po::value<unsigned>(&settings.ticks)->default_value(1000),
+         "measured simulation steps per run")
+        ("warmup", po::value<unsigned>(&settings.warmup)->default_value(50),
+         "simulation steps run before measuring")
+        ("env_temp", po::value<double>(&settings.env_temp)->default_value(23),
+         "environment temperature, in C")
+        ("casu_temp", po::value<double>(&settings.casu_temp)->default_value(36),
+         "peltier setpoint of all CASUs, in C")
+        ("casu_spacing", po::value<double>(&settings.casu_spacing)->default_value(9),
+         "distance between neighbour CASUs, in cm")
+        ("border_size", po::value<int>(&settings.border_size)->default_value(2),
+         "heat model border size, in cm")
+        ("wander_period", po::value<unsigned>(&settings.wander_period)->default_value(10),
+         "simulation steps between changes of the bee speeds")
+        ("seed", po::value<unsigned>(&settings.seed)->default_value(1),
+         "random seed of the bee positions and speeds")
+        ("output,o", po::value<string>(&output_file_name),
+         "write the JSON results to this file instead of the standard output")
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e)
+    {
+        cerr << e.what() << endl << desc << endl;
+        return 1;
+    }
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 1;
+    }
+    if (settings.ticks == 0 || settings.wander_period == 0)
+    {
+        cerr << "ticks and wander_period must be positive" << endl;
+        return 1;
+    }
+
+    vector<int> casus, bees;
+    vector<double> radii, heat_scales, parallelisms;
+    if (!parseList(casus_list, casus)
+        || !parseList(bees_list, bees)
+        || !parseList(radius_list, radii)
+        || !parseList(heat_scale_list, heat_scales)
+        || !parseList(parallelism_list, parallelisms))
+    {
+        return 1;
+    }
+
+    ofstream output_file;
+    if (vm.count("output"))
+    {
+        output_file.open(output_file_name.c_str());
+        if (!output_file.is_open())
+        {
+            cerr << "Could not open " << output_file_name << endl;
+            return 1;
+        }
+    }
+    ostream& os = output_file.is_open() ? output_file : cout;
+
+    os << "{\"delta_time\": " << DELTA_TIME
+       << ", \"physics_oversampling\": " << PHYSICS_OVERSAMPLING
+       << ", \"warmup\": " << settings.warmup
+       << ", \"seed\": " << settings.seed
+       << ",\n \"runs\": [\n";
+    bool first = true;
+    BOOST_FOREACH(int n, casus)
+    BOOST_FOREACH(int m, bees)
+    BOOST_FOREACH(double radius, radii)
+    BOOST_FOREACH(double heat_scale, heat_scales)
+    BOOST_FOREACH(double parallelism, parallelisms)
+    {
+        Scenario scenario;
+        scenario.casus = n;
+        scenario.bees = m;
+        scenario.radius = radius;
+        scenario.heat_scale = heat_scale;
+        scenario.parallelism = parallelism;
+        cerr << "Running " << n << " CASUs, " << m << " bees, radius "
+             << radius << ", heat scale " << heat_scale
+             << ", parallelism " << parallelism << endl;
+        Result result = runScenario(scenario, settings);
+        if (!first)
+        {
+            os << ",\n";
+        }
+        first = false;
+        printResult(os, scenario, settings, result);
+        os.flush();
+    }
+    os << "\n ]}\n";
+    return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
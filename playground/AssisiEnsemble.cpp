@@ -0,0 +1,497 @@
+/* Ensemble runner for parameter sweeps.
+
+   Runs many independent synthetic arenas in one process, each with
+   its own model parameters and random seed, on a shared pool of
+   worker threads. Each worker takes the next instance, builds its
+   world, runs it to the end and writes its samples to a CSV file, so
+   the machine is not oversubscribed by one process and one heat
+   model thread pool per instance.
+
+   Model parameters use the keys of Playground.cfg. Their base values
+   are read from a configuration file, and each --set option gives a
+   comma separated list of values of one parameter. The ensemble has
+   one instance per combination of values and replicate.
+
+   Each world draws its sensor noise from a generator seeded by the
+   instance seed, so an instance gives the same samples whichever
+   thread runs it.  The range sensors of the CASUs are Enki ones and
+   still draw from the global Enki generator, shared by all threads,
+   but their noise is zero, so their readings do not depend on it.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+
+#include "extensions/PerfCounters.h"
+#include "robots/ModelParameters.h"
+#include "robots/Casu.h"
+#include "robots/Bee.h"
+
+#include "SyntheticArena.h"
+
+using namespace std;
+using namespace Enki;
+
+namespace po = boost::program_options;
+
+//! Same step as the playground
+static const double DELTA_TIME = .03;
+static const unsigned PHYSICS_OVERSAMPLING = 3;
+
+//! A swept parameter and its values.
+struct Sweep
+{
+    string key;
+    vector<double> values;
+};
+
+//! Settings shared by all instances.
+struct Settings
+{
+    ArenaSettings arena;
+    unsigned ticks;
+    //! Steps between changes of the bee wheel speeds
+    unsigned wander_period;
+    //! Steps between CSV samples
+    unsigned sample_period;
+    string output_dir;
+};
+
+//! One world of the ensemble.
+struct Instance
+{
+    unsigned index;
+    unsigned seed;
+    ModelParameters parameters;
+    //! Swept parameters of this instance, for the summary
+    vector<pair<string, double> > values;
+    string csv_file;
+
+    // Results
+    bool valid;
+    double run_seconds;
+    double final_casu_temp;
+    double final_bee_temp;
+};
+
+// -----------------------------------------------------------------------------
+
+//! Ensemble state shared by the worker threads.
+class Ensemble
+{
+public:
+    Ensemble(vector<Instance>& instances, const Settings& settings)
+        : instances_(instances), settings_(settings), next_(0)
+    {
+    }
+
+    //! Run all instances on the given number of threads.
+    void run(unsigned threads)
+    {
+        boost::thread_group workers;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            workers.create_thread(boost::bind(&Ensemble::workerLoop_, this));
+        }
+        workers.join_all();
+    }
+
+private:
+    void workerLoop_()
+    {
+        while (true)
+        {
+            size_t index = next_++;
+            if (index >= instances_.size())
+            {
+                return;
+            }
+            runInstance_(instances_[index]);
+        }
+    }
+
+    void runInstance_(Instance& instance)
+    {
+        instance.valid = false;
+
+        // Building may make the shared CASU hull, so only one arena
+        // is built at a time
+        boost::unique_lock<boost::mutex> lock(build_mutex_);
+        SyntheticArena arena(settings_.arena, instance.parameters, instance.seed);
+        lock.unlock();
+        if (!arena.validParameters(DELTA_TIME))
+        {
+            report_("Parameters of heat model are not valid", instance);
+            return;
+        }
+
+        ofstream csv(instance.csv_file.c_str());
+        if (!csv.is_open())
+        {
+            report_("Could not open " + instance.csv_file, instance);
+            return;
+        }
+        csv << "time,mean_casu_temp,min_casu_temp,max_casu_temp,mean_bee_temp\n";
+
+        double start = PerfCounters::now();
+        for (unsigned t = 0; t < settings_.ticks; t++)
+        {
+            if (t % settings_.wander_period == 0)
+            {
+                arena.wander();
+            }
+            arena.getWorld()->step(DELTA_TIME, PHYSICS_OVERSAMPLING);
+            if ((t + 1) % settings_.sample_period == 0 || t + 1 == settings_.ticks)
+            {
+                sample_(arena, csv, instance);
+            }
+        }
+        instance.run_seconds = PerfCounters::now() - start;
+        instance.valid = true;
+        report_("Finished", instance);
+    }
+
+    //! Write a CSV row, and keep the values as the final ones.
+    void sample_(SyntheticArena& arena, ostream& csv, Instance& instance)
+    {
+        double casu_sum = 0;
+        double casu_min = HUGE_VAL;
+        double casu_max = -HUGE_VAL;
+        BOOST_FOREACH(Casu* casu, arena.getCasus())
+        {
+            double sum = 0;
+            BOOST_FOREACH(HeatSensor* sensor, casu->temp_sensors)
+            {
+                sum += sensor->getMeasuredHeat();
+            }
+            double temp = sum / casu->temp_sensors.size();
+            casu_sum += temp;
+            casu_min = min(casu_min, temp);
+            casu_max = max(casu_max, temp);
+        }
+        double bee_sum = 0;
+        BOOST_FOREACH(Bee* bee, arena.getBees())
+        {
+            double sum = 0;
+            BOOST_FOREACH(HeatSensor* sensor, bee->heat_sensors)
+            {
+                sum += sensor->getMeasuredHeat();
+            }
+            bee_sum += sum / bee->heat_sensors.size();
+        }
+        size_t casus = arena.getCasus().size();
+        size_t bees = arena.getBees().size();
+        instance.final_casu_temp = casus > 0 ? casu_sum / casus : 0;
+        instance.final_bee_temp = bees > 0 ? bee_sum / bees : 0;
+        csv << arena.getWorld()->getAbsoluteTime()
+            << ',' << instance.final_casu_temp
+            << ',' << (casus > 0 ? casu_min : 0)
+            << ',' << (casus > 0 ? casu_max : 0)
+            << ',' << instance.final_bee_temp << '\n';
+    }
+
+    void report_(const string& message, const Instance& instance)
+    {
+        boost::lock_guard<boost::mutex> lock(report_mutex_);
+        cerr << message << ": instance " << instance.index << endl;
+    }
+
+    vector<Instance>& instances_;
+    const Settings& settings_;
+    boost::atomic<size_t> next_;
+    boost::mutex build_mutex_;
+    boost::mutex report_mutex_;
+};
+
+// -----------------------------------------------------------------------------
+
+//! Parse KEY=v1,v2,... into a sweep.
+static bool parseSweep(const string& text, Sweep& sweep)
+{
+    string::size_type equal = text.find('=');
+    if (equal == string::npos)
+    {
+        cerr << "Expected KEY=VALUES in " << text << endl;
+        return false;
+    }
+    sweep.key = boost::trim_copy(text.substr(0, equal));
+    double value;
+    if (!ModelParameters().get(sweep.key, value))
+    {
+        cerr << "Unknown model parameter " << sweep.key << endl;
+        return false;
+    }
+    string values = text.substr(equal + 1);
+    vector<string> items;
+    boost::split(items, values, boost::is_any_of(","));
+    BOOST_FOREACH(string item, items)
+    {
+        boost::trim(item);
+        try
+        {
+            sweep.values.push_back(boost::lexical_cast<double>(item));
+        }
+        catch (boost::bad_lexical_cast&)
+        {
+            cerr << "Invalid value " << item << " in " << text << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Read the base model parameters from a configuration file.
+static bool readConfig(const string& filename, ModelParameters& parameters)
+{
+    po::options_description options;
+    BOOST_FOREACH(const string& key, ModelParameters::keys())
+    {
+        options.add_options()(key.c_str(), po::value<double>(), "");
+    }
+    ifstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        cerr << "Could not open " << filename << endl;
+        return false;
+    }
+    po::variables_map vm;
+    po::store(po::parse_config_file(file, options, true), vm);
+    BOOST_FOREACH(const string& key, ModelParameters::keys())
+    {
+        if (vm.count(key))
+        {
+            parameters.set(key, vm[key].as<double>());
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+//! One instance per combination of swept values and replicate.
+static void makeInstances(const vector<Sweep>& sweeps,
+                          const ModelParameters& base,
+                          unsigned replicates, unsigned seed,
+                          const string& output_dir,
+                          vector<Instance>& instances)
+{
+    size_t combinations = 1;
+    BOOST_FOREACH(const Sweep& sweep, sweeps)
+    {
+        combinations *= sweep.values.size();
+    }
+    for (size_t c = 0; c < combinations; c++)
+    {
+        Instance instance;
+        instance.parameters = base;
+        // Mixed radix decomposition, last sweep varying fastest
+        size_t rest = c;
+        instance.values.resize(sweeps.size());
+        for (size_t s = sweeps.size(); s-- > 0;)
+        {
+            double value = sweeps[s].values[rest % sweeps[s].values.size()];
+            rest /= sweeps[s].values.size();
+            instance.parameters.set(sweeps[s].key, value);
+            instance.values[s] = make_pair(sweeps[s].key, value);
+        }
+        for (unsigned r = 0; r < replicates; r++)
+        {
+            instance.index = instances.size();
+            instance.seed = seed + r;
+            char name[32];
+            snprintf(name, sizeof(name), "/instance_%04u.csv", instance.index);
+            instance.csv_file = output_dir + name;
+            instance.valid = false;
+            instance.run_seconds = 0;
+            instance.final_casu_temp = instance.final_bee_temp = 0;
+            instances.push_back(instance);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static void printSummary(ostream& os, const Settings& settings,
+                         const vector<Instance>& instances,
+                         unsigned threads, double seconds)
+{
+    os << "{\"delta_time\": " << DELTA_TIME
+       << ", \"ticks\": " << settings.ticks
+       << ", \"threads\": " << threads
+       << ", \"seconds\": " << seconds
+       << ",\n \"instances\": [";
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        const Instance& instance = instances[i];
+        os << (i == 0 ? "\n" : ",\n")
+           << "    {\"index\": " << instance.index
+           << ", \"seed\": " << instance.seed
+           << ", \"parameters\": {";
+        for (size_t v = 0; v < instance.values.size(); v++)
+        {
+            os << (v == 0 ? "" : ", ") << "\"" << instance.values[v].first
+               << "\": " << instance.values[v].second;
+        }
+        os << "}, \"valid\": " << (instance.valid ? "true" : "false");
+        if (instance.valid)
+        {
+            os << ", \"csv_file\": \"" << instance.csv_file << "\""
+               << ", \"run_seconds\": " << instance.run_seconds
+               << ", \"final_casu_temp\": " << instance.final_casu_temp
+               << ", \"final_bee_temp\": " << instance.final_bee_temp;
+        }
+        os << "}";
+    }
+    os << "\n ]}\n";
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    string config_file_name, output_file_name;
+    vector<string> sweep_texts;
+    unsigned replicates, seed, threads;
+    Settings settings;
+
+    po::options_description desc("Recognized options");
+    desc.add_options
+        ()
+        ("help,h", "produce help message")
+        ("config,c", po::value<string>(&config_file_name),
+         "configuration file with the base model parameters, such as Playground.cfg")
+        ("set", po::value<vector<string> >(&sweep_texts),
+         "swept model parameter, as KEY=v1,v2,...; may be repeated")
+        ("replicates,r", po::value<unsigned>(&replicates)->default_value(1),
+         "instances with different seeds for each combination of values")
+        ("seed", po::value<unsigned>(&seed)->default_value(1),
+         "seed of the first replicate")
+        ("threads,j", po::value<unsigned>(&threads)->default_value(0),
+         "worker threads, 0 for one per core")
+        ("casus,n", po::value<int>(&settings.arena.casus)->default_value(9),
+         "number of CASUs")
+        ("bees,m", po::value<int>(&settings.arena.bees)->default_value(50),
+         "number of bees")
+        ("radius", po::value<double>(&settings.arena.radius)->default_value(20),
+         "arena radius in cm")
+        ("heat_scale,s", po::value<double>(&settings.arena.heat_scale)->default_value(0.5),
+         "heat model scale")
+        ("env_temp", po::value<double>(&settings.arena.env_temp)->default_value(23),
+         "environment temperature, in C")
+        ("casu_temp", po::value<double>(&settings.arena.casu_temp)->default_value(36),
+         "peltier setpoint of all CASUs, in C")
+        ("casu_spacing", po::value<double>(&settings.arena.casu_spacing)->default_value(9),
+         "distance between neighbour CASUs, in cm")
+        ("border_size", po::value<int>(&settings.arena.border_size)->default_value(2),
+         "heat model border size, in cm")
+        ("ticks,t", po::value<unsigned>(&settings.ticks)->default_value(1000),
+         "simulation steps per instance")
+        ("wander_period", po::value<unsigned>(&settings.wander_period)->default_value(10),
+         "simulation steps between changes of the bee speeds")
+        ("sample_period", po::value<unsigned>(&settings.sample_period)->default_value(100),
+         "simulation steps between samples in the instance CSV files")
+        ("output_dir,d", po::value<string>(&settings.output_dir)->default_value("."),
+         "directory of the instance CSV files")
+        ("output,o", po::value<string>(&output_file_name),
+         "write the JSON summary to this file instead of the standard output")
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e)
+    {
+        cerr << e.what() << endl << desc << endl;
+        return 1;
+    }
+    if (vm.count("help"))
+    {
+        cout << desc << endl << "Model parameters:";
+        BOOST_FOREACH(const string& key, ModelParameters::keys())
+        {
+            cout << " " << key;
+        }
+        cout << endl;
+        return 1;
+    }
+    if (settings.ticks == 0 || settings.wander_period == 0
+        || settings.sample_period == 0 || replicates == 0)
+    {
+        cerr << "ticks, wander_period, sample_period and replicates must be positive" << endl;
+        return 1;
+    }
+    // All the concurrency comes from the worker pool
+    settings.arena.parallelism = 0;
+
+    ModelParameters base;
+    if (vm.count("config") && !readConfig(config_file_name, base))
+    {
+        return 1;
+    }
+    vector<Sweep> sweeps(sweep_texts.size());
+    for (size_t i = 0; i < sweep_texts.size(); i++)
+    {
+        if (!parseSweep(sweep_texts[i], sweeps[i]))
+        {
+            return 1;
+        }
+    }
+    vector<Instance> instances;
+    makeInstances(sweeps, base, replicates, seed, settings.output_dir, instances);
+
+    if (threads == 0)
+    {
+        threads = boost::thread::hardware_concurrency();
+    }
+    threads = max(1u, min(threads, static_cast<unsigned>(instances.size())));
+
+    ofstream output_file;
+    if (vm.count("output"))
+    {
+        output_file.open(output_file_name.c_str());
+        if (!output_file.is_open())
+        {
+            cerr << "Could not open " << output_file_name << endl;
+            return 1;
+        }
+    }
+    ostream& os = output_file.is_open() ? output_file : cout;
+
+    cerr << "Running " << instances.size() << " instances on "
+         << threads << " threads" << endl;
+    double start = PerfCounters::now();
+    Ensemble ensemble(instances, settings);
+    ensemble.run(threads);
+    printSummary(os, settings, instances, threads, PerfCounters::now() - start);
+
+    BOOST_FOREACH(const Instance& instance, instances)
+    {
+        if (!instance.valid)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -29,6 +29,13 @@ namespace Enki
 		ViewerWidget::camera.pitch = -M_PI/2;
 		ViewerWidget::camera.altitude = 50;
 		std::cout << "dataSize: " << dataSize << "\n";
+		for (int x = 0; x < dataSize.x; x++) {
+			for (int y = 0; y < dataSize.y; y++) {
+				dataPositions.push_back (Point (
+					-world->r + (x + 1) * worldHeat->gridScale,
+					-world->r + (y + 1) * worldHeat->gridScale));
+			}
+		}
 	}
     
     /* virtual */ 
@@ -285,20 +292,17 @@ void AssisiPlayground::setDataToDiffusivity ()
 void AssisiPlayground::setDataToVibration ()
 {
 	double time = this->extendedWorld->getAbsoluteTime ();
-	Vector pos, where;
-	where.x = -this->world->r + this->worldHeat->gridScale;
-	for (pos.x = 0; pos.x < this->dataSize.x; pos.x++) {
-		where.y = -this->world->r + this->worldHeat->gridScale;
-		for (pos.y = 0; pos.y < this->dataSize.y; pos.y++) {
-			double vibration = this->extendedWorld->getVibrationAmplitudeAt (where, time);
-			double colour = std::min (vibration / this->maxVibration, 1.0);
-			std::vector<float> &dc = this->dataColour [pos.x][pos.y];
+	this->extendedWorld->getVibrationAmplitudesAt (this->dataPositions, time, this->dataValues);
+	std::vector<double>::const_iterator vibration = this->dataValues.begin ();
+	for (int x = 0; x < this->dataSize.x; x++) {
+		for (int y = 0; y < this->dataSize.y; y++) {
+			double colour = std::min (*vibration / this->maxVibration, 1.0);
+			std::vector<float> &dc = this->dataColour [x][y];
 			dc [0] = 0;
 			dc [1] = colour;
 			dc [2] = 0;
-			where.y += this->worldHeat->gridScale;
+			++vibration;
 		}
-		where.x += this->worldHeat->gridScale;
 	}
 }
 
@@ -369,6 +373,15 @@ void AssisiPlayground::drawDataAsCheckerBoard ()
 	}
 }
 
+void AssisiPlayground::timerEvent (QTimerEvent *event)
+{
+	if (!this->extendedWorld->isReadyToStep ()) {
+		updateGL ();
+		return ;
+	}
+	ViewerWidget::timerEvent (event);
+}
+
 void AssisiPlayground::keyPressEvent (QKeyEvent *event)
 {
 	switch (event->key()) {
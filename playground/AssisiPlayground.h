@@ -79,6 +79,12 @@ namespace Enki
 
 		Point dataSize;
 		std::vector<std::vector<std::vector<float> > > dataColour;
+		/**
+		 * World position of each data cell, column after column, and the
+		 * values computed for them in batch.
+		 */
+		std::vector<Point> dataPositions;
+		std::vector<double> dataValues;
 	public:
 		/**
 		 * Whether to show a help message or not.
@@ -109,6 +115,14 @@ namespace Enki
     virtual void renderObjectHook(PhysicalObject *object);
 
 		void keyPressEvent (QKeyEvent *event);
+	protected:
+		/**
+		 * Step the world, unless it would block waiting for lockstep
+		 * controllers.  The scene is then only redrawn, so the window
+		 * stays responsive, and the step is tried again on the next
+		 * timer tick.
+		 */
+		virtual void timerEvent (QTimerEvent *event);
 	private:
 		void drawVibrationLayer_Gradient ();
 		void drawVibrationLayer_Chequerboard ();
@@ -1,18 +1,24 @@
 #include <signal.h>
-#include <sys/time.h>
-#include <semaphore.h>
 
 #include <QApplication>
 #include <QImage>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include "WorldExt.h"
 #include "AssisiPlayground.h"
+#include "RealTimeScheduler.h"
 
 #include "extensions/ExtendedWorld.h"
+#include "extensions/Trace.h"
 #include "interactions/WorldHeat.h"
+#include "interactions/WorldVibration.h"
+#include "interactions/WorldStimulus.h"
+#include "interactions/WorldRayCaster.h"
 
 #include "handlers/PhysicalObjectHandler.h"
 #include "handlers/EPuckHandler.h"
@@ -20,6 +26,7 @@
 #include "handlers/BeeHandler.h"
 
 #include "robots/Bee.h"
+#include "robots/BeeSwarm.h"
 #include "robots/Casu.h"
 
 #include <iostream>
@@ -48,9 +55,38 @@ static WorldExt *world;
  */
 static WorldHeat *heatModel;
 
+/**
+ * Vibration field, used when its cell size is greater than zero.  Otherwise
+ * vibration sensors evaluate each vibration source in range.
+ */
+static WorldVibration *vibrationField = NULL;
+static double vibrationFieldScale = 0;
+
+/**
+ * Light and air flow maps, used when their cell size is greater than zero.
+ * Otherwise light and air flow sensors evaluate each source in range.
+ */
+static WorldStimulus *stimulusMap = NULL;
+static double stimulusMapScale = 0;
+
+/**
+ * Caster of the rays of all bee object sensors, used when its grid cell size
+ * is greater than zero.  Otherwise each object sensor tests every object in
+ * range.
+ */
+static WorldRayCaster *rayCaster = NULL;
+static double objectGridScale = 0;
+
+/**
+ * Swarm that holds the spawned bees when enabled.  Otherwise each bee is an
+ * Enki robot.
+ */
+static BeeSwarm *beeSwarm = NULL;
+static bool useBeeSwarm = false;
+
 /**
  * Timer period used in the headless simulation mode.  If the timer period is
- * greater than zero we use an alarm to update the world at every {@code
+ * greater than zero a real-time scheduler updates the world at every {@code
  * timerPeriod} seconds.  Otherwise a loop is used to update the world.
  */
 static double timerPeriod = 0.01;
@@ -77,10 +113,65 @@ static unsigned int skewMonitorRate = 60;
 static double skewReportThreshold = 0.05;
 
 /**
- * Semaphore used in the headless simulation mode with an alarm to block the
- * main thread.
+ * Default publish period of sensor data.  Unit is seconds of simulated time.
+ * Periods of specific object types and devices are given in the {@code
+ * Publish} section of the configuration file.
+ */
+static double publishPeriod = 0.3;
+
+/**
+ * Maximum number of received commands waiting to be applied to the world.
+ */
+static unsigned int commandQueueSize = 4096;
+
+/**
+ * Whether sensors that give a point-in-time reading are only evaluated when
+ * their reading is published or read by a controller.
  */
-static sem_t block;
+static bool sensingOnDemand = false;
+
+/**
+ * Lockstep mode parameters.  In lockstep mode the simulation waits for the
+ * registered controllers after every step, for at most {@code
+ * lockstepTimeout} seconds of wall time.
+ */
+static bool lockstep = false;
+static double lockstepTimeout = 10;
+static string lockstepTimeoutPolicy = "drop";
+
+/**
+ * Real-time parameters of the headless simulation mode with a timer.  The
+ * overrun policy says what happens when a step takes longer than the timer
+ * period: skip, catchup or slowdown.  A real-time priority of zero keeps the
+ * default scheduling policy, a cpu of -1 does not pin the simulation thread.
+ */
+static string overrunPolicy = "skip";
+static unsigned int maxCatchUp = 10;
+static int realtimePriority = 0;
+static int realtimeCpu = -1;
+
+/**
+ * Capture and replay of the received commands.  A replay runs at the timer
+ * period of the configuration with timing original, or as fast as possible
+ * with timing flat, and the simulator exits when the capture is exhausted.
+ */
+static string captureFile;
+static string replayFile;
+static string replayTiming = "original";
+
+/**
+ * Controller plugins run inside the simulator, each given as the path of the
+ * shared object, optionally followed by a colon and the argument of the
+ * controller.  A thread count of zero uses one thread per core.
+ */
+static vector<string> controllerPlugins;
+static unsigned int controllerThreads = 0;
+
+/**
+ * File where the recorded trace events are written at exit, in builds with
+ * ASSISI_TRACE.
+ */
+static string traceFile;
 
 #define PHYSICS_OVERSAMPLING 3
 
@@ -90,6 +181,8 @@ int runTimer ();
 
 void runLoop ();
 
+void flushTrace ();
+
 int main(int argc, char *argv[])
 {
 	//	QApplication app(argc, argv);
@@ -106,8 +199,10 @@ int main(int argc, char *argv[])
     string sub_address("tcp://*:5556");
 	 string heat_state_filename;
     string heat_log_file_name;
+    string stats_file_name;
     double heat_scale;
     int heat_border_size;
+    bool heat_interpolate_sensors = false;
 
     double maxVibration;
     double parallelismLevel = 1.0;
@@ -159,6 +254,26 @@ int main(int argc, char *argv[])
             po::value<double> (&Casu::VIBRATION_SOURCE_RANGE),
             "vibration range, in cm"
             )
+        (
+            "Vibration.field_scale",
+            po::value<double> (&vibrationFieldScale),
+            "cell size of the vibration field, in cm; 0 evaluates each source at each sensor"
+            )
+        (
+            "Stimulus.map_scale",
+            po::value<double> (&stimulusMapScale),
+            "cell size of the light and air flow maps, in cm; 0 evaluates each source at each sensor"
+            )
+        (
+            "Vibration.spectrum_window",
+            po::value<unsigned> (&Casu::VIBRATION_SPECTRUM_WINDOW),
+            "samples kept by each CASU vibration sensor to publish its spectrum on Acc/Spectrum; 0 keeps none"
+            )
+        (
+            "Vibration.spectrum_peaks",
+            po::value<unsigned> (&Casu::VIBRATION_SPECTRUM_PEAKS),
+            "dominant frequencies published on Acc/Spectrum"
+            )
         (
             "Heat.log_file",
             po::value<string> (&heat_log_file_name)->default_value (""),
@@ -169,6 +284,11 @@ int main(int argc, char *argv[])
             po::value<double> (&WorldHeat::CELL_DISSIPATION),
             "heat lost by cells directly to outside world"
             )
+        (
+            "Heat.interpolate_sensors",
+            po::value<bool> (&heat_interpolate_sensors),
+            "heat sensors interpolate between the four nearest cells instead of reading the nearest one"
+            )
         (
             "AirFlow.pump_range",
             po::value<double> (&Casu::AIR_PUMP_RANGE),
@@ -218,11 +338,56 @@ int main(int argc, char *argv[])
             po::value<double> (&timerPeriod),
             "simulation timer period (in seconds)"
             )
+        (
+            "Simulation.overrun_policy",
+            po::value<string> (&overrunPolicy),
+            "What to do when a step takes longer than the timer period: skip, catchup or slowdown"
+            )
+        (
+            "Simulation.max_catch_up",
+            po::value<unsigned int> (&maxCatchUp),
+            "Maximum number of missed steps run late with the catchup policy"
+            )
+        (
+            "Simulation.realtime_priority",
+            po::value<int> (&realtimePriority),
+            "SCHED_FIFO priority of the simulation thread, 0 to keep the default scheduling"
+            )
+        (
+            "Simulation.cpu",
+            po::value<int> (&realtimeCpu),
+            "CPU the simulation thread is pinned to, -1 for any"
+            )
         (
             "Simulation.parallelism_level",
             po::value<double> (&parallelismLevel),
             "Percentage of CPU threads to use"
             )
+        (
+            "Simulation.command_queue_size",
+            po::value<unsigned int> (&commandQueueSize),
+            "Maximum number of received commands waiting to be applied"
+            )
+        (
+            "Simulation.sensing_on_demand",
+            po::value<bool> (&sensingOnDemand),
+            "Evaluate point-in-time sensors only when their readings are published or read"
+            )
+        (
+            "Lockstep.enabled",
+            po::value<bool> (&lockstep),
+            "Step in lockstep with the registered controllers"
+            )
+        (
+            "Lockstep.timeout",
+            po::value<double> (&lockstepTimeout),
+            "Time to wait for lockstep controllers (in seconds of wall time, 0 waits forever)"
+            )
+        (
+            "Lockstep.timeout_policy",
+            po::value<string> (&lockstepTimeoutPolicy),
+            "What to do with lockstep controllers that time out: proceed or drop"
+            )
         (
             "Bee.body_length",
             po::value<double> (&bee_body_length),
@@ -248,6 +413,16 @@ int main(int argc, char *argv[])
             po::value<double> (&bee_max_speed),
             "Maximum bee motion velocity"
             )
+        (
+            "Bee.swarm",
+            po::value<bool> (&useBeeSwarm),
+            "simulate spawned bees as a swarm stepped in batch instead of Enki robots"
+            )
+        (
+            "Bee.object_grid_scale",
+            po::value<double> (&objectGridScale),
+            "cell size of the object grid used to cast the rays of all object sensors at once, in cm; 0 tests each object at each sensor"
+            )
         (
             "Camera.pos_x",
             po::value<double> (&cameraPosX),
@@ -283,6 +458,46 @@ int main(int argc, char *argv[])
              po::value<double> (&skewReportThreshold),
              "Threshold to print a message because of skewness between real time and simulated time"
             )
+        (
+             "Stats.csv_file",
+             po::value<string> (&stats_file_name)->default_value (""),
+             "CSV file where the Sim/Stats phase timings are also written"
+            )
+        (
+             "Capture.file",
+             po::value<string> (&captureFile)->default_value (""),
+             "Binary file where the received commands are captured, with the step they are applied in"
+            )
+        (
+             "Replay.file",
+             po::value<string> (&replayFile)->default_value (""),
+             "Capture file whose commands are replayed instead of listening to controllers"
+            )
+        (
+             "Replay.timing",
+             po::value<string> (&replayTiming)->default_value ("original"),
+             "Replay at the timer period (original) or as fast as possible (flat)"
+            )
+        (
+             "Controllers.plugin",
+             po::value<vector<string> > (&controllerPlugins),
+             "Controller plugin run inside the simulator, as path[:argument]; may be repeated"
+            )
+        (
+             "Controllers.threads",
+             po::value<unsigned int> (&controllerThreads)->default_value (0),
+             "Threads running the controller plugins, 0 for one per core"
+            )
+        (
+             "Trace.file",
+             po::value<string> (&traceFile)->default_value ("assisi_trace.json"),
+             "Chrome trace file, written on Sim/Trace/Flush and at exit in builds with ASSISI_TRACE"
+            )
+        (
+             "Publish.period",
+             po::value<double> (&publishPeriod),
+             "Default publish period of sensor data (in seconds of simulated time)"
+            )
         ;
 
     po::variables_map vm;
@@ -290,7 +505,10 @@ int main(int argc, char *argv[])
     po::notify(vm);
     // here we read the config file, so it seems crucial that notify is executed first
     ifstream config_file(config_file_name.c_str(), std::ifstream::in);
-    po::store(po::parse_config_file(config_file, desc), vm);
+    // Publish periods of object types and devices have free form names,
+    // such as Publish.Casu or Publish.Casu.Temp, so they are not registered.
+    po::parsed_options config_options = po::parse_config_file(config_file, desc, true);
+    po::store(config_options, vm);
     config_file.close();
 	// not clear what the consequences of >1 notify call are, but no issues noticed
     po::notify(vm);
@@ -300,6 +518,16 @@ int main(int argc, char *argv[])
         cout << desc << endl;
         return 1;
     }
+    // Only the Publish section may hold unregistered keys, anything
+    // else is a misspelled option
+    BOOST_FOREACH (const po::option &o, config_options.options)
+    {
+        if (o.unregistered && !boost::starts_with (o.string_key, "Publish."))
+        {
+            cerr << "Unknown configuration option " << o.string_key << "\n";
+            return 1;
+        }
+    }
 
     //QImage texture("playground/world.png");
     QImage texture(QString(":/textures/ground_grayscale.png"));
@@ -313,7 +541,8 @@ int main(int argc, char *argv[])
             texture.height(),
             (const uint32_t*) texture.constBits ()),
         skewMonitorRate,
-        skewReportThreshold);
+        skewReportThreshold,
+        commandQueueSize);
 
     if (heat_state_filename != "" && vm.count ("Heat.state")) {
        if (vm.count ("Heat.env_temp"))
@@ -326,20 +555,113 @@ int main(int argc, char *argv[])
     }
     else
        heatModel = new WorldHeat (world, env_temp, heat_scale, heat_border_size, parallelismLevel);
+	heatModel->setInterpolation (heat_interpolate_sensors);
+	world->sensingOnDemand = sensingOnDemand;
 	if (heat_log_file_name != "") {
 		heatModel->logToStream (heat_log_file_name);
 	}
 	world->addPhysicSimulation(heatModel);
+	if (vibrationFieldScale > 0) {
+		vibrationField = new WorldVibration (world, vibrationFieldScale, heat_border_size, parallelismLevel);
+		world->addPhysicSimulation (vibrationField);
+	}
+	if (stimulusMapScale > 0) {
+		stimulusMap = new WorldStimulus (world, stimulusMapScale, heat_border_size);
+		world->addPhysicSimulation (stimulusMap);
+	}
+	if (objectGridScale > 0) {
+		rayCaster = new WorldRayCaster (objectGridScale);
+		world->worldRayCaster = rayCaster;
+	}
 	CasuHandler *ch = new CasuHandler();
 	world->addHandler("Casu", ch);
 
 	PhysicalObjectHandler *ph = new PhysicalObjectHandler();
 	world->addHandler("Physical", ph);
 
+	if (useBeeSwarm) {
+		beeSwarm = new BeeSwarm (bee_body_length, bee_body_width, bee_max_speed);
+		world->addPhysicSimulation (beeSwarm);
+	}
 	BeeHandler *bh = new BeeHandler(bee_body_length,bee_body_width, bee_body_height,
-                                    bee_body_mass, bee_max_speed);
+                                    bee_body_mass, bee_max_speed, beeSwarm);
 	world->addHandler("Bee", bh);
 
+	if (stats_file_name != "" && !world->setStatsFile (stats_file_name)) {
+		cerr << "Could not open statistics file " << stats_file_name << "\n";
+	}
+
+	world->setTraceFile (traceFile);
+
+	world->setPublishPeriod (publishPeriod);
+	BOOST_FOREACH (const po::option &o, config_options.options) {
+		if (!o.unregistered) {
+			continue;
+		}
+		// keys are Publish.<Type> or Publish.<Type>.<Device>
+		vector<string> key;
+		boost::split (key, o.string_key, boost::is_any_of ("."));
+		if (key.size () < 2 || key.size () > 3 || o.value.size () != 1) {
+			cerr << "Unknown configuration option " << o.string_key << "\n";
+			continue;
+		}
+		const string device = key.size () == 3 ? key [2] : "";
+		double period;
+		try {
+			period = boost::lexical_cast<double> (o.value [0]);
+		}
+		catch (boost::bad_lexical_cast &e) {
+			cerr << "Invalid publish period for " << o.string_key << "\n";
+			continue;
+		}
+		if (!world->setPublishPeriod (key [1], device, period)) {
+			cerr << "Unknown object type or device in " << o.string_key << "\n";
+		}
+	}
+
+	if (lockstep) {
+		LockstepBarrier::TimeoutPolicy policy;
+		if (lockstepTimeoutPolicy == "proceed") {
+			policy = LockstepBarrier::PROCEED;
+		}
+		else if (lockstepTimeoutPolicy == "drop") {
+			policy = LockstepBarrier::DROP;
+		}
+		else {
+			cerr << "Unknown lockstep timeout policy " << lockstepTimeoutPolicy << "\n";
+			return 1;
+		}
+		world->setLockstep (lockstepTimeout, policy);
+	}
+
+	if (captureFile != "" && !world->setCapture (captureFile)) {
+		cerr << "Could not open capture file " << captureFile << "\n";
+		return 1;
+	}
+	if (replayFile != "") {
+		if (lockstep) {
+			cerr << "Lockstep mode cannot be used in a replay\n";
+			return 1;
+		}
+		if (replayTiming != "original" && replayTiming != "flat") {
+			cerr << "Unknown replay timing " << replayTiming << "\n";
+			return 1;
+		}
+		if (!world->setReplay (replayFile)) {
+			cerr << "Could not read capture file " << replayFile << "\n";
+			return 1;
+		}
+	}
+
+	BOOST_FOREACH (const string& plugin, controllerPlugins) {
+		string::size_type colon = plugin.find (':');
+		string library = plugin.substr (0, colon);
+		string argument = colon == string::npos ? "" : plugin.substr (colon + 1);
+		if (!world->addController (library, argument, controllerThreads)) {
+			return 1;
+		}
+	}
+
 	if (vm.count ("nogui") == 0) {
 		QApplication app(argc, argv);
 
@@ -386,7 +708,9 @@ int main(int argc, char *argv[])
       }
 		viewer.show ();
 	
-		return app.exec();
+		int ret = app.exec();
+		flushTrace ();
+		return ret;
 	}
 	else {
 		if (!heatModel->validParameters (DELTA_TIME)) {
@@ -394,21 +718,41 @@ int main(int argc, char *argv[])
 			return 1;
 		}
 		int ret;
-		if (timerPeriod == 0) {
+		const double start = PerfCounters::now ();
+		// In lockstep mode the controllers set the pace
+		if (timerPeriod == 0 || lockstep || (replayFile != "" && replayTiming == "flat")) {
 			runLoop ();
 			ret = 0;
 		}
 		else {
 			ret = runTimer ();
 		}
+		if (replayFile != "") {
+			const double elapsed = PerfCounters::now () - start;
+			const unsigned long steps = world->perfCounters.getTicks ();
+			cout << "Replayed " << steps << " steps in " << elapsed << " s, "
+			     << steps / elapsed << " steps/s\n";
+		}
 		/* clean up */
+		flushTrace ();
 		delete world;
 		delete heatModel;
+		delete vibrationField;
+		delete stimulusMap;
+		delete rayCaster;
+		delete beeSwarm;
 		cout << "Simulator finished CORRECTLY!!!\n";
 		return ret;
 	}
 }
 
+void flushTrace ()
+{
+	if (ASSISI_TRACE_FLUSH (traceFile)) {
+		cout << "Trace events written to " << traceFile << "\n";
+	}
+}
+
 /**
  * Function assigned to SIGQUIT, SIGINT and SIGTERM signals.
  */
@@ -416,6 +760,7 @@ void finishLoop (int dummy)
 {
 	cout << "Received signal " << dummy << "\n";
 	go = false;
+	world->interruptLockstep ();
 }
 
 void runLoop ()
@@ -428,18 +773,23 @@ void runLoop ()
 	sigaction (SIGINT, &saFinish, 0);
 	sigaction (SIGTERM, &saFinish, 0);
 	/* main loop */
-	while (go) {
+	while (go && !world->isReplayFinished ()) {
 		world->step (DELTA_TIME, PHYSICS_OVERSAMPLING);
 	}
 	return ;
 }
 
 /**
- * Function assigned to SIGALRM signal.
+ * Scheduler used in the headless simulation mode with a timer.
  */
-void progress (int dummy)
+static RealTimeScheduler *scheduler;
+
+void progress ()
 {
 	world->step (DELTA_TIME, PHYSICS_OVERSAMPLING);
+	if (world->isReplayFinished ()) {
+		scheduler->stop ();
+	}
 }
 
 /**
@@ -447,64 +797,43 @@ void progress (int dummy)
  */
 void finishTimer (int dummy)
 {
-	if (sem_post (&block) == -1) {
-	 	perror ("Error unlocking blocking semaphore");
-	}
+	scheduler->stop ();
+	world->interruptLockstep ();
 }
 
 int runTimer ()
 {
-	/* set up the action for control-C */
+	RealTimeScheduler::OverrunPolicy policy;
+	if (overrunPolicy == "skip") {
+		policy = RealTimeScheduler::SKIP;
+	}
+	else if (overrunPolicy == "catchup") {
+		policy = RealTimeScheduler::CATCH_UP;
+	}
+	else if (overrunPolicy == "slowdown") {
+		policy = RealTimeScheduler::SLOW_DOWN;
+	}
+	else {
+		cerr << "Unknown overrun policy " << overrunPolicy << "\n";
+		return 1;
+	}
+	scheduler = new RealTimeScheduler (fabs (timerPeriod), policy);
+	scheduler->setMaxCatchUp (maxCatchUp);
+	/* set up the action for control-C; without SA_RESTART the signal
+	 * interrupts the wait for the next tick */
 	struct sigaction saFinish;
 	saFinish.sa_handler = finishTimer;
+	sigemptyset (&saFinish.sa_mask);
 	saFinish.sa_flags = 0;
 	sigaction (SIGHUP, &saFinish, 0);
 	sigaction (SIGQUIT, &saFinish, 0);
 	sigaction (SIGINT, &saFinish, 0);
 	sigaction (SIGTERM, &saFinish, 0);
-
-	/* set up the action for alarm */
-	struct sigaction saProgresso;
-	saProgresso.sa_handler = progress;
-	saProgresso.sa_flags = 0;
-	sigaction (SIGALRM, &saProgresso, 0);
-	/* set up timer */
-	struct itimerval value;
-	timerPeriod = fabs (timerPeriod);
-	value.it_interval.tv_sec = (time_t) timerPeriod;
-	long usec = timerPeriod * 1000000;
-	while (usec > 999999) {
-		usec -= 1000000;
-	}
-	value.it_interval.tv_usec = usec;
-	value.it_value.tv_sec = 1;
-	value.it_value.tv_usec = 0;
-	setitimer (ITIMER_REAL, &value, NULL);
-	/* initialise blocking a semaphore */
-	int ret;
-	do {
-		ret = sem_init (&block, 0, 0);
-		if (ret != 0) {
-			printf ("errno=%d\n", errno);
-			perror ("initialisation of playground semaphore");
-			return 1;
-		}
-	} while (ret == -1 && errno == EAGAIN);
-	/* block on a semaphore */
-	do {
-		do {
-			ret = sem_wait (&block);
-		} while (ret == -1 && errno == EINTR);
-		if (ret != 0) {
-			printf ("errno=%d\n", errno);
-			perror ("playground blocking semaphore");
-		}
-	} while (ret == -1 && errno == EAGAIN);
-	/* disable timer */
-	value.it_interval.tv_sec = 0;
-	value.it_interval.tv_usec = 0;
-	value.it_value.tv_sec = 0;
-	value.it_value.tv_usec = 0;
-	setitimer (ITIMER_REAL, &value, NULL);
-	return 0;
+	/* the world threads have been created, so only the simulation
+	 * thread becomes real-time */
+	RealTimeScheduler::setRealTime (realtimePriority, realtimeCpu);
+	int ret = scheduler->run (progress) ? 0 : 1;
+	scheduler->printReport (cout);
+	delete scheduler;
+	return ret;
 }
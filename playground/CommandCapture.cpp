@@ -0,0 +1,194 @@
+/* Command capture file implementation.
+
+ */
+
+#include "CommandCapture.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    static const string CAPTURE_HEADER = "ASSISI-CAPTURE 1\n";
+
+    static void putVarint(unsigned long value, string& out)
+    {
+        while (value >= 0x80)
+        {
+            out += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    //! Read a varint, counting its bytes off left.
+    static bool getVarint(istream& in, unsigned long& left, unsigned long& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int c = in.get();
+            if (c == EOF || left == 0)
+            {
+                return false;
+            }
+            left--;
+            value |= static_cast<unsigned long>(c & 0x7f) << shift;
+            if ((c & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! Read a frame, counting its bytes off left.
+    /*! A length longer than the rest of the file, from a truncated or
+        corrupt capture, is rejected before the frame is allocated.
+     */
+    static bool getFrame(istream& in, unsigned long& left, string& frame)
+    {
+        unsigned long size;
+        if (!getVarint(in, left, size) || size > left)
+        {
+            return false;
+        }
+        left -= size;
+        frame.resize(size);
+        if (size > 0)
+        {
+            in.read(&frame[0], size);
+        }
+        return size == 0 || static_cast<unsigned long>(in.gcount()) == size;
+    }
+
+// -----------------------------------------------------------------------------
+
+    CaptureWriter::CaptureWriter()
+        : last_tick_(0), count_(0)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    CaptureWriter::~CaptureWriter()
+    {
+        file_.close();
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CaptureWriter::open(const string& filename)
+    {
+        file_.open(filename.c_str(), ios::out | ios::binary | ios::trunc);
+        if (!file_.is_open())
+        {
+            return false;
+        }
+        file_ << CAPTURE_HEADER;
+        last_tick_ = 0;
+        count_ = 0;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void CaptureWriter::encodeFrames(const string& name,
+                                     const string& device,
+                                     const string& command,
+                                     const string& data,
+                                     string& frames)
+    {
+        frames.clear();
+        frames.reserve(name.size() + device.size() + command.size()
+                       + data.size() + 8);
+        putVarint(name.size(), frames);
+        frames += name;
+        putVarint(device.size(), frames);
+        frames += device;
+        putVarint(command.size(), frames);
+        frames += command;
+        putVarint(data.size(), frames);
+        frames += data;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CaptureWriter::write(unsigned long tick, const string& frames)
+    {
+        string delta;
+        putVarint(tick - last_tick_, delta);
+        file_ << delta << frames;
+        last_tick_ = tick;
+        count_++;
+    }
+
+// -----------------------------------------------------------------------------
+
+    CaptureReader::CaptureReader()
+        : left_(0), last_tick_(0), peeked_(false), peeked_tick_(0)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CaptureReader::open(const string& filename)
+    {
+        file_.open(filename.c_str(), ios::in | ios::binary);
+        if (!file_.is_open())
+        {
+            return false;
+        }
+        file_.seekg(0, ios::end);
+        streamoff size = file_.tellg();
+        file_.seekg(0, ios::beg);
+        string header(CAPTURE_HEADER.size(), '\0');
+        file_.read(&header[0], header.size());
+        left_ = size > static_cast<streamoff>(header.size()) ? size - header.size() : 0;
+        last_tick_ = 0;
+        peeked_ = false;
+        return header == CAPTURE_HEADER;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CaptureReader::peekTick(unsigned long& tick)
+    {
+        if (!peeked_)
+        {
+            unsigned long delta;
+            if (!getVarint(file_, left_, delta))
+            {
+                return false;
+            }
+            peeked_tick_ = last_tick_ + delta;
+            peeked_ = true;
+        }
+        tick = peeked_tick_;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CaptureReader::next(CaptureRecord& record)
+    {
+        if (!peekTick(record.tick))
+        {
+            return false;
+        }
+        peeked_ = false;
+        last_tick_ = record.tick;
+        return getFrame(file_, left_, record.name)
+            && getFrame(file_, left_, record.device)
+            && getFrame(file_, left_, record.command)
+            && getFrame(file_, left_, record.data);
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,103 @@
+/*! \file  CommandCapture.h
+    \brief Capture files of the commands received by the simulator.
+
+ */
+
+#ifndef ENKI_COMMAND_CAPTURE_H
+#define ENKI_COMMAND_CAPTURE_H
+
+#include <fstream>
+#include <string>
+
+namespace Enki
+{
+
+    //! An inbound message and the step in which it was applied.
+    struct CaptureRecord
+    {
+        unsigned long tick;
+        std::string name;
+        std::string device;
+        std::string command;
+        std::string data;
+    };
+
+    //! Writes a capture file.
+    /*! The file starts with a header line, followed by one record per
+        message: the tick as a varint delta from the previous record,
+        then the four frames, each as a varint length and the bytes.
+     */
+    class CaptureWriter
+    {
+    public:
+        CaptureWriter();
+        ~CaptureWriter();
+
+        //! Open the file, truncating it.
+        /*! \return False if the file cannot be opened.
+         */
+        bool open(const std::string& filename);
+
+        //! Encode the frames of a message, without the tick.
+        /*! Used by the I/O thread, so the simulation thread only
+            copies the encoded frames to the file.
+         */
+        static void encodeFrames(const std::string& name,
+                                 const std::string& device,
+                                 const std::string& command,
+                                 const std::string& data,
+                                 std::string& frames);
+
+        //! Append a message applied in the given step.
+        void write(unsigned long tick, const std::string& frames);
+
+        //! Number of records written.
+        unsigned long getCount() const { return count_; }
+
+    private:
+        std::ofstream file_;
+        unsigned long last_tick_;
+        unsigned long count_;
+    };
+
+    //! Reads a capture file, in record order.
+    class CaptureReader
+    {
+    public:
+        CaptureReader();
+
+        //! Open the file and check its header.
+        /*! \return False if the file cannot be opened or is not a
+                    capture file.
+         */
+        bool open(const std::string& filename);
+
+        //! Tick of the next record, without reading it.
+        /*! \return False at the end of the file.
+         */
+        bool peekTick(unsigned long& tick);
+
+        //! Read the next record.
+        /*! \return False at the end of the file, or if the record
+                    is truncated or a frame length runs past the end
+                    of the file.
+         */
+        bool next(CaptureRecord& record);
+
+    private:
+        std::ifstream file_;
+        // Bytes of the file not read yet
+        unsigned long left_;
+        unsigned long last_tick_;
+        // Tick of the next record, read ahead by peekTick
+        bool peeked_;
+        unsigned long peeked_tick_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,380 @@
+/* Command receiver implementation.
+
+ */
+
+#include <iostream>
+
+#include <boost/foreach.hpp>
+
+#include <zmq.hpp>
+#include "zmq_helpers.hpp"
+
+#include "CommandReceiver.h"
+
+// Autogenerated files for protobuf messages
+#include "base_msgs.pb.h"
+#include "dev_msgs.pb.h"
+#include "sim_msgs.pb.h"
+#include "playground_msgs.pb.h"
+
+using namespace std;
+using namespace AssisiMsg;
+
+namespace Enki
+{
+
+    // How long the I/O thread waits for messages before checking
+    // for pending subscriptions and the stop request, in ms.
+    static const long POLL_TIMEOUT = 10;
+
+// -----------------------------------------------------------------------------
+
+    CommandReceiver::CommandReceiver(zmq::context_t& context,
+                                     const string& sub_address,
+                                     size_t capacity,
+                                     LockstepBarrier* lockstep)
+        : lockstep_(lockstep), queue_(capacity), capacity_(capacity),
+          capture_(false), replay_(0), replay_finished_(false), stop_(false), received_(0), dropped_(0), invalid_(0)
+    {
+        subscriber_ = new zmq::socket_t(context, ZMQ_SUB);
+        subscriber_->bind(sub_address.c_str());
+        subscriber_->setsockopt(ZMQ_SUBSCRIBE, "Sim", 3);
+
+        // The socket is only used by the I/O thread from now on
+        thread_ = boost::thread(&CommandReceiver::run_, this);
+    }
+
+// -----------------------------------------------------------------------------
+
+    CommandReceiver::~CommandReceiver()
+    {
+        stop_ = true;
+        thread_.join();
+
+        Command* command;
+        while (queue_.pop(command))
+        {
+            delete command;
+        }
+        delete replay_;
+        delete subscriber_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::pop(Command*& command)
+    {
+        return queue_.pop(command);
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CommandReceiver::subscribe(const string& name, ObjectHandle handle,
+                                    ObjectHandler* handler)
+    {
+        Subscription s;
+        s.name = name;
+        s.handle = handle;
+        s.handler = handler;
+        boost::lock_guard<boost::mutex> lock(subscriptions_mutex_);
+        subscriptions_.push_back(s);
+    }
+
+// -----------------------------------------------------------------------------
+
+    CommandStats CommandReceiver::getStats() const
+    {
+        CommandStats stats;
+        stats.received = received_;
+        stats.dropped = dropped_;
+        stats.invalid = invalid_;
+        stats.depth = queue_.read_available();
+        stats.capacity = capacity_;
+        return stats;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CommandReceiver::run_()
+    {
+        string name;
+        string device;
+        string command;
+        string data;
+
+        while (!stop_)
+        {
+            applySubscriptions_();
+
+            zmq::pollitem_t item = { *subscriber_, 0, ZMQ_POLLIN, 0 };
+            zmq::poll(&item, 1, POLL_TIMEOUT);
+            if (!(item.revents & ZMQ_POLLIN))
+            {
+                continue;
+            }
+
+            int len = recv_multipart(*subscriber_, name, device,
+                                     command, data, ZMQ_DONTWAIT);
+            while (len > 0)
+            {
+                process_(name, device, command, data);
+                len = recv_multipart(*subscriber_, name, device,
+                                     command, data, ZMQ_DONTWAIT);
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CommandReceiver::process_(const string& name,
+                                   const string& device,
+                                   const string& command,
+                                   const string& data)
+    {
+        Command* c = parse_(name, device, command, data);
+        if (c != 0 && !queue_.push(c))
+        {
+            delete c;
+            dropped_++;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    Command* CommandReceiver::parse_(const string& name,
+                                     const string& device,
+                                     const string& command,
+                                     const string& data)
+    {
+        received_++;
+        if (name == "Sim" && device == "Lockstep")
+        {
+            // Applied right away, after the commands sent
+            // before it have been queued
+            if (!handleLockstep_(command, data))
+            {
+                cerr << "Invalid command " << name << "/" << device
+                     << "/" << command << endl;
+                invalid_++;
+            }
+            return 0;
+        }
+
+        Command* c = new Command;
+        bool known = true;
+        bool valid = false;
+        if (name == "Sim")
+        {
+            valid = parseSim_(device, command, data, *c);
+        }
+        else
+        {
+            ObjectHandle local = names_.find(name);
+            if (local != NO_HANDLE)
+            {
+                c->handler = handlers_[local];
+                c->handle = handles_[local];
+                valid = c->handler->parseIncoming(device, command,
+                                                  data, *c);
+            }
+            else
+            {
+                cerr << "Unknown object: " << name << endl;
+                known = false;
+            }
+        }
+
+        if (valid)
+        {
+            if (capture_)
+            {
+                c->frames = new string;
+                CaptureWriter::encodeFrames(name, device, command, data,
+                                            *c->frames);
+            }
+            return c;
+        }
+        if (known)
+        {
+            cerr << "Invalid command " << name << "/" << device
+                 << "/" << command << endl;
+        }
+        delete c;
+        invalid_++;
+        return 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CommandReceiver::setCapture(bool capture)
+    {
+        capture_ = capture;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::startReplay(const string& filename)
+    {
+        CaptureReader* reader = new CaptureReader;
+        if (!reader->open(filename))
+        {
+            delete reader;
+            return false;
+        }
+        stop_ = true;
+        thread_.join();
+        delete replay_;
+        replay_ = reader;
+        replay_finished_ = false;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::replay(unsigned long tick, Command*& command)
+    {
+        CaptureRecord record;
+        unsigned long next;
+        while (!replay_finished_ && replay_->peekTick(next) && next <= tick)
+        {
+            if (!replay_->next(record))
+            {
+                cerr << "Truncated capture record at step " << next << endl;
+                replay_finished_ = true;
+                return false;
+            }
+            // The commands dispatched before this one may have
+            // spawned the object it is addressed to
+            applySubscriptions_();
+            command = parse_(record.name, record.device,
+                             record.command, record.data);
+            if (command != 0)
+            {
+                return true;
+            }
+        }
+        if (!replay_finished_ && !replay_->peekTick(next))
+        {
+            replay_finished_ = true;
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::isReplayFinished() const
+    {
+        return replay_finished_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void CommandReceiver::applySubscriptions_()
+    {
+        Subscriptions pending;
+        {
+            boost::lock_guard<boost::mutex> lock(subscriptions_mutex_);
+            pending.swap(subscriptions_);
+        }
+        BOOST_FOREACH(const Subscription& s, pending)
+        {
+            ObjectHandle local = names_.intern(s.name);
+            if (local == handles_.size())
+            {
+                handles_.push_back(s.handle);
+                handlers_.push_back(s.handler);
+            }
+            else
+            {
+                handles_[local] = s.handle;
+                handlers_[local] = s.handler;
+            }
+            subscriber_->setsockopt(ZMQ_SUBSCRIBE,
+                                    s.name.c_str(),
+                                    s.name.length());
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::handleLockstep_(const string& command,
+                                          const string& data)
+    {
+        LockstepAck ack;
+        if (lockstep_ == 0 || !ack.ParseFromString(data))
+        {
+            return false;
+        }
+        if (command == "Ack")
+        {
+            return lockstep_->acknowledge(ack.controller(), ack.tick());
+        }
+        else if (command == "Register")
+        {
+            lockstep_->addController(ack.controller());
+            return true;
+        }
+        else if (command == "Unregister")
+        {
+            lockstep_->removeController(ack.controller());
+            return true;
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool CommandReceiver::parseSim_(const string& device,
+                                    const string& command,
+                                    const string& data,
+                                    Command& parsed) const
+    {
+        google::protobuf::Message* msg = 0;
+        if (device == "Spawn")
+        {
+            parsed.command = SIM_SPAWN;
+            parsed.argument = command;
+            msg = new Spawn;
+        }
+        else if (device == "SpawnBatch")
+        {
+            parsed.command = SIM_SPAWN_BATCH;
+            parsed.argument = command;
+            msg = new SpawnBatch;
+        }
+        else if (device == "Teleport")
+        {
+            // Argument is object name, resolved by the world since
+            // the object may be spawned by an earlier queued command
+            parsed.command = SIM_TELEPORT;
+            parsed.argument = command;
+            msg = new PoseStamped;
+        }
+        else if (device == "Trace" && command == "Flush")
+        {
+            // No data
+            parsed.command = SIM_TRACE_FLUSH;
+            return true;
+        }
+        else if (device == "Heat" && command == "reset")
+        {
+            parsed.command = SIM_HEAT_RESET;
+            msg = new Temperature;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (!msg->ParseFromString(data))
+        {
+            delete msg;
+            return false;
+        }
+        parsed.payload = msg;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+}
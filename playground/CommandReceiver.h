@@ -0,0 +1,215 @@
+/*! \file  CommandReceiver.h
+    \brief Reception of external commands in a dedicated I/O thread.
+
+ */
+
+#ifndef ENKI_COMMAND_RECEIVER_H
+#define ENKI_COMMAND_RECEIVER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread.hpp>
+
+#include <zmq.hpp>
+
+#include "handlers/ObjectHandler.h"
+#include "handlers/NameTable.h"
+#include "LockstepBarrier.h"
+#include "CommandCapture.h"
+
+namespace Enki
+{
+    //! Simulation commands, addressed to the "Sim" object.
+    enum SimCommand
+    {
+        //! Spawn an object, the argument is the object type.
+        SIM_SPAWN,
+        //! Spawn several objects, the argument is the default type.
+        SIM_SPAWN_BATCH,
+        //! Move an object, the argument is the object name.
+        SIM_TELEPORT,
+        //! Reset the heat field.
+        SIM_HEAT_RESET,
+        //! Write the recorded trace events.
+        SIM_TRACE_FLUSH
+    };
+
+    //! Command queue statistics.
+    struct CommandStats
+    {
+        //! Number of messages read from the socket.
+        unsigned long received;
+        //! Number of valid commands discarded because the queue was full.
+        unsigned long dropped;
+        //! Number of messages for unknown objects, devices or commands,
+        //! or with data that could not be parsed.
+        unsigned long invalid;
+        //! Number of commands waiting in the queue.
+        std::size_t depth;
+        //! Queue capacity.
+        std::size_t capacity;
+    };
+
+    //! Receives commands on the subscriber socket in a separate thread.
+    /*! The I/O thread owns the subscriber socket. It parses every
+        message into a Command and pushes it into a bounded single
+        producer, single consumer lock-free queue. The simulation
+        thread pops the commands at the start of each step, so a
+        flood of incoming messages does not lengthen the step by
+        more than the dispatch of the queued commands.
+
+        When the queue is full, new commands are dropped and counted.
+     */
+    class CommandReceiver
+    {
+    public:
+        //! Bind the subscriber socket and start the I/O thread.
+        /*!
+            \param context     ZMQ context used to create the socket.
+            \param sub_address The subscriber will be bound to this address.
+            \param capacity    Maximum number of queued commands.
+            \param lockstep    Barrier updated by Sim/Lockstep messages,
+                               which are not queued. If 0 they are
+                               ignored.
+         */
+        CommandReceiver(zmq::context_t& context,
+                        const std::string& sub_address,
+                        std::size_t capacity = 4096,
+                        LockstepBarrier* lockstep = 0);
+
+        //! Stop the I/O thread and discard queued commands.
+        ~CommandReceiver();
+
+        //! Pop the next command, if any. Simulation thread only.
+        /*! The caller takes ownership of the command.
+         */
+        bool pop(Command*& command);
+
+        //! Subscribe to the messages addressed to an object.
+        /*! The subscription is applied by the I/O thread; messages
+            for the object are parsed by the given handler, and
+            tagged with the given handle.
+         */
+        void subscribe(const std::string& name, ObjectHandle handle,
+                       ObjectHandler* handler);
+
+        //! Current queue statistics.
+        CommandStats getStats() const;
+
+        //! Keep the encoded frames of the queued commands.
+        /*! The frames are left in Command::frames, so the simulation
+            thread can write them to a capture file with the step in
+            which the command is applied.
+         */
+        void setCapture(bool capture);
+
+        //! Read commands from a capture file instead of the socket.
+        /*! Stops the I/O thread. From then on the commands are parsed
+            by the simulation thread, when it calls replay.
+
+            \return False if the file is not a capture file.
+         */
+        bool startReplay(const std::string& filename);
+
+        //! Parse the next captured command applied up to the given step.
+        /*! Simulation thread only, after startReplay. Replayed
+            commands are not queued: the caller dispatches each one
+            before asking for the next, and pending subscriptions are
+            applied before each record is parsed. A command therefore
+            finds the objects spawned by the commands before it, as
+            in the captured run, and a step may replay any number of
+            commands.
+
+            \param command Set to the parsed command, owned by the
+                           caller.
+            \return False when there are no more commands for this
+                    step.
+         */
+        bool replay(unsigned long tick, Command*& command);
+
+        //! True once the capture file is exhausted or truncated.
+        bool isReplayFinished() const;
+
+    private:
+        //! I/O thread main loop.
+        void run_();
+
+        //! Parse a message and queue the command.
+        void process_(const std::string& name,
+                      const std::string& device,
+                      const std::string& command,
+                      const std::string& data);
+
+        //! Parse a message into a command.
+        /*! Sim/Lockstep messages are applied right away.
+            \return The command, owned by the caller, or 0 if the
+                    message was applied or is invalid.
+         */
+        Command* parse_(const std::string& name,
+                        const std::string& device,
+                        const std::string& command,
+                        const std::string& data);
+
+        //! Apply pending subscriptions. I/O thread only, or the
+        //! simulation thread once replaying.
+        void applySubscriptions_();
+
+        //! Apply a Sim/Lockstep message to the barrier.
+        bool handleLockstep_(const std::string& command,
+                             const std::string& data);
+
+        //! Parse a simulation command.
+        bool parseSim_(const std::string& device,
+                       const std::string& command,
+                       const std::string& data,
+                       Command& parsed) const;
+
+        struct Subscription
+        {
+            std::string name;
+            ObjectHandle handle;
+            ObjectHandler* handler;
+        };
+        typedef std::deque<Subscription> Subscriptions;
+
+        zmq::socket_t* subscriber_;
+        LockstepBarrier* lockstep_;
+
+        // Subscribed objects. I/O thread only. The receiver interns
+        // names into its own table, in subscription order, and maps
+        // them to the handles assigned by the world.
+        NameTable names_;
+        std::vector<ObjectHandle> handles_;
+        std::vector<ObjectHandler*> handlers_;
+
+        boost::lockfree::spsc_queue<Command*> queue_;
+        std::size_t capacity_;
+
+        // Subscriptions requested by the simulation thread.
+        boost::mutex subscriptions_mutex_;
+        Subscriptions subscriptions_;
+
+        boost::atomic<bool> capture_;
+        // Replayed capture file, 0 when reading the socket
+        CaptureReader* replay_;
+        bool replay_finished_;
+
+        boost::atomic<bool> stop_;
+        boost::atomic<unsigned long> received_;
+        boost::atomic<unsigned long> dropped_;
+        boost::atomic<unsigned long> invalid_;
+
+        boost::thread thread_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,378 @@
+/* Controller plugin host implementation.
+
+ */
+
+#include <dlfcn.h>
+
+#include <iostream>
+
+#include <boost/foreach.hpp>
+
+#include "ControllerHost.h"
+
+#include "handlers/CasuHandler.h"
+#include "handlers/BeeHandler.h"
+#include "robots/Casu.h"
+#include "robots/Bee.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    ControllerHost::ControllerHost(unsigned threads)
+        : seen_casus_(0), seen_bees_(0), done_(0), stop_(false), time_(0)
+    {
+        if (threads == 0)
+        {
+            threads = boost::thread::hardware_concurrency();
+        }
+        if (threads == 0)
+        {
+            threads = 1;
+        }
+        for (unsigned i = 0; i < threads; i++)
+        {
+            Worker* worker = new Worker(this, i);
+            worker->thread = boost::thread(&ControllerHost::workerLoop_, this, worker);
+            workers_.push_back(worker);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    ControllerHost::~ControllerHost()
+    {
+        stop_ = true;
+        BOOST_FOREACH(Worker* worker, workers_)
+        {
+            worker->wait.post();
+        }
+        BOOST_FOREACH(Worker* worker, workers_)
+        {
+            worker->thread.join();
+            delete worker;
+        }
+        BOOST_FOREACH(const Plugin& plugin, plugins_)
+        {
+            plugin.destroy(plugin.controller);
+            dlclose(plugin.library);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool ControllerHost::load(const string& library, const string& argument)
+    {
+        void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (handle == 0)
+        {
+            cerr << "Could not load controller " << library << ": "
+                 << dlerror() << endl;
+            return false;
+        }
+        // Casting from void* to a function pointer is what dlsym users do
+        AssisiControllerVersionFunction version =
+            reinterpret_cast<AssisiControllerVersionFunction>(
+                dlsym(handle, "assisi_controller_api_version"));
+        AssisiControllerCreateFunction create =
+            reinterpret_cast<AssisiControllerCreateFunction>(
+                dlsym(handle, "assisi_create_controller"));
+        AssisiControllerDestroyFunction destroy =
+            reinterpret_cast<AssisiControllerDestroyFunction>(
+                dlsym(handle, "assisi_destroy_controller"));
+        if (version == 0 || create == 0 || destroy == 0)
+        {
+            cerr << library << " is not a controller plugin" << endl;
+            dlclose(handle);
+            return false;
+        }
+        if (version() != ASSISI_CONTROLLER_API_VERSION)
+        {
+            cerr << library << " was built for controller interface version "
+                 << version() << ", expected "
+                 << ASSISI_CONTROLLER_API_VERSION << endl;
+            dlclose(handle);
+            return false;
+        }
+        Plugin plugin;
+        plugin.library = handle;
+        plugin.controller = create(argument.c_str());
+        plugin.destroy = destroy;
+        if (plugin.controller == 0)
+        {
+            cerr << library << " did not create a controller" << endl;
+            dlclose(handle);
+            return false;
+        }
+        plugins_.push_back(plugin);
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void ControllerHost::step(double time, const CasuHandler* casus,
+                              const BeeHandler* bees)
+    {
+        addAgents_(casus, bees);
+        if (casu_agents_.empty() && bee_agents_.empty())
+        {
+            return;
+        }
+
+        // Sensors whose readings are evaluated on demand update shared
+        // caches of the world, so they are read in this thread
+        time_ = time;
+        BOOST_FOREACH(CasuAgent& agent, casu_agents_)
+        {
+            readSensors_(agent, time_);
+        }
+        BOOST_FOREACH(BeeAgent& agent, bee_agents_)
+        {
+            readSensors_(agent, time_);
+        }
+        BOOST_FOREACH(Worker* worker, workers_)
+        {
+            worker->wait.post();
+        }
+        for (size_t i = 0; i < workers_.size(); i++)
+        {
+            done_.wait();
+        }
+
+        BOOST_FOREACH(const CasuAgent& agent, casu_agents_)
+        {
+            applyActuators_(agent);
+        }
+        BOOST_FOREACH(const BeeAgent& agent, bee_agents_)
+        {
+            applyActuators_(agent);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void ControllerHost::addAgents_(const CasuHandler* casus,
+                                    const BeeHandler* bees)
+    {
+        if (casus)
+        {
+            const ObjectIndex<Casu>::Entries& entries = casus->getCasus().entries();
+            for (; seen_casus_ < entries.size(); seen_casus_++)
+            {
+                const ObjectIndex<Casu>::Entry& entry = entries[seen_casus_];
+                Controller* controller = findController_(entry.name, "Casu");
+                if (controller)
+                {
+                    CasuAgent agent;
+                    agent.casu = entry.object;
+                    agent.controller = controller;
+                    agent.sensors.name = entry.name;
+                    casu_agents_.push_back(agent);
+                }
+            }
+        }
+        if (bees)
+        {
+            const ObjectIndex<Bee>::Entries& entries = bees->getBees().entries();
+            for (; seen_bees_ < entries.size(); seen_bees_++)
+            {
+                const ObjectIndex<Bee>::Entry& entry = entries[seen_bees_];
+                Controller* controller = findController_(entry.name, "Bee");
+                if (controller)
+                {
+                    BeeAgent agent;
+                    agent.bee = entry.object;
+                    agent.controller = controller;
+                    agent.sensors.name = entry.name;
+                    bee_agents_.push_back(agent);
+                }
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    Controller* ControllerHost::findController_(const string& name,
+                                                const string& type) const
+    {
+        BOOST_FOREACH(const Plugin& plugin, plugins_)
+        {
+            if (plugin.controller->controls(name, type))
+            {
+                return plugin.controller;
+            }
+        }
+        return 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void ControllerHost::workerLoop_(Worker* worker)
+    {
+        while (true)
+        {
+            worker->wait.wait();
+            if (stop_)
+            {
+                return;
+            }
+            // Contiguous range of the CASUs followed by the bees
+            size_t count = casu_agents_.size() + bee_agents_.size();
+            size_t begin = worker->index * count / workers_.size();
+            size_t end = (worker->index + 1) * count / workers_.size();
+            runRange_(begin, end);
+            done_.post();
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void ControllerHost::runRange_(size_t begin, size_t end)
+    {
+        size_t casus = casu_agents_.size();
+        for (size_t i = begin; i < end && i < casus; i++)
+        {
+            CasuAgent& agent = casu_agents_[i];
+            agent.controller->stepCasu(agent.sensors, agent.actuators);
+        }
+        for (size_t i = max(begin, casus); i < end; i++)
+        {
+            BeeAgent& agent = bee_agents_[i - casus];
+            agent.controller->stepBee(agent.sensors, agent.actuators);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void ControllerHost::readSensors_(CasuAgent& agent, double time)
+    {
+        Casu* casu = agent.casu;
+        CasuSensors& s = agent.sensors;
+        s.time = time;
+        s.ir_ranges.resize(casu->range_sensors.size());
+        for (size_t i = 0; i < casu->range_sensors.size(); i++)
+        {
+            s.ir_ranges[i] = casu->range_sensors[i]->getDist();
+        }
+        s.temperatures.resize(casu->temp_sensors.size());
+        for (size_t i = 0; i < casu->temp_sensors.size(); i++)
+        {
+            s.temperatures[i] = casu->temp_sensors[i]->getMeasuredHeat();
+        }
+        s.vibration_amplitudes.resize(casu->vibration_sensors.size());
+        s.vibration_frequencies.resize(casu->vibration_sensors.size());
+        for (size_t i = 0; i < casu->vibration_sensors.size(); i++)
+        {
+            s.vibration_amplitudes[i] = casu->vibration_sensors[i]->getAmplitude();
+            s.vibration_frequencies[i] = casu->vibration_sensors[i]->getFrequency();
+        }
+        s.peltier_temp = casu->peltier->getHeat();
+        s.peltier_on = casu->peltier->isSwitchedOn();
+        s.speaker_frequency = casu->vibration_source->getFrequency();
+        s.airflow_intensity = casu->air_pumps[0]->getIntensity();
+
+        CasuActuators& a = agent.actuators;
+        a.set_peltier = a.set_speaker = a.set_airflow = a.set_led = false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void ControllerHost::readSensors_(BeeAgent& agent, double time)
+    {
+        Bee* bee = agent.bee;
+        BeeSensors& s = agent.sensors;
+        s.time = time;
+        s.x = bee->pos.x;
+        s.y = bee->pos.y;
+        s.yaw = bee->angle;
+        s.vel_left = bee->leftSpeed;
+        s.vel_right = bee->rightSpeed;
+        s.enc_left = bee->leftEncoder;
+        s.enc_right = bee->rightEncoder;
+        s.object_ranges.resize(bee->object_sensors.size());
+        s.object_types.resize(bee->object_sensors.size());
+        for (size_t i = 0; i < bee->object_sensors.size(); i++)
+        {
+            s.object_ranges[i] = bee->object_sensors[i]->getDist();
+            s.object_types[i] = bee->object_sensors[i]->getType();
+        }
+        s.light_blue = bee->light_sensor_blue->getIntensity();
+        s.temperatures.resize(bee->heat_sensors.size());
+        for (size_t i = 0; i < bee->heat_sensors.size(); i++)
+        {
+            s.temperatures[i] = bee->heat_sensors[i]->getMeasuredHeat();
+        }
+        s.airflow_intensity = bee->air_flow_sensor->getIntensity().norm();
+        s.airflow_direction = bee->air_flow_sensor->getIntensity().angle();
+
+        BeeActuators& a = agent.actuators;
+        a.set_vel = a.set_color = false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void ControllerHost::applyActuators_(const CasuAgent& agent)
+    {
+        Casu* casu = agent.casu;
+        const CasuActuators& a = agent.actuators;
+        if (a.set_peltier)
+        {
+            if (a.peltier_on)
+            {
+                casu->peltier->setHeat(a.peltier_temp);
+            }
+            casu->peltier->setSwitchedOn(a.peltier_on);
+        }
+        if (a.set_speaker)
+        {
+            casu->vibration_source->setFrequency(a.speaker_frequency);
+        }
+        if (a.set_airflow)
+        {
+            BOOST_FOREACH(AirPump* p, casu->air_pumps)
+            {
+                p->setIntensity(a.airflow_intensity);
+            }
+        }
+        if (a.set_led)
+        {
+            if (a.led_on)
+            {
+                casu->top_led->on(Enki::Color(a.led_r, a.led_g, a.led_b));
+            }
+            else
+            {
+                casu->top_led->off();
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void ControllerHost::applyActuators_(const BeeAgent& agent)
+    {
+        Bee* bee = agent.bee;
+        const BeeActuators& a = agent.actuators;
+        if (a.set_vel)
+        {
+            bee->leftSpeed = a.vel_left;
+            bee->rightSpeed = a.vel_right;
+        }
+        if (a.set_color)
+        {
+            bee->setColor(a.color_r, a.color_g, a.color_b);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
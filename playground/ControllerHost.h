@@ -0,0 +1,139 @@
+/*! \file  ControllerHost.h
+    \brief Runs controller plugins inside the simulator.
+
+ */
+
+#ifndef ENKI_CONTROLLER_HOST_H
+#define ENKI_CONTROLLER_HOST_H
+
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#include <boost/thread.hpp>
+
+#include "ControllerPlugin.h"
+
+namespace Enki
+{
+
+    class Casu;
+    class Bee;
+    class CasuHandler;
+    class BeeHandler;
+
+    //! Loads controller plugins and runs them every step.
+    /*! Each step the host reads the sensors of the controlled
+        objects and runs their controllers on a pool of threads,
+        each thread taking a contiguous range of objects. The
+        sensors are read and the commands are applied by the
+        simulation thread, since some sensors and actuators are not
+        thread safe.
+     */
+    class ControllerHost
+    {
+    public:
+        //! Create the thread pool.
+        /*! \param threads Number of threads, 0 for one per core.
+         */
+        explicit ControllerHost(unsigned threads = 0);
+
+        //! Stop the threads and unload the plugins.
+        ~ControllerHost();
+
+        //! Load a plugin and create its controller.
+        /*! \param library  Path of the shared object.
+            \param argument Passed to the controller constructor.
+            \return False if the library cannot be loaded, does not
+                    export the plugin functions or was built for
+                    another version of the interface.
+         */
+        bool load(const std::string& library, const std::string& argument);
+
+        //! Number of loaded controllers.
+        std::size_t getControllerCount() const { return plugins_.size(); }
+
+        //! Run the controllers of all objects, and apply their commands.
+        /*! Objects created since the last step are offered to the
+            controllers first.
+         */
+        void step(double time, const CasuHandler* casus, const BeeHandler* bees);
+
+    private:
+        struct Plugin
+        {
+            void* library;
+            Controller* controller;
+            AssisiControllerDestroyFunction destroy;
+        };
+
+        struct CasuAgent
+        {
+            Casu* casu;
+            Controller* controller;
+            CasuSensors sensors;
+            CasuActuators actuators;
+        };
+
+        struct BeeAgent
+        {
+            Bee* bee;
+            Controller* controller;
+            BeeSensors sensors;
+            BeeActuators actuators;
+        };
+
+        struct Worker
+        {
+            ControllerHost* host;
+            unsigned index;
+            boost::interprocess::interprocess_semaphore wait;
+            boost::thread thread;
+
+            Worker(ControllerHost* host, unsigned index)
+                : host(host), index(index), wait(0) { }
+        };
+
+        //! Offer the new objects of the handlers to the controllers.
+        void addAgents_(const CasuHandler* casus, const BeeHandler* bees);
+
+        //! Controller of an object, or 0 if no controller accepts it.
+        Controller* findController_(const std::string& name,
+                                    const std::string& type) const;
+
+        //! Worker thread main loop.
+        void workerLoop_(Worker* worker);
+
+        //! Run the controllers of a range of agents.
+        void runRange_(std::size_t begin, std::size_t end);
+
+        static void readSensors_(CasuAgent& agent, double time);
+        static void readSensors_(BeeAgent& agent, double time);
+        static void applyActuators_(const CasuAgent& agent);
+        static void applyActuators_(const BeeAgent& agent);
+
+        std::vector<Plugin> plugins_;
+
+        // Controlled objects. Agents are only appended, so the
+        // handler entries already seen are counted.
+        std::vector<CasuAgent> casu_agents_;
+        std::vector<BeeAgent> bee_agents_;
+        std::size_t seen_casus_;
+        std::size_t seen_bees_;
+
+        // Thread pool
+        std::vector<Worker*> workers_;
+        boost::interprocess::interprocess_semaphore done_;
+        boost::atomic<bool> stop_;
+        // Time of the current step, read by the workers
+        double time_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
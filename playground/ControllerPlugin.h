@@ -0,0 +1,158 @@
+/*! \file  ControllerPlugin.h
+    \brief Interface of the controllers loaded into the simulator.
+
+    A controller plugin is a shared object that runs inside the
+    simulator, instead of talking to it over ZMQ. Every step, it is
+    given the sensor readings of the CASUs and bees it controls, and
+    fills in their actuator commands. This header has no dependency
+    on Enki, so plugins only need to include it.
+
+    A plugin defines a subclass of Enki::Controller, with a
+    constructor that takes the argument string given in the
+    configuration, and exports it with ASSISI_CONTROLLER_PLUGIN:
+
+    \code
+    class Wander : public Enki::Controller
+    {
+    public:
+        Wander(const char* argument) { }
+        virtual void stepBee(const Enki::BeeSensors& s, Enki::BeeActuators& a)
+        {
+            a.set_vel = true;
+            ...
+        }
+    };
+
+    ASSISI_CONTROLLER_PLUGIN(Wander)
+    \endcode
+ */
+
+#ifndef ENKI_CONTROLLER_PLUGIN_H
+#define ENKI_CONTROLLER_PLUGIN_H
+
+#include <string>
+#include <vector>
+
+//! Version of this interface, checked when a plugin is loaded.
+#define ASSISI_CONTROLLER_API_VERSION 1
+
+namespace Enki
+{
+
+    //! Sensor readings and actuator states of a CASU.
+    struct CasuSensors
+    {
+        std::string name;
+        //! Simulated time, in seconds.
+        double time;
+        std::vector<double> ir_ranges;
+        std::vector<double> temperatures;
+        //! Spectrum of each vibration sensor.
+        std::vector<std::vector<double> > vibration_amplitudes;
+        std::vector<std::vector<double> > vibration_frequencies;
+        double peltier_temp;
+        bool peltier_on;
+        double speaker_frequency;
+        double airflow_intensity;
+    };
+
+    //! Commands for a CASU. Only the actuators whose set flag is
+    //! true are changed.
+    struct CasuActuators
+    {
+        bool set_peltier;
+        bool peltier_on;
+        double peltier_temp;
+        bool set_speaker;
+        double speaker_frequency;
+        bool set_airflow;
+        double airflow_intensity;
+        bool set_led;
+        bool led_on;
+        double led_r, led_g, led_b;
+    };
+
+    //! Sensor readings of a bee.
+    struct BeeSensors
+    {
+        std::string name;
+        //! Simulated time, in seconds.
+        double time;
+        double x, y, yaw;
+        double vel_left, vel_right;
+        double enc_left, enc_right;
+        std::vector<double> object_ranges;
+        std::vector<std::string> object_types;
+        double light_blue;
+        std::vector<double> temperatures;
+        double airflow_intensity, airflow_direction;
+    };
+
+    //! Commands for a bee. Only the actuators whose set flag is
+    //! true are changed.
+    struct BeeActuators
+    {
+        bool set_vel;
+        double vel_left, vel_right;
+        bool set_color;
+        double color_r, color_g, color_b;
+    };
+
+    //! A controller of CASUs and bees.
+    /*! The step functions are called every simulation step, from
+        a pool of threads: calls for different objects may run
+        concurrently, calls for the same object never do. The
+        commands are applied after all the controllers have run.
+     */
+    class Controller
+    {
+    public:
+        virtual ~Controller() { }
+
+        //! Whether this controller drives an object.
+        /*! Called once per object, from the simulation thread, when
+            the object is first seen. Objects are offered to the
+            loaded controllers in load order; the first one that
+            accepts drives the object.
+
+            \param type Object type, "Casu" or "Bee".
+         */
+        virtual bool controls(const std::string& name, const std::string& type)
+        {
+            return true;
+        }
+
+        //! Compute the commands of a CASU.
+        virtual void stepCasu(const CasuSensors& sensors, CasuActuators& actuators) { }
+
+        //! Compute the commands of a bee.
+        virtual void stepBee(const BeeSensors& sensors, BeeActuators& actuators) { }
+    };
+
+}
+
+//! Functions exported by a plugin, looked up with dlsym.
+typedef int (*AssisiControllerVersionFunction)();
+typedef Enki::Controller* (*AssisiControllerCreateFunction)(const char* argument);
+typedef void (*AssisiControllerDestroyFunction)(Enki::Controller* controller);
+
+//! Export the factory functions of a controller class.
+#define ASSISI_CONTROLLER_PLUGIN(ControllerClass)                            \
+    extern "C" int assisi_controller_api_version()                          \
+    {                                                                        \
+        return ASSISI_CONTROLLER_API_VERSION;                                \
+    }                                                                        \
+    extern "C" Enki::Controller* assisi_create_controller(const char* argument) \
+    {                                                                        \
+        return new ControllerClass(argument);                                \
+    }                                                                        \
+    extern "C" void assisi_destroy_controller(Enki::Controller* controller)  \
+    {                                                                        \
+        delete controller;                                                   \
+    }
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
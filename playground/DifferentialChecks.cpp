@@ -0,0 +1,647 @@
+/* Differential checks of the optimised code paths.
+
+   Each check runs an optimised code path and a plain reference on the
+   same randomized input, and reports the largest deviation between
+   them as JSON.  The exit status is non-zero if any check deviates
+   more than its tolerance, as assisi_heat_bench does for the heat
+   kernels, so it can be used as a quick check of changes to them.
+   A few checks instead drive a world through its command socket and
+   report how far the result is from the expected one.
+
+   New checks are added to the list built in main.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include "extensions/ExtendedWorld.h"
+#include "extensions/FastMath.h"
+#include "extensions/SpectrumAnalyser.h"
+#include "interactions/ObjectSensor.h"
+#include "interactions/WorldHeat.h"
+#include "interactions/WorldRayCaster.h"
+#include "handlers/CasuHandler.h"
+#include "robots/Bee.h"
+#include "robots/Casu.h"
+#include "robots/ModelParameters.h"
+
+#include "zmq.hpp"
+#include "zmq_helpers.hpp"
+#include "CommandCapture.h"
+#include "SyntheticArena.h"
+#include "WorldExt.h"
+
+// Autogenerated files for protobuf messages
+#include "base_msgs.pb.h"
+#include "sim_msgs.pb.h"
+
+using namespace std;
+using namespace Enki;
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+//! Step of the playground
+static const double DELTA_TIME = .03;
+static const unsigned PHYSICS_OVERSAMPLING = 3;
+
+//! Parameters shared by all checks.
+struct Settings
+{
+    unsigned seed;
+    //! Random inputs per check
+    unsigned samples;
+};
+
+//! A check and the largest deviation it accepts.
+struct Check
+{
+    string name;
+    //! Run the check and return the largest deviation found.
+    double (*run)(const Settings&);
+    double tolerance;
+};
+
+// -----------------------------------------------------------------------------
+
+//! Uniform random integer in [min, max].
+static unsigned long uniformInt(boost::random::mt19937& rng,
+                                unsigned long min, unsigned long max)
+{
+    return boost::random::uniform_int_distribution<unsigned long>(min, max)(rng);
+}
+
+//! Uniform random number in [min, max).
+static double uniform(boost::random::mt19937& rng, double min, double max)
+{
+    return boost::random::uniform_real_distribution<double>(min, max)(rng);
+}
+
+//! Random bytes, zero bytes included.
+static string randomBytes(boost::random::mt19937& rng, size_t size)
+{
+    string result(size, '\0');
+    for (size_t i = 0; i < size; i++)
+    {
+        result[i] = static_cast<char>(uniformInt(rng, 0, 255));
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Number of records of a capture file that differ from the given ones.
+/*! If the last record is broken, the records before it must be read
+    back and next() must then fail.
+ */
+static double compareCapture(const string& filename,
+                             const vector<CaptureRecord>& records,
+                             bool broken)
+{
+    CaptureReader reader;
+    if (!reader.open(filename))
+    {
+        return records.size() + 1;
+    }
+    size_t expected = broken ? records.size() - 1 : records.size();
+    double mismatches = 0;
+    CaptureRecord record;
+    try
+    {
+        for (size_t i = 0; i < expected; i++)
+        {
+            unsigned long tick;
+            if (!reader.peekTick(tick) || tick != records[i].tick
+                || !reader.next(record))
+            {
+                return mismatches + expected - i;
+            }
+            if (record.tick != records[i].tick
+                || record.name != records[i].name
+                || record.device != records[i].device
+                || record.command != records[i].command
+                || record.data != records[i].data)
+            {
+                mismatches++;
+            }
+        }
+        if (reader.next(record))
+        {
+            mismatches++;
+        }
+    }
+    catch (std::exception& e)
+    {
+        cerr << "Reading " << filename << ": " << e.what() << endl;
+        return records.size() + 1;
+    }
+    return mismatches;
+}
+
+//! Write records to a capture file.
+static bool writeCapture(const string& filename,
+                         const vector<CaptureRecord>& records)
+{
+    CaptureWriter writer;
+    if (!writer.open(filename))
+    {
+        cerr << "Cannot create " << filename << endl;
+        return false;
+    }
+    string frames;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const CaptureRecord& record = records[i];
+        CaptureWriter::encodeFrames(record.name, record.device,
+                                    record.command, record.data, frames);
+        writer.write(record.tick, frames);
+    }
+    return true;
+}
+
+//! Write random records to a capture file and read them back: whole,
+//! with the last record truncated, and with the length of a frame of
+//! the last record corrupted.
+static double checkCapture(const Settings& settings)
+{
+    boost::random::mt19937 rng(settings.seed);
+    vector<CaptureRecord> records(settings.samples + 1);
+    unsigned long tick = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        // Mostly records of the same or the next steps, with an
+        // occasional long pause
+        tick += uniformInt(rng, 0, 99) == 0
+            ? uniformInt(rng, 128, 1UL << 30)
+            : uniformInt(rng, 0, 2);
+        CaptureRecord& record = records[i];
+        record.tick = tick;
+        record.name = randomBytes(rng, uniformInt(rng, 0, 16));
+        record.device = randomBytes(rng, uniformInt(rng, 0, 16));
+        record.command = randomBytes(rng, uniformInt(rng, 0, 16));
+        // Some payloads need a varint length of two bytes
+        record.data = randomBytes(rng, uniformInt(rng, 1, 300));
+    }
+
+    fs::path path = fs::temp_directory_path()
+        / fs::unique_path("assisi-check-%%%%-%%%%.capture");
+    string filename = path.string();
+    if (!writeCapture(filename, records))
+    {
+        return records.size();
+    }
+    double mismatches = compareCapture(filename, records, false);
+    // Cut the last byte of the data of the last record
+    fs::resize_file(path, fs::file_size(path) - 1);
+    mismatches += compareCapture(filename, records, true);
+    // Follow the records with one whose name length is about 2^62
+    writeCapture(filename, records);
+    {
+        std::ofstream file(filename.c_str(), ios::out | ios::binary | ios::app);
+        file << '\0' << string(8, '\xff') << '\x3f' << "short name";
+    }
+    records.push_back(records.back());
+    mismatches += compareCapture(filename, records, true);
+    fs::remove(path);
+    return mismatches;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Sine of an angle in turns, reduced exactly and computed in long
+//! double.
+static double referenceSinTurns(double turns)
+{
+    // exact for doubles
+    double fraction = turns - floor(turns);
+    return sin(2 * 3.14159265358979323846264338327950288L * fraction);
+}
+
+//! Compare fastSinTurns with the reference at quarter turns, where the
+//! reduction switches branches, and at random angles, small ones and
+//! the ones reached after hours of simulated time.
+static double checkFastSin(const Settings& settings)
+{
+    boost::random::mt19937 rng(settings.seed);
+    vector<double> turns;
+    for (int k = -8; k <= 8; k++)
+    {
+        turns.push_back(k / 4.0);
+        turns.push_back(k / 4.0 + 1e-12);
+        turns.push_back(k / 4.0 - 1e-12);
+    }
+    for (unsigned i = 0; i < settings.samples; i++)
+    {
+        turns.push_back(uniform(rng, -1, 1));
+        turns.push_back(uniform(rng, -1e4, 1e4));
+    }
+    double result = 0;
+    for (size_t i = 0; i < turns.size(); i++)
+    {
+        result = max(result, fabs(fastSinTurns(turns[i]) - referenceSinTurns(turns[i])));
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Magnitude spectrum of a window of samples by the definition of the
+//! DFT, with the mean removed and a Hann window, as SpectrumAnalyser
+//! computes it.
+static void referenceMagnitude(const vector<double>& samples,
+                               vector<double>& magnitude)
+{
+    const size_t n = samples.size();
+    double mean = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        mean += samples[i];
+    }
+    mean /= n;
+    magnitude.assign(n / 2 + 1, 0);
+    for (size_t k = 0; k <= n / 2; k++)
+    {
+        complex<double> sum = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            double hann = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+            sum += (samples[i] - mean) * hann * polar(1.0, -2 * M_PI * k * i / n);
+        }
+        magnitude[k] = abs(sum);
+    }
+}
+
+//! Compare the FFT of SpectrumAnalyser with the DFT of random rings of
+//! samples, and check the dominant frequency of a sinusoid at the
+//! centre of a bin.
+static double checkSpectrum(const Settings& settings)
+{
+    boost::random::mt19937 rng(settings.seed);
+    const double rate = 100;
+    double result = 0;
+    vector<double> samples, magnitude;
+    SpectrumAnalyser::Features features;
+    unsigned trials = max(1u, settings.samples / 100);
+    for (unsigned t = 0; t < trials; t++)
+    {
+        // Windows of 8 samples or more, so a bin has two neighbours each side
+        SpectrumAnalyser analyser(uniformInt(rng, 5, 1024));
+        const unsigned window = analyser.getWindow();
+        samples.resize(window);
+        bool sinusoid = t % 2 == 1;
+        unsigned bin = uniformInt(rng, 2, window / 2 - 2);
+        double amplitude = uniform(rng, 0.5, 2);
+        for (unsigned i = 0; i < window; i++)
+        {
+            samples[i] = sinusoid
+                ? amplitude * sin(2 * M_PI * bin * i / window) + 0.25
+                : uniform(rng, -1, 1);
+        }
+        // The oldest samples are at a random position of the ring
+        unsigned split = uniformInt(rng, 0, window);
+        vector<double> ring(samples.begin() + split, samples.end());
+        ring.insert(ring.end(), samples.begin(), samples.begin() + split);
+        analyser.analyse(&ring[0] + window - split, split, &ring[0], window - split,
+                         rate, 3, features);
+        referenceMagnitude(samples, magnitude);
+        for (size_t k = 0; k < magnitude.size(); k++)
+        {
+            result = max(result, fabs(analyser.getMagnitude()[k] - magnitude[k]));
+        }
+        if (sinusoid)
+        {
+            if (features.peaks.empty())
+            {
+                return HUGE_VAL;
+            }
+            result = max(result, fabs(features.peaks[0].frequency - bin * rate / window));
+            result = max(result, fabs(features.peaks[0].amplitude - amplitude));
+        }
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Cast the rays of the object sensors of the bees as World::step
+//! does, and return the distance of each ray.
+/*! The world positions do not change, unlike in World::step where
+    the objects collide while the sensors see them.
+ */
+static void castRays(ExtendedWorld* world, const vector<Bee*>& bees,
+                     WorldRayCaster* caster, vector<double>& distances)
+{
+    world->worldRayCaster = caster;
+    BOOST_FOREACH(Bee* bee, bees)
+    {
+        BOOST_FOREACH(ObjectSensor* sensor, bee->object_sensors)
+        {
+            sensor->init(DELTA_TIME, world);
+        }
+    }
+    // objectStep does nothing if the sensor has a ray caster
+    BOOST_FOREACH(Bee* bee, bees)
+    {
+        BOOST_FOREACH(ObjectSensor* sensor, bee->object_sensors)
+        {
+            BOOST_FOREACH(PhysicalObject* object, world->objects)
+            {
+                if (object != bee)
+                {
+                    sensor->objectStep(DELTA_TIME, world, object);
+                }
+            }
+            sensor->wallsStep(DELTA_TIME, world);
+        }
+    }
+    distances.clear();
+    BOOST_FOREACH(Bee* bee, bees)
+    {
+        BOOST_FOREACH(ObjectSensor* sensor, bee->object_sensors)
+        {
+            sensor->finalize(DELTA_TIME, world);
+            for (unsigned i = 0; i < sensor->getRayCount(); i++)
+            {
+                distances.push_back(sensor->getRayDist(i));
+            }
+        }
+    }
+    world->worldRayCaster = NULL;
+}
+
+//! Compare the rays cast by WorldRayCaster with the rays cast by each
+//! sensor, in a crowded arena with CASUs, as the bees wander.
+static double checkRayCaster(const Settings& settings)
+{
+    ArenaSettings arena_settings;
+    arena_settings.casus = 9;
+    arena_settings.bees = 300;
+    arena_settings.radius = 25;
+    arena_settings.heat_scale = 1;
+    arena_settings.parallelism = 0;
+    arena_settings.env_temp = 23;
+    arena_settings.casu_temp = 23;
+    arena_settings.casu_spacing = 9;
+    arena_settings.border_size = 2;
+    SyntheticArena arena(arena_settings, ModelParameters(), settings.seed);
+    ExtendedWorld* world = arena.getWorld();
+    // Cells smaller and larger than the range of the sensors
+    WorldRayCaster small_cells(2);
+    WorldRayCaster large_cells(15);
+    vector<double> reference, cast;
+    double result = 0;
+    unsigned configurations = max(1u, settings.samples / 1000);
+    for (unsigned c = 0; c < configurations; c++)
+    {
+        arena.wander();
+        for (int s = 0; s < 10; s++)
+        {
+            world->step(DELTA_TIME, PHYSICS_OVERSAMPLING);
+        }
+        castRays(world, arena.getBees(), NULL, reference);
+        WorldRayCaster* caster = c % 2 == 0 ? &small_cells : &large_cells;
+        castRays(world, arena.getBees(), caster, cast);
+        for (size_t r = 0; r < reference.size(); r++)
+        {
+            result = max(result, fabs(cast[r] - reference[r]));
+        }
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! World position of a grid cell.
+static Point cellPosition(const WorldHeat* heat, double x, double y)
+{
+    return Point(heat->origin.x + x * heat->gridScale,
+                 heat->origin.y + y * heat->gridScale);
+}
+
+//! Bilinear interpolation of the heat of the cells around a position,
+//! with the cells read by getHeatAt.
+static double referenceInterpolatedHeat(const WorldHeat* heat, const Point& position)
+{
+    double fx = (position.x - heat->origin.x) / heat->gridScale;
+    double fy = (position.y - heat->origin.y) / heat->gridScale;
+    double x = min(floor(fx), heat->size.x - 2);
+    double y = min(floor(fy), heat->size.y - 2);
+    double tx = fx - x;
+    double ty = fy - y;
+    return (1 - tx) * (1 - ty) * heat->getHeatAt(cellPosition(heat, x, y))
+        + (1 - tx) * ty * heat->getHeatAt(cellPosition(heat, x, y + 1))
+        + tx * (1 - ty) * heat->getHeatAt(cellPosition(heat, x + 1, y))
+        + tx * ty * heat->getHeatAt(cellPosition(heat, x + 1, y + 1));
+}
+
+//! Compare the heats sampled in batch by getHeatsAt with the heat at
+//! each position, read from the nearest cell and interpolated.
+static double checkHeatSampling(const Settings& settings)
+{
+    boost::random::mt19937 rng(settings.seed);
+    ExtendedWorld world(25.0);
+    WorldHeat heat(&world, 23, 0.5, 2, 0);
+    heat.initParameters(&world);
+    for (int x = 0; x < heat.size.x; x++)
+    {
+        for (int y = 0; y < heat.size.y; y++)
+        {
+            heat.setHeatAt(cellPosition(&heat, x, y), 23 + uniform(rng, -5, 15));
+        }
+    }
+    // Anywhere in the grid, half of them half way between two cells
+    vector<Point> positions(settings.samples);
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        double x = uniform(rng, 0, heat.size.x - 1);
+        double y = uniform(rng, 0, heat.size.y - 1);
+        if (i % 2 == 1)
+        {
+            x = min(floor(x) + 0.5, heat.size.x - 1);
+        }
+        positions[i] = cellPosition(&heat, x, y);
+    }
+    vector<double> heats;
+    double result = 0;
+    heat.getHeatsAt(positions, heats);
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        result = max(result, fabs(heats[i] - heat.getHeatAt(positions[i])));
+    }
+    heat.setInterpolation(true);
+    heat.getHeatsAt(positions, heats);
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        result = max(result, fabs(heats[i] - referenceInterpolatedHeat(&heat, positions[i])));
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! Number of commands the receiver of a world has read from its socket.
+static unsigned long receivedCommands(const WorldExt& world)
+{
+    return world.getCommandStats().received;
+}
+
+//! Send Spawn and Teleport of a CASU in one burst to the socket of a
+//! world, and return the distance between the CASU and the teleport
+//! target after a step.
+/*! The receiver parses both messages before the world applies the
+    spawn, so the teleport must still be accepted.
+ */
+static double checkSpawnTeleport(const Settings& settings)
+{
+    boost::random::mt19937 rng(settings.seed);
+    Point target(uniform(rng, -10, 10), uniform(rng, -10, 10));
+    const double failed = target.norm();
+
+    fs::path dir = fs::temp_directory_path();
+    string pub_address = "ipc://"
+        + (dir / fs::unique_path("assisi-check-%%%%-%%%%.pub")).string();
+    string sub_address = "ipc://"
+        + (dir / fs::unique_path("assisi-check-%%%%-%%%%.sub")).string();
+    WorldExt world(25.0, pub_address, sub_address);
+    WorldHeat heat(&world, 23, 0.5, 2, 0);
+    world.addPhysicSimulation(&heat);
+    world.addHandler("Casu", new CasuHandler());
+
+    zmq::context_t context(1);
+    zmq::socket_t pub(context, ZMQ_PUB);
+    pub.connect(sub_address.c_str());
+
+    // Messages published before the connection is made are lost, so
+    // send invalid probes until one arrives
+    for (int i = 0; i < 500 && receivedCommands(world) == 0; i++)
+    {
+        send_multipart(pub, "Sim", "Probe", "", "");
+        usleep(10000);
+    }
+    usleep(50000);
+    unsigned long received = receivedCommands(world);
+    if (received == 0)
+    {
+        cerr << "No connection to " << sub_address << endl;
+        return failed;
+    }
+
+    AssisiMsg::Spawn spawn;
+    spawn.set_name("casu-001");
+    spawn.mutable_pose()->mutable_position()->set_x(0);
+    spawn.mutable_pose()->mutable_position()->set_y(0);
+    spawn.mutable_pose()->mutable_orientation()->set_z(0);
+    AssisiMsg::PoseStamped pose;
+    pose.mutable_pose()->mutable_position()->set_x(target.x);
+    pose.mutable_pose()->mutable_position()->set_y(target.y);
+    pose.mutable_pose()->mutable_orientation()->set_z(0);
+    string data;
+    spawn.SerializeToString(&data);
+    send_multipart(pub, "Sim", "Spawn", "Casu", data);
+    pose.SerializeToString(&data);
+    send_multipart(pub, "Sim", "Teleport", "casu-001", data);
+    for (int i = 0; i < 500 && receivedCommands(world) < received + 2; i++)
+    {
+        usleep(10000);
+    }
+
+    world.step(DELTA_TIME, PHYSICS_OVERSAMPLING);
+    BOOST_FOREACH(PhysicalObject* object, world.objects)
+    {
+        if (dynamic_cast<Casu*>(object) != 0)
+        {
+            return (object->pos - target).norm();
+        }
+    }
+    return failed;
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+
+    po::options_description desc("Recognized options");
+    desc.add_options
+        ()
+        ("help,h", "produce help message")
+        ("seed", po::value<unsigned>(&settings.seed)->default_value(1),
+         "random seed of the inputs")
+        ("samples,n", po::value<unsigned>(&settings.samples)->default_value(10000),
+         "random inputs per check")
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e)
+    {
+        cerr << e.what() << endl << desc << endl;
+        return 1;
+    }
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 1;
+    }
+
+    vector<Check> checks;
+    Check capture = {"capture_round_trip", checkCapture, 0};
+    checks.push_back(capture);
+    // Error of the polynomial, the reduction of angles up to 1e4 turns
+    // adds about 2e-12
+    Check fast_sin = {"fast_sin_turns", checkFastSin, 1e-9};
+    checks.push_back(fast_sin);
+    Check spectrum = {"spectrum_fft", checkSpectrum, 1e-9};
+    checks.push_back(spectrum);
+    // The caster computes the hits of cylindric objects without sines
+    Check ray_caster = {"world_ray_caster", checkRayCaster, 1e-6};
+    checks.push_back(ray_caster);
+    Check heat_sampling = {"heat_sampling", checkHeatSampling, 1e-12};
+    checks.push_back(heat_sampling);
+    // A static CASU does not move in the step after the teleport
+    Check spawn_teleport = {"spawn_teleport_burst", checkSpawnTeleport, 1e-9};
+    checks.push_back(spawn_teleport);
+
+    bool ok = true;
+    cout << "{\"seed\": " << settings.seed
+         << ", \"samples\": " << settings.samples
+         << ",\n \"checks\": [";
+    for (size_t c = 0; c < checks.size(); c++)
+    {
+        const Check& check = checks[c];
+        double deviation = check.run(settings);
+        bool passed = deviation <= check.tolerance;
+        ok = ok && passed;
+        cout << (c == 0 ? "\n" : ",\n")
+             << "    {\"name\": \"" << check.name << "\""
+             << ", \"max_deviation\": " << deviation
+             << ", \"tolerance\": " << check.tolerance
+             << ", \"ok\": " << (passed ? "true" : "false")
+             << "}";
+    }
+    cout << "\n ],\n \"ok\": " << (ok ? "true" : "false") << "}\n";
+
+    return ok ? 0 : 1;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
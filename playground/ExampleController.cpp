@@ -0,0 +1,65 @@
+/* Example controller plugin: bees wander, turning away from
+   the objects in front of them.
+
+   The plugin argument is the forward speed, in cm/s.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ControllerPlugin.h"
+
+using namespace Enki;
+
+class WanderController : public Controller
+{
+public:
+    WanderController(const char* argument)
+        : speed_(argument[0] == '\0' ? 0.5 : atof(argument))
+    {
+    }
+
+    virtual bool controls(const std::string& name, const std::string& type)
+    {
+        return type == "Bee";
+    }
+
+    virtual void stepBee(const BeeSensors& sensors, BeeActuators& actuators)
+    {
+        // Bee object sensors point from right (-90 degrees) to left
+        // (+90 degrees) in steps of 45 degrees
+        const std::vector<double>& ranges = sensors.object_ranges;
+        if (ranges.size() != 5)
+        {
+            return;
+        }
+        double right = std::min(ranges[1], ranges[2]);
+        double left = std::min(ranges[3], ranges[2]);
+
+        actuators.set_vel = true;
+        if (left < OBSTACLE_RANGE || right < OBSTACLE_RANGE)
+        {
+            // Turn on the spot, away from the closest object
+            double turn = left < right ? speed_ : -speed_;
+            actuators.vel_left = turn;
+            actuators.vel_right = -turn;
+        }
+        else
+        {
+            actuators.vel_left = speed_;
+            actuators.vel_right = speed_;
+        }
+    }
+
+private:
+    static const double OBSTACLE_RANGE;
+    double speed_;
+};
+
+const double WanderController::OBSTACLE_RANGE = 1.0;
+
+ASSISI_CONTROLLER_PLUGIN(WanderController)
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
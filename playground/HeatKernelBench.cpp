@@ -0,0 +1,351 @@
+/* Heat kernel micro-benchmark and differential correctness check.
+
+   Runs the heat model kernels on the same randomized grid and
+   diffusivity map, and compares each against the serial reference
+   kernel.  It prints cells/s, the achieved memory bandwidth against
+   the machine peak, and the largest deviation from the reference, as
+   JSON.  The exit status is non-zero if any kernel deviates more than
+   the tolerance, so it can be used as a quick check of kernel changes.
+
+   New kernel variants are added to the list built in main.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+
+#include "extensions/ExtendedWorld.h"
+#include "extensions/PerfCounters.h"
+#include "interactions/WorldHeat.h"
+
+using namespace std;
+using namespace Enki;
+
+namespace po = boost::program_options;
+
+//! Step of the playground
+static const double DELTA_TIME = .03;
+
+//! Minimum memory traffic of a cell update: read heat and diffusivity,
+//! write the next heat.
+static const double BYTES_PER_CELL = 3 * sizeof(double);
+
+//! Parameters of the synthetic grid.
+struct Settings
+{
+    double radius;
+    double scale;
+    int border_size;
+    double env_temp;
+    unsigned discs;
+    unsigned polygons;
+    unsigned seed;
+};
+
+//! A kernel under test, with its own copy of the grid.
+struct Kernel
+{
+    string name;
+    WorldHeat* heat;
+    void (*step)(WorldHeat*, double);
+    unsigned threads;
+};
+
+// -----------------------------------------------------------------------------
+
+static void stepSerial(WorldHeat* heat, double dt)
+{
+    heat->updateSerial(dt);
+}
+
+#ifndef WORLDHEAT_SERIAL
+static void stepParallel(WorldHeat* heat, double dt)
+{
+    heat->computeNextState(dt);
+}
+#endif
+
+// -----------------------------------------------------------------------------
+
+//! Uniform random number in [min, max).
+static double uniform(double min, double max)
+{
+    return min + (max - min) * (rand() / (RAND_MAX + 1.0));
+}
+
+//! World position of a grid cell.
+static Point cellPosition(const WorldHeat* heat, int x, int y)
+{
+    return Point(heat->origin.x + x * heat->gridScale,
+                 heat->origin.y + y * heat->gridScale);
+}
+
+//! Create a heat model with the randomized grid given by the settings.
+/*! Every call with the same settings produces the same grid.
+ */
+static WorldHeat* makeGrid(const ExtendedWorld* world,
+                           const Settings& settings,
+                           double parallelism)
+{
+    WorldHeat* heat = new WorldHeat(world, settings.env_temp, settings.scale,
+                                    settings.border_size, parallelism);
+    heat->initParameters(world);
+    srand(settings.seed);
+    for (int x = 0; x < heat->size.x; x++)
+    {
+        for (int y = 0; y < heat->size.y; y++)
+        {
+            heat->setHeatAt(cellPosition(heat, x, y),
+                            settings.env_temp + uniform(-5, 15));
+        }
+    }
+    // Copper discs and bridges, as drawn by CASUs
+    double extent = 0.8 * settings.radius;
+    for (unsigned i = 0; i < settings.discs; i++)
+    {
+        Point center(uniform(-extent, extent), uniform(-extent, extent));
+        heat->drawCircle(WorldHeat::THERMAL_DIFFUSIVITY_COPPER,
+                         center, uniform(1, 3));
+    }
+    for (unsigned i = 0; i < settings.polygons; i++)
+    {
+        Point center(uniform(-extent, extent), uniform(-extent, extent));
+        double angle = uniform(0, M_PI);
+        double length = uniform(2, 8);
+        double width = uniform(0.5, 1.5);
+        Point along(cos(angle) * length / 2, sin(angle) * length / 2);
+        Point across(-sin(angle) * width / 2, cos(angle) * width / 2);
+        vector<Point> polygon;
+        polygon.push_back(center - along - across);
+        polygon.push_back(center + along - across);
+        polygon.push_back(center + along + across);
+        polygon.push_back(center - along + across);
+        heat->drawPolygon(WorldHeat::THERMAL_DIFFUSIVITY_COPPER, polygon);
+    }
+    return heat;
+}
+
+//! Largest absolute difference between the heat of two grids.
+static double maxDeviation(const WorldHeat* a, const WorldHeat* b)
+{
+    double result = 0;
+    for (int x = 0; x < a->size.x; x++)
+    {
+        for (int y = 0; y < a->size.y; y++)
+        {
+            Point pos = cellPosition(a, x, y);
+            result = max(result, fabs(a->getHeatAt(pos) - b->getHeatAt(pos)));
+        }
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+//! One part of the STREAM triad a = b + s * c.
+static void triad(double* a, const double* b, const double* c, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = b[i] + 3.0 * c[i];
+    }
+}
+
+//! Estimate the machine peak memory bandwidth, in GB/s, with a triad
+//! run by the given number of threads.
+static double measurePeakBandwidth(unsigned threads)
+{
+    // Large enough to not fit in the caches
+    const size_t n = 1 << 23;
+    vector<double> a(n, 0), b(n, 1), c(n, 2);
+    size_t chunk = n / threads;
+    double best = 0;
+    for (int repeat = 0; repeat < 5; repeat++)
+    {
+        double start = PerfCounters::now();
+        boost::thread_group group;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            size_t offset = t * chunk;
+            size_t count = (t == threads - 1) ? n - offset : chunk;
+            group.create_thread(boost::bind(triad, &a[offset], &b[offset],
+                                            &c[offset], count));
+        }
+        group.join_all();
+        double elapsed = PerfCounters::now() - start;
+        best = max(best, 3 * sizeof(double) * n / elapsed / 1e9);
+    }
+    return best;
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    unsigned steps;
+    string threads_list;
+    double tolerance;
+    double peak_gbs;
+
+    po::options_description desc("Recognized options");
+    desc.add_options
+        ()
+        ("help,h", "produce help message")
+        ("radius,r", po::value<double>(&settings.radius)->default_value(50),
+         "arena radius, in cm")
+        ("scale,s", po::value<double>(&settings.scale)->default_value(0.5),
+         "heat model scale")
+        ("border_size", po::value<int>(&settings.border_size)->default_value(2),
+         "heat model border size, in cm")
+        ("env_temp", po::value<double>(&settings.env_temp)->default_value(23),
+         "environment temperature, in C")
+        ("discs", po::value<unsigned>(&settings.discs)->default_value(20),
+         "copper discs drawn in the diffusivity map")
+        ("polygons", po::value<unsigned>(&settings.polygons)->default_value(10),
+         "copper bridges drawn in the diffusivity map")
+        ("seed", po::value<unsigned>(&settings.seed)->default_value(1),
+         "random seed of the grid")
+        ("steps,n", po::value<unsigned>(&steps)->default_value(200),
+         "kernel steps per run")
+        ("threads,p", po::value<string>(&threads_list)->default_value("1,2,4"),
+         "thread counts of the parallel kernel, comma separated list")
+        ("tolerance", po::value<double>(&tolerance)->default_value(1e-9),
+         "largest deviation from the serial kernel accepted")
+        ("peak_gbs", po::value<double>(&peak_gbs)->default_value(0),
+         "machine peak memory bandwidth in GB/s, 0 to measure it")
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e)
+    {
+        cerr << e.what() << endl << desc << endl;
+        return 1;
+    }
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 1;
+    }
+
+    vector<unsigned> threads;
+    vector<string> items;
+    boost::split(items, threads_list, boost::is_any_of(","));
+    BOOST_FOREACH(string item, items)
+    {
+        boost::trim(item);
+        try
+        {
+            unsigned t = boost::lexical_cast<unsigned>(item);
+            if (t > 0)
+            {
+                threads.push_back(t);
+            }
+        }
+        catch (boost::bad_lexical_cast&)
+        {
+            cerr << "Invalid thread count " << item << endl;
+            return 1;
+        }
+    }
+
+    ExtendedWorld world(settings.radius);
+
+    // The serial kernel comes first, it is the reference
+    vector<Kernel> kernels;
+    Kernel serial = {"serial", makeGrid(&world, settings, 1), stepSerial, 1};
+    kernels.push_back(serial);
+    if (!serial.heat->validParameters(DELTA_TIME))
+    {
+        cerr << "Parameters of heat model are not valid for scale "
+             << settings.scale << endl;
+        return 1;
+    }
+#ifndef WORLDHEAT_SERIAL
+    unsigned hardware = boost::thread::hardware_concurrency();
+    if (hardware == 0)
+    {
+        hardware = 1;
+    }
+    BOOST_FOREACH(unsigned t, threads)
+    {
+        // numberThreads() rounds the parallelism level back to t
+        double parallelism = static_cast<double>(t) / hardware;
+        Kernel parallel = {"parallel/" + boost::lexical_cast<string>(t),
+                           makeGrid(&world, settings, parallelism),
+                           stepParallel, t};
+        kernels.push_back(parallel);
+    }
+#else
+    cerr << "Built with WORLDHEAT_SERIAL, only the serial kernel is run" << endl;
+#endif
+
+    if (peak_gbs <= 0)
+    {
+        unsigned most = 1;
+        BOOST_FOREACH(const Kernel& kernel, kernels)
+        {
+            most = max(most, kernel.threads);
+        }
+        peak_gbs = measurePeakBandwidth(most);
+    }
+
+    const WorldHeat* reference = kernels[0].heat;
+    double cells = (reference->size.x - 2) * (reference->size.y - 2);
+    bool ok = true;
+    cout << "{\"size_x\": " << reference->size.x
+         << ", \"size_y\": " << reference->size.y
+         << ", \"steps\": " << steps
+         << ", \"peak_gbs\": " << peak_gbs
+         << ",\n \"kernels\": [";
+    for (size_t k = 0; k < kernels.size(); k++)
+    {
+        Kernel& kernel = kernels[k];
+        double start = PerfCounters::now();
+        for (unsigned s = 0; s < steps; s++)
+        {
+            kernel.step(kernel.heat, DELTA_TIME);
+        }
+        double elapsed = PerfCounters::now() - start;
+        // The reference has already run all its steps
+        double deviation = maxDeviation(kernel.heat, reference);
+        ok = ok && deviation <= tolerance;
+        double cells_per_second = cells * steps / elapsed;
+        double gbs = cells_per_second * BYTES_PER_CELL / 1e9;
+        cout << (k == 0 ? "\n" : ",\n")
+             << "    {\"name\": \"" << kernel.name << "\""
+             << ", \"threads\": " << kernel.threads
+             << ", \"seconds\": " << elapsed
+             << ", \"cells_per_second\": " << cells_per_second
+             << ", \"gbs\": " << gbs
+             << ", \"peak_fraction\": " << gbs / peak_gbs
+             << ", \"max_deviation\": " << deviation
+             << "}";
+    }
+    cout << "\n ],\n \"ok\": " << (ok ? "true" : "false") << "}\n";
+
+    BOOST_FOREACH(Kernel& kernel, kernels)
+    {
+        delete kernel.heat;
+    }
+    return ok ? 0 : 1;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,517 @@
+/* Load generator for the playground ZMQ interface.
+
+   Spawns CASUs and bees through the simulator protocol, sends actuator
+   commands at configurable rates, subscribes to all the published data
+   and measures the command to publish latency, the throughput and the
+   commands that never show up in the published data.
+
+   Each command carries a setpoint that encodes a sequence number. The
+   command is acknowledged when the object publishes that setpoint
+   (Peltier/On, Speaker/On, Airflow/On or Base/VelRef). A command
+   overwritten by the next one before it is published is superseded,
+   one that is not published within the timeout is lost.
+
+   Run it against a local simulator, for instance
+
+     assisi_playground --nogui &
+     assisi_loadgen --casus 16 --bees 200 --duration 30
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#include "zmq.hpp"
+#include "zmq_helpers.hpp"
+
+#include "base_msgs.pb.h"
+#include "dev_msgs.pb.h"
+#include "sim_msgs.pb.h"
+#include "playground_msgs.pb.h"
+
+using namespace std;
+using namespace zmq;
+using namespace AssisiMsg;
+
+namespace po = boost::program_options;
+
+//! Commands sent by the load generator.
+enum CommandKind
+{
+    PELTIER,
+    SPEAKER,
+    AIRFLOW,
+    VEL,
+    KIND_COUNT
+};
+
+static const char* KIND_NAMES[KIND_COUNT] =
+{
+    "Peltier", "Speaker", "Airflow", "Vel"
+};
+
+//! Setpoints are BASE + STEP * (sequence number % SETPOINT_COUNT)
+static const double SETPOINT_BASE[KIND_COUNT] = {26, 200, 0.5, 0.1};
+static const double SETPOINT_STEP[KIND_COUNT] = {1e-3, 1e-2, 1e-4, 1e-4};
+static const unsigned SETPOINT_COUNT = 10000;
+
+//! Command waiting to show up in the published data.
+struct Pending
+{
+    bool active;
+    double value;
+    double sent;
+};
+
+//! A spawned object.
+struct Target
+{
+    string name;
+    Pending pending[KIND_COUNT];
+};
+
+//! Measurements of one kind of command.
+struct KindStats
+{
+    unsigned long sent;
+    unsigned long acknowledged;
+    unsigned long superseded;
+    unsigned long lost;
+    vector<double> latencies;
+};
+
+//! Next command of an object.
+struct Event
+{
+    double due;
+    size_t target;
+    int kind;
+
+    //! Earliest event first in a priority queue
+    bool operator<(const Event& other) const
+    {
+        return due > other.due;
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+//! Value at the given quantile of a sorted vector.
+static double quantile(const vector<double>& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(q * (sorted.size() - 1) + 0.5)];
+}
+
+// -----------------------------------------------------------------------------
+
+class LoadGenerator
+{
+public:
+    LoadGenerator(socket_t& pub, double timeout)
+        : pub_(pub), timeout_(timeout), received_(0)
+    {
+        for (int k = 0; k < KIND_COUNT; k++)
+        {
+            KindStats s = {0, 0, 0, 0, vector<double>()};
+            stats_[k] = s;
+            sequence_[k] = 0;
+        }
+    }
+
+    //! Spawn objects of one type with a single SpawnBatch message.
+    void spawn(const string& type, const string& prefix, int count,
+               double spacing, int first_kind, int last_kind)
+    {
+        SpawnBatch batch;
+        int side = static_cast<int>(ceil(sqrt(static_cast<double>(count))));
+        double offset = (side - 1) * spacing / 2;
+        for (int i = 0; i < count; i++)
+        {
+            Target target;
+            target.name = prefix + boost::lexical_cast<string>(i);
+            for (int k = 0; k < KIND_COUNT; k++)
+            {
+                target.pending[k].active = false;
+            }
+            Spawn* spawn = batch.add_spawn();
+            spawn->set_name(target.name);
+            spawn->set_type(type);
+            spawn->mutable_pose()->mutable_position()->set_x((i % side) * spacing - offset);
+            spawn->mutable_pose()->mutable_position()->set_y((i / side) * spacing - offset);
+            spawn->mutable_pose()->mutable_orientation()->set_z(0);
+            targets_.push_back(target);
+            kinds_.push_back(make_pair(first_kind, last_kind));
+        }
+        if (count > 0)
+        {
+            string data;
+            batch.SerializeToString(&data);
+            send_multipart(pub_, "Sim", "SpawnBatch", type, data);
+        }
+    }
+
+    //! Schedule the commands of all objects at the given rates, in Hz
+    //! per object. Objects are spread over the period.
+    void schedule(const double rates[KIND_COUNT], double start)
+    {
+        for (size_t t = 0; t < targets_.size(); t++)
+        {
+            for (int k = kinds_[t].first; k <= kinds_[t].second; k++)
+            {
+                if (rates[k] > 0)
+                {
+                    period_[k] = 1 / rates[k];
+                    Event e = {start + period_[k] * t / targets_.size(), t, k};
+                    events_.push(e);
+                }
+            }
+        }
+    }
+
+    //! Send the commands that are due, and return the time of the next one.
+    double sendDue(double time, double end)
+    {
+        while (!events_.empty() && events_.top().due <= time)
+        {
+            Event e = events_.top();
+            events_.pop();
+            send_(e.target, e.kind, time);
+            e.due += period_[e.kind];
+            if (e.due < end)
+            {
+                events_.push(e);
+            }
+        }
+        return events_.empty() ? end : events_.top().due;
+    }
+
+    //! Receive all the published messages that are waiting.
+    void receive(socket_t& sub, double time)
+    {
+        string name, device, command, data;
+        while (recv_multipart(sub, name, device, command, data, ZMQ_DONTWAIT) > 0)
+        {
+            received_++;
+            streams_[device + "/" + command]++;
+            int kind = KIND_COUNT;
+            double value = 0;
+            if (device == "Peltier" && command == "On")
+            {
+                Temperature msg;
+                msg.ParseFromString(data);
+                kind = PELTIER;
+                value = msg.temp();
+            }
+            else if (device == "Speaker" && command == "On")
+            {
+                VibrationSetpoint msg;
+                msg.ParseFromString(data);
+                kind = SPEAKER;
+                value = msg.freq();
+            }
+            else if (device == "Airflow" && command == "On")
+            {
+                Airflow msg;
+                msg.ParseFromString(data);
+                kind = AIRFLOW;
+                value = msg.intensity();
+            }
+            else if (device == "Base" && command == "VelRef")
+            {
+                DiffDrive msg;
+                msg.ParseFromString(data);
+                kind = VEL;
+                value = msg.vel_left();
+            }
+            if (kind != KIND_COUNT)
+            {
+                acknowledge_(name, kind, value, time);
+            }
+        }
+    }
+
+    //! Count the commands not published within the timeout as lost.
+    void expire(double time)
+    {
+        for (size_t t = 0; t < targets_.size(); t++)
+        {
+            for (int k = 0; k < KIND_COUNT; k++)
+            {
+                Pending& p = targets_[t].pending[k];
+                if (p.active && time - p.sent > timeout_)
+                {
+                    p.active = false;
+                    stats_[k].lost++;
+                }
+            }
+        }
+    }
+
+    void printReport(ostream& os, double duration)
+    {
+        unsigned long sent = 0;
+        for (int k = 0; k < KIND_COUNT; k++)
+        {
+            sent += stats_[k].sent;
+        }
+        os << "{\"objects\": " << targets_.size()
+           << ", \"duration\": " << duration
+           << ", \"commands_sent\": " << sent
+           << ", \"commands_per_second\": " << sent / duration
+           << ", \"messages_received\": " << received_
+           << ", \"messages_per_second\": " << received_ / duration
+           << ",\n \"commands\": [";
+        bool first = true;
+        for (int k = 0; k < KIND_COUNT; k++)
+        {
+            KindStats& s = stats_[k];
+            if (s.sent == 0)
+            {
+                continue;
+            }
+            sort(s.latencies.begin(), s.latencies.end());
+            os << (first ? "\n" : ",\n")
+               << "    {\"name\": \"" << KIND_NAMES[k] << "\""
+               << ", \"sent\": " << s.sent
+               << ", \"acknowledged\": " << s.acknowledged
+               << ", \"superseded\": " << s.superseded
+               << ", \"lost\": " << s.lost
+               << ", \"loss_ratio\": " << static_cast<double>(s.lost) / s.sent
+               << ",\n     \"latency_p50\": " << quantile(s.latencies, 0.50)
+               << ", \"latency_p95\": " << quantile(s.latencies, 0.95)
+               << ", \"latency_p99\": " << quantile(s.latencies, 0.99)
+               << ", \"latency_max\": "
+               << (s.latencies.empty() ? 0 : s.latencies.back()) << "}";
+            first = false;
+        }
+        os << "],\n \"streams\": {";
+        first = true;
+        for (map<string, unsigned long>::const_iterator i = streams_.begin();
+             i != streams_.end(); ++i)
+        {
+            os << (first ? "\n" : ",\n")
+               << "    \"" << i->first << "\": " << i->second / duration;
+            first = false;
+        }
+        os << "}}\n";
+    }
+
+private:
+    void send_(size_t t, int kind, double time)
+    {
+        Target& target = targets_[t];
+        double value = SETPOINT_BASE[kind]
+            + SETPOINT_STEP[kind] * (sequence_[kind]++ % SETPOINT_COUNT);
+        string data;
+        switch (kind)
+        {
+        case PELTIER:
+            {
+                Temperature msg;
+                msg.set_temp(value);
+                msg.SerializeToString(&data);
+                send_multipart(pub_, target.name, "Peltier", "On", data);
+            }
+            break;
+        case SPEAKER:
+            {
+                VibrationSetpoint msg;
+                msg.set_freq(value);
+                msg.set_amplitude(1);
+                msg.SerializeToString(&data);
+                send_multipart(pub_, target.name, "Speaker", "On", data);
+            }
+            break;
+        case AIRFLOW:
+            {
+                Airflow msg;
+                msg.set_intensity(value);
+                msg.SerializeToString(&data);
+                send_multipart(pub_, target.name, "Airflow", "On", data);
+            }
+            break;
+        case VEL:
+            {
+                DiffDrive msg;
+                msg.set_vel_left(value);
+                msg.set_vel_right(value);
+                msg.SerializeToString(&data);
+                send_multipart(pub_, target.name, "Base", "Vel", data);
+            }
+            break;
+        }
+        Pending& p = target.pending[kind];
+        if (p.active)
+        {
+            stats_[kind].superseded++;
+        }
+        p.active = true;
+        p.value = value;
+        p.sent = time;
+        stats_[kind].sent++;
+    }
+
+    void acknowledge_(const string& name, int kind, double value, double time)
+    {
+        map<string, size_t>::const_iterator i = index_.find(name);
+        if (i == index_.end())
+        {
+            // Build the index on first use, spawn() only appends
+            for (size_t t = 0; t < targets_.size(); t++)
+            {
+                index_[targets_[t].name] = t;
+            }
+            i = index_.find(name);
+            if (i == index_.end())
+            {
+                return;
+            }
+        }
+        Pending& p = targets_[i->second].pending[kind];
+        // Half a step absorbs the rounding of the published value
+        if (p.active && fabs(p.value - value) < SETPOINT_STEP[kind] / 2)
+        {
+            p.active = false;
+            stats_[kind].acknowledged++;
+            stats_[kind].latencies.push_back(time - p.sent);
+        }
+    }
+
+    socket_t& pub_;
+    double timeout_;
+    vector<Target> targets_;
+    //! Range of command kinds sent to each object
+    vector<pair<int, int> > kinds_;
+    map<string, size_t> index_;
+    priority_queue<Event> events_;
+    double period_[KIND_COUNT];
+    unsigned long sequence_[KIND_COUNT];
+    KindStats stats_[KIND_COUNT];
+    unsigned long received_;
+    map<string, unsigned long> streams_;
+};
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    string pub_address, sub_address;
+    int casus, bees;
+    double spacing;
+    double rates[KIND_COUNT];
+    double duration, settle, timeout;
+
+    po::options_description desc("Recognized options");
+    desc.add_options
+        ()
+        ("help,h", "produce help message")
+        ("pub_addr",
+         po::value<string>(&pub_address)->default_value("tcp://127.0.0.1:5556"),
+         "address where the simulator subscribes to commands")
+        ("sub_addr",
+         po::value<string>(&sub_address)->default_value("tcp://127.0.0.1:5555"),
+         "address where the simulator publishes data")
+        ("casus,k", po::value<int>(&casus)->default_value(9),
+         "number of CASUs spawned")
+        ("bees,m", po::value<int>(&bees)->default_value(50),
+         "number of bees spawned")
+        ("spacing", po::value<double>(&spacing)->default_value(9),
+         "distance between neighbour spawned objects, in cm")
+        ("peltier_rate", po::value<double>(&rates[PELTIER])->default_value(1),
+         "Peltier commands per second per CASU")
+        ("speaker_rate", po::value<double>(&rates[SPEAKER])->default_value(1),
+         "Speaker commands per second per CASU")
+        ("airflow_rate", po::value<double>(&rates[AIRFLOW])->default_value(1),
+         "Airflow commands per second per CASU")
+        ("vel_rate", po::value<double>(&rates[VEL])->default_value(5),
+         "Vel commands per second per bee")
+        ("duration,d", po::value<double>(&duration)->default_value(10),
+         "seconds of load")
+        ("settle", po::value<double>(&settle)->default_value(1),
+         "seconds to wait for the connections and the spawned objects")
+        ("timeout", po::value<double>(&timeout)->default_value(2),
+         "seconds after which an unpublished command is lost")
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (po::error& e)
+    {
+        cerr << e.what() << endl << desc << endl;
+        return 1;
+    }
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 1;
+    }
+
+    context_t context(1);
+    socket_t pub(context, ZMQ_PUB);
+    socket_t sub(context, ZMQ_SUB);
+    pub.connect(pub_address.c_str());
+    sub.connect(sub_address.c_str());
+    sub.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    // Give the subscriptions time to propagate
+    usleep(static_cast<useconds_t>(settle * 1e6));
+
+    LoadGenerator generator(pub, timeout);
+    generator.spawn("Casu", "load_casu_", casus, spacing, PELTIER, AIRFLOW);
+    generator.spawn("Bee", "load_bee_", bees, spacing / 4, VEL, VEL);
+    cerr << "Spawned " << casus << " CASUs and " << bees << " bees" << endl;
+    usleep(static_cast<useconds_t>(settle * 1e6));
+
+    double start = now();
+    double end = start + duration;
+    generator.schedule(rates, start);
+    double progress = start + 1;
+    double time = start;
+    while (time < end + timeout)
+    {
+        double next = (time < end) ? generator.sendDue(time, end) : end + timeout;
+        long wait_ms = static_cast<long>(max(0.0, next - now()) * 1000);
+        pollitem_t item = { sub, 0, ZMQ_POLLIN, 0 };
+        poll(&item, 1, min(wait_ms, 100L));
+        time = now();
+        generator.receive(sub, time);
+        generator.expire(time);
+        if (time >= progress)
+        {
+            cerr << "." << flush;
+            progress += 1;
+        }
+    }
+    cerr << endl;
+    generator.printReport(cout, duration);
+    return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
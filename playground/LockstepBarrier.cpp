@@ -0,0 +1,211 @@
+/* Lockstep barrier implementation.
+
+ */
+
+#include <iostream>
+
+#include <boost/foreach.hpp>
+
+#include "LockstepBarrier.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    // Interval at which a waiting simulation thread checks for
+    // interruption, in ms. Interruption may come from a signal
+    // handler, which cannot notify the condition variable.
+    static const long INTERRUPT_CHECK_INTERVAL = 100;
+
+// -----------------------------------------------------------------------------
+
+    LockstepBarrier::LockstepBarrier()
+        : published_(0), timeout_(0), policy_(PROCEED), polled_tick_(0),
+          interrupted_(false)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::setTimeout(double timeout, TimeoutPolicy policy)
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        timeout_ = timeout;
+        policy_ = policy;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::addController(const string& name)
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        acked_[name] = published_;
+        cout << "Lockstep controller " << name << " registered" << endl;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::removeController(const string& name)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            acked_.erase(name);
+        }
+        // The remaining controllers may have all answered
+        cond_.notify_all();
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool LockstepBarrier::acknowledge(const string& name, unsigned long tick)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            AckMap::iterator it = acked_.find(name);
+            if (it == acked_.end())
+            {
+                return false;
+            }
+            if (tick > it->second)
+            {
+                it->second = tick;
+            }
+        }
+        cond_.notify_all();
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::published(unsigned long tick)
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        published_ = tick;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool LockstepBarrier::wait(unsigned long tick)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        boost::system_time deadline = boost::get_system_time();
+        if (timeout_ > 0)
+        {
+            deadline += boost::posix_time::microseconds(
+                static_cast<long>(timeout_ * 1000000));
+        }
+        while (!complete_(tick))
+        {
+            if (interrupted_)
+            {
+                return false;
+            }
+            boost::system_time now = boost::get_system_time();
+            if (timeout_ > 0 && now >= deadline)
+            {
+                expire_(tick);
+                return false;
+            }
+            boost::system_time until = now +
+                boost::posix_time::milliseconds(INTERRUPT_CHECK_INTERVAL);
+            if (timeout_ > 0 && deadline < until)
+            {
+                until = deadline;
+            }
+            cond_.timed_wait(lock, until);
+        }
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool LockstepBarrier::poll(unsigned long tick)
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (interrupted_ || complete_(tick))
+        {
+            return true;
+        }
+        boost::system_time now = boost::get_system_time();
+        if (polled_tick_ != tick)
+        {
+            polled_tick_ = tick;
+            polled_since_ = now;
+        }
+        if (timeout_ > 0 && now >= polled_since_ +
+            boost::posix_time::microseconds(static_cast<long>(timeout_ * 1000000)))
+        {
+            expire_(tick);
+            return true;
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::interrupt()
+    {
+        interrupted_ = true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    size_t LockstepBarrier::getControllerCount() const
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return acked_.size();
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LockstepBarrier::expire_(unsigned long tick)
+    {
+        BOOST_FOREACH(const AckMap::value_type& a, acked_)
+        {
+            if (a.second < tick)
+            {
+                cerr << "Lockstep controller " << a.first
+                     << " did not acknowledge tick " << tick << endl;
+            }
+        }
+        if (policy_ == DROP)
+        {
+            AckMap::iterator it = acked_.begin();
+            while (it != acked_.end())
+            {
+                if (it->second < tick)
+                {
+                    cerr << "Dropping lockstep controller "
+                         << it->first << endl;
+                    acked_.erase(it++);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool LockstepBarrier::complete_(unsigned long tick) const
+    {
+        BOOST_FOREACH(const AckMap::value_type& a, acked_)
+        {
+            if (a.second < tick)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,118 @@
+/*! \file  LockstepBarrier.h
+    \brief Per-tick synchronization of the simulation with its controllers.
+
+ */
+
+#ifndef ENKI_LOCKSTEP_BARRIER_H
+#define ENKI_LOCKSTEP_BARRIER_H
+
+#include <map>
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+namespace Enki
+{
+
+    //! Waits until every registered controller has acknowledged a tick.
+    /*! In lockstep mode the world publishes the data of tick n, followed
+        by a Sim/Lockstep/Tick message, and does not step again until
+        all registered controllers have sent Sim/Lockstep/Ack for tick n.
+        Commands sent by a controller before its acknowledgement are
+        queued before it, so they are applied in the next step.
+
+        Controllers register and acknowledge from the I/O thread;
+        the simulation thread waits.
+     */
+    class LockstepBarrier
+    {
+    public:
+        //! What to do with controllers that do not answer in time.
+        enum TimeoutPolicy
+        {
+            //! Step anyway, and keep waiting for them in the next ticks.
+            PROCEED,
+            //! Unregister them; they may register again.
+            DROP
+        };
+
+        //! Create a barrier without controllers that waits forever.
+        LockstepBarrier();
+
+        //! Set how long wait blocks, in seconds of wall time.
+        /*! A timeout of zero or less waits forever.
+         */
+        void setTimeout(double timeout, TimeoutPolicy policy);
+
+        //! Register a controller.
+        /*! The controller is waited for from the next published tick on.
+         */
+        void addController(const std::string& name);
+
+        //! Unregister a controller.
+        void removeController(const std::string& name);
+
+        //! Record that a controller is done with the given tick.
+        /*! \return False if the controller is not registered.
+         */
+        bool acknowledge(const std::string& name, unsigned long tick);
+
+        //! Record that the data of a tick has been handed to the publisher.
+        void published(unsigned long tick);
+
+        //! Block until all controllers have acknowledged the given tick.
+        /*! \return False on timeout or interruption.
+         */
+        bool wait(unsigned long tick);
+
+        //! Check without blocking whether the given tick may be left.
+        /*! For callers that cannot block, such as the GUI thread. The
+            timeout runs from the first poll of the tick; once it has
+            expired the policy is applied and this returns true.
+
+            \return True if all controllers have acknowledged the
+                    tick, or on timeout or interruption.
+         */
+        bool poll(unsigned long tick);
+
+        //! Make the current and the following waits return.
+        /*! Only sets an atomic flag, so it can be called from a
+            signal handler.
+         */
+        void interrupt();
+
+        //! Number of registered controllers.
+        std::size_t getControllerCount() const;
+
+    private:
+        //! Whether all controllers have acknowledged tick. Lock held.
+        bool complete_(unsigned long tick) const;
+
+        //! Report, and drop with the DROP policy, the controllers that
+        //! did not acknowledge tick in time. Lock held.
+        void expire_(unsigned long tick);
+
+        typedef std::map<std::string, unsigned long> AckMap;
+
+        mutable boost::mutex mutex_;
+        boost::condition_variable cond_;
+        // Last tick acknowledged by each registered controller
+        AckMap acked_;
+        // Last tick handed to the publisher
+        unsigned long published_;
+        double timeout_;
+        TimeoutPolicy policy_;
+        // Tick of the last poll, and when it was first polled
+        unsigned long polled_tick_;
+        boost::system_time polled_since_;
+        boost::atomic<bool> interrupted_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
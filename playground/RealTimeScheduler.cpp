@@ -0,0 +1,258 @@
+/* Real-time scheduler implementation.
+
+ */
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <sched.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "RealTimeScheduler.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    // Number of histogram buckets; the last one holds latencies
+    // of about half a second and more.
+    static const int HISTOGRAM_BUCKETS = 21;
+
+    static const long NSEC_PER_SEC = 1000000000L;
+
+    static double toSeconds(const struct timespec& t)
+    {
+        return t.tv_sec + t.tv_nsec / 1e9;
+    }
+
+    static struct timespec toTimespec(double seconds)
+    {
+        struct timespec t;
+        t.tv_sec = static_cast<time_t>(floor(seconds));
+        t.tv_nsec = static_cast<long>((seconds - t.tv_sec) * NSEC_PER_SEC);
+        if (t.tv_nsec >= NSEC_PER_SEC)
+        {
+            t.tv_sec++;
+            t.tv_nsec -= NSEC_PER_SEC;
+        }
+        return t;
+    }
+
+    static double now()
+    {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return toSeconds(t);
+    }
+
+// -----------------------------------------------------------------------------
+
+    LatencyHistogram::LatencyHistogram()
+        : buckets_(HISTOGRAM_BUCKETS, 0), count_(0), max_(0)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LatencyHistogram::add(double latency)
+    {
+        double us = latency * 1e6;
+        int bucket = 0;
+        while (bucket < HISTOGRAM_BUCKETS - 1 && us >= ldexp(1.0, bucket))
+        {
+            bucket++;
+        }
+        buckets_[bucket]++;
+        count_++;
+        if (latency > max_)
+        {
+            max_ = latency;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    double LatencyHistogram::getQuantile(double q) const
+    {
+        unsigned long rank = static_cast<unsigned long>(ceil(q * count_));
+        unsigned long seen = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS - 1; b++)
+        {
+            seen += buckets_[b];
+            if (seen >= rank)
+            {
+                return ldexp(1.0, b) / 1e6;
+            }
+        }
+        return max_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void LatencyHistogram::print(ostream& os) const
+    {
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            if (buckets_[b] == 0)
+            {
+                continue;
+            }
+            if (b == 0)
+            {
+                os << "      < 1 us";
+            }
+            else if (b == HISTOGRAM_BUCKETS - 1)
+            {
+                os << "   >= " << ldexp(1.0, b - 1) << " us";
+            }
+            else
+            {
+                os << "   < " << ldexp(1.0, b) << " us";
+            }
+            os << ": " << buckets_[b] << "\n";
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    RealTimeScheduler::RealTimeScheduler(double period, OverrunPolicy policy)
+        : period_(period), policy_(policy), max_catch_up_(10), stop_(false),
+          ticks_(0), overruns_(0), skipped_(0)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    bool RealTimeScheduler::setRealTime(int priority, int cpu)
+    {
+        bool ok = true;
+        if (priority > 0)
+        {
+            struct sched_param param;
+            memset(&param, 0, sizeof(param));
+            param.sched_priority = priority;
+            if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+            {
+                perror("Could not set SCHED_FIFO scheduling");
+                ok = false;
+            }
+        }
+        if (cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            {
+                perror("Could not pin the simulation thread");
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool RealTimeScheduler::run(const boost::function<void ()>& tick)
+    {
+        int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        if (fd == -1)
+        {
+            perror("Could not create the simulation timer");
+            return false;
+        }
+
+        double deadline = now() + period_;
+        while (!stop_)
+        {
+            struct itimerspec spec;
+            memset(&spec, 0, sizeof(spec));
+            spec.it_value = toTimespec(deadline);
+            if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, 0) == -1)
+            {
+                // The read below would never return
+                perror("Could not arm the simulation timer");
+                close(fd);
+                return false;
+            }
+
+            // Deadlines in the past expire immediately
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) == -1)
+            {
+                if (errno != EINTR)
+                {
+                    perror("Simulation timer");
+                    break;
+                }
+                continue;
+            }
+
+            double start = now();
+            latencies_.add(start - deadline);
+            tick();
+            ticks_++;
+
+            deadline += period_;
+            double end = now();
+            if (end <= deadline)
+            {
+                continue;
+            }
+            overruns_++;
+            double missed = floor((end - deadline) / period_);
+            switch (policy_)
+            {
+            case SKIP:
+                // Next deadline on the original grid after the end
+                deadline += (missed + 1) * period_;
+                skipped_ += static_cast<unsigned long>(missed) + 1;
+                break;
+            case CATCH_UP:
+                // Run the missed ticks now, up to the limit
+                if (missed > max_catch_up_)
+                {
+                    double dropped = missed - max_catch_up_;
+                    deadline += dropped * period_;
+                    skipped_ += static_cast<unsigned long>(dropped);
+                }
+                break;
+            case SLOW_DOWN:
+                deadline = end + period_;
+                break;
+            }
+        }
+        close(fd);
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void RealTimeScheduler::printReport(ostream& os) const
+    {
+        os << "Ticks: " << ticks_
+           << "  overruns: " << overruns_
+           << "  skipped: " << skipped_ << "\n";
+        if (latencies_.getCount() > 0)
+        {
+            os << "Tick latency p50 < " << latencies_.getQuantile(0.5) * 1e6
+               << " us, p99 < " << latencies_.getQuantile(0.99) * 1e6
+               << " us, max " << latencies_.getMax() * 1e6 << " us\n";
+            latencies_.print(os);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,136 @@
+/*! \file  RealTimeScheduler.h
+    \brief Periodic stepping on absolute deadlines.
+
+ */
+
+#ifndef ENKI_REAL_TIME_SCHEDULER_H
+#define ENKI_REAL_TIME_SCHEDULER_H
+
+#include <iostream>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+
+namespace Enki
+{
+
+    //! Histogram of tick latencies, with power of two buckets.
+    /*! Bucket 0 counts latencies below 1 us, bucket i latencies
+        in [2^(i-1), 2^i) us, and the last bucket everything above.
+     */
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram();
+
+        //! Count a latency, in seconds.
+        void add(double latency);
+
+        //! Number of latencies counted.
+        unsigned long getCount() const { return count_; }
+
+        //! Largest latency counted, in seconds.
+        double getMax() const { return max_; }
+
+        //! Upper bound of the bucket holding the given quantile, in seconds.
+        double getQuantile(double q) const;
+
+        //! Print the non-empty buckets.
+        void print(std::ostream& os) const;
+
+    private:
+        std::vector<unsigned long> buckets_;
+        unsigned long count_;
+        double max_;
+    };
+
+    //! Runs a function periodically, on deadlines of a monotonic clock.
+    /*! The deadlines are absolute, start + k * period, so the period
+        does not drift with the time taken by the function. The
+        scheduler sleeps on a timerfd armed with the next deadline.
+
+        When a tick ends after the next deadline, the overrun policy
+        decides what happens:
+         - SKIP drops the missed deadlines and waits for the next
+           one on the original grid;
+         - CATCH_UP runs the missed ticks back to back, up to a
+           limit, to keep the simulated time in step with the wall
+           time on average;
+         - SLOW_DOWN restarts the grid from the end of the late tick,
+           so the simulation runs slower than real time.
+
+        The latency of each tick, the time between its deadline and
+        the moment it starts, is recorded in a histogram.
+     */
+    class RealTimeScheduler
+    {
+    public:
+        enum OverrunPolicy
+        {
+            SKIP,
+            CATCH_UP,
+            SLOW_DOWN
+        };
+
+        //! Create a scheduler with the given period, in seconds.
+        RealTimeScheduler(double period, OverrunPolicy policy = SKIP);
+
+        //! Maximum number of missed ticks that CATCH_UP runs late.
+        /*! Beyond this the missed deadlines are skipped.
+         */
+        void setMaxCatchUp(unsigned int ticks) { max_catch_up_ = ticks; }
+
+        //! Make the calling thread real-time.
+        /*!
+            \param priority SCHED_FIFO priority, 0 keeps the default
+                            scheduling policy.
+            \param cpu      CPU to pin the thread to, -1 for any.
+            \return False if a setting could not be applied, usually
+                    for lack of privileges. The reason is printed.
+         */
+        static bool setRealTime(int priority, int cpu);
+
+        //! Call tick on every deadline, until stop is called.
+        /*! \return False if the timer could not be created or
+                    armed.
+         */
+        bool run(const boost::function<void ()>& tick);
+
+        //! Make run return after the current tick.
+        /*! Only sets an atomic flag, so it can be called from a
+            signal handler. Signals interrupt the wait for the next
+            deadline if their handler was installed without SA_RESTART.
+         */
+        void stop() { stop_ = true; }
+
+        //! Latencies of the ticks run so far.
+        const LatencyHistogram& getLatencies() const { return latencies_; }
+
+        //! Number of ticks that ended after the next deadline.
+        unsigned long getOverruns() const { return overruns_; }
+
+        //! Number of deadlines dropped because of overruns.
+        unsigned long getSkipped() const { return skipped_; }
+
+        //! Print tick statistics.
+        void printReport(std::ostream& os) const;
+
+    private:
+        double period_;
+        OverrunPolicy policy_;
+        unsigned int max_catch_up_;
+        boost::atomic<bool> stop_;
+        LatencyHistogram latencies_;
+        unsigned long ticks_;
+        unsigned long overruns_;
+        unsigned long skipped_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,123 @@
+/* Synthetic arena implementation.
+
+ */
+
+#include <cmath>
+
+#include <boost/foreach.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include "SyntheticArena.h"
+
+#include "robots/Casu.h"
+#include "robots/Bee.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    const double SyntheticArena::BEE_BODY_LENGTH = 1.35;
+    const double SyntheticArena::BEE_BODY_WIDTH = 0.5;
+    const double SyntheticArena::BEE_BODY_HEIGHT = 0.4;
+    const double SyntheticArena::BEE_BODY_MASS = 1;
+    const double SyntheticArena::BEE_MAX_SPEED = 2;
+
+// -----------------------------------------------------------------------------
+
+    SyntheticArena::SyntheticArena(const ArenaSettings& settings,
+                                   const ModelParameters& parameters,
+                                   unsigned seed)
+        : hull_(Bee::makeHull(BEE_BODY_LENGTH, BEE_BODY_WIDTH, BEE_BODY_HEIGHT)),
+          rng_(seed)
+    {
+        world_ = new ExtendedWorld(settings.radius);
+        heat_ = new WorldHeat(world_, settings.env_temp,
+                              settings.heat_scale,
+                              settings.border_size,
+                              settings.parallelism);
+        heat_->setCellDissipation(parameters.cell_dissipation);
+        world_->addPhysicSimulation(heat_);
+
+        // CASUs on a square grid centred in the arena
+        int side = static_cast<int>(ceil(sqrt(static_cast<double>(settings.casus))));
+        double offset = (side - 1) * settings.casu_spacing / 2;
+        vector<Point> positions;
+        positions.reserve(settings.casus);
+        casus_.reserve(settings.casus);
+        for (int i = 0; i < settings.casus; i++)
+        {
+            Point pos((i % side) * settings.casu_spacing - offset,
+                      (i / side) * settings.casu_spacing - offset);
+            Casu* casu = new Casu(pos, 0, world_, settings.env_temp, 0, false,
+                                  parameters);
+            casu->pos = pos;
+            casu->peltier->setHeat(settings.casu_temp);
+            casu->peltier->setSwitchedOn(true);
+            world_->addObject(casu);
+            casus_.push_back(casu);
+            positions.push_back(pos);
+        }
+        Casu::drawPeltiers(world_, positions);
+
+        // Bees at random positions in the arena
+        bees_.reserve(settings.bees);
+        for (int i = 0; i < settings.bees; i++)
+        {
+            Bee* bee = new Bee(BEE_BODY_LENGTH, BEE_BODY_WIDTH, BEE_BODY_HEIGHT,
+                               BEE_BODY_MASS, BEE_MAX_SPEED, &hull_,
+                               parameters);
+            double rho = 0.9 * settings.radius * sqrt(uniform_(0, 1));
+            double theta = uniform_(0, 2 * M_PI);
+            bee->pos = Point(rho * cos(theta), rho * sin(theta));
+            bee->angle = uniform_(-M_PI, M_PI);
+            world_->addObject(bee);
+            bees_.push_back(bee);
+        }
+
+        // Sensor noise of its own, so the arena gives the same results
+        // whichever thread steps it
+        world_->setNoiseSeed(rng_());
+    }
+
+// -----------------------------------------------------------------------------
+
+    SyntheticArena::~SyntheticArena()
+    {
+        delete world_;
+        delete heat_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool SyntheticArena::validParameters(double dt) const
+    {
+        return heat_->validParameters(dt);
+    }
+
+// -----------------------------------------------------------------------------
+
+    void SyntheticArena::wander()
+    {
+        BOOST_FOREACH(Bee* bee, bees_)
+        {
+            bee->leftSpeed = uniform_(0, BEE_MAX_SPEED);
+            bee->rightSpeed = uniform_(0, BEE_MAX_SPEED);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    double SyntheticArena::uniform_(double min, double max)
+    {
+        boost::random::uniform_real_distribution<double> distribution(min, max);
+        return distribution(rng_);
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
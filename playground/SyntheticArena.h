@@ -0,0 +1,101 @@
+/*! \file  SyntheticArena.h
+    \brief Arenas built in-process, without the ZMQ interface.
+
+ */
+
+#ifndef ENKI_SYNTHETIC_ARENA_H
+#define ENKI_SYNTHETIC_ARENA_H
+
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+
+#include "extensions/ExtendedWorld.h"
+#include "interactions/WorldHeat.h"
+#include "robots/ModelParameters.h"
+
+namespace Enki
+{
+
+    class Casu;
+    class Bee;
+
+    //! Layout of a synthetic arena.
+    struct ArenaSettings
+    {
+        int casus;
+        int bees;
+        //! Arena radius, in cm
+        double radius;
+        double heat_scale;
+        //! Heat model parallelism level, 0 to update the heat grid in
+        //! the stepping thread, without worker threads
+        double parallelism;
+        //! Environment temperature, in C
+        double env_temp;
+        //! Peltier setpoint of all CASUs, in C
+        double casu_temp;
+        //! Distance between neighbour CASUs, in cm
+        double casu_spacing;
+        int border_size;
+    };
+
+    //! A world with CASUs on a square grid and bees at random.
+    /*! The CASUs are centred in the arena with their peltiers on,
+        and the bees are placed uniformly in the disc. Bees wander
+        when their wheel speeds are changed with wander.
+     */
+    class SyntheticArena
+    {
+    public:
+        // Bee physical parameters, as in Playground.cfg
+        static const double BEE_BODY_LENGTH;
+        static const double BEE_BODY_WIDTH;
+        static const double BEE_BODY_HEIGHT;
+        static const double BEE_BODY_MASS;
+        static const double BEE_MAX_SPEED;
+
+        //! Build the arena.
+        /*! The seed gives the positions and speeds of the bees and
+            the sensor noise. The first CASU built makes the hull
+            shared by all CASUs, so arenas should be built one at a
+            time.
+         */
+        SyntheticArena(const ArenaSettings& settings,
+                       const ModelParameters& parameters,
+                       unsigned seed);
+
+        ~SyntheticArena();
+
+        //! False if the heat model is not stable for this time step.
+        bool validParameters(double dt) const;
+
+        //! Give every bee new random wheel speeds.
+        void wander();
+
+        ExtendedWorld* getWorld() { return world_; }
+        WorldHeat* getHeat() { return heat_; }
+        const std::vector<Casu*>& getCasus() const { return casus_; }
+        const std::vector<Bee*>& getBees() const { return bees_; }
+
+    private:
+        //! Uniform random number in [min, max).
+        double uniform_(double min, double max);
+
+        ExtendedWorld* world_;
+        WorldHeat* heat_;
+        PhysicalObject::Hull hull_;
+        std::vector<Casu*> casus_;
+        std::vector<Bee*> bees_;
+        // Generator of the positions and speeds of the bees; the
+        // world has another one for the sensor noise
+        boost::random::mt19937 rng_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -3,6 +3,7 @@
  */
 
 #include <cstdio>
+#include <fstream>
 #include <iostream>
 
 #include <boost/foreach.hpp>
@@ -11,13 +12,18 @@
 #include "zmq_helpers.hpp"
 
 #include "handlers/ObjectHandler.h"
+#include "handlers/CasuHandler.h"
+#include "handlers/BeeHandler.h"
 #include "WorldExt.h"
 
 // Autogenerated files for protobuf messages
 #include "base_msgs.pb.h"
 #include "dev_msgs.pb.h"
+#include "sim_msgs.pb.h"
+#include "playground_msgs.pb.h"
 
 #include "interactions/WorldHeat.h"
+#include "extensions/Trace.h"
 
 using namespace std;
 using namespace zmq;
@@ -26,6 +32,10 @@ using namespace AssisiMsg;
 namespace Enki
 {
 
+    // Default publish period of the Sim/Stats messages, in seconds
+    // of simulated time.
+    static const double DEFAULT_STATS_PERIOD = 5.0;
+
 // -----------------------------------------------------------------------------
 
     WorldExt::WorldExt(double r, 
@@ -34,34 +44,67 @@ namespace Enki
                        const Color& wallsColor, 
                        const World::GroundTexture& groundTexture,
                        unsigned int skewMonitorRate,
-                       double skewReportThreshold)
+                       double skewReportThreshold,
+                       unsigned int commandQueueSize)
          : ExtendedWorld(r, wallsColor, groundTexture, skewMonitorRate, skewReportThreshold),
-           pub_address_(pub_address), sub_address_(sub_address), pub_td_(0.3), pub_timer_(0.0)
+           pub_address_(pub_address), sub_address_(sub_address), reported_drops_(0),
+           capture_(0), replaying_(false), replay_finished_(false),
+           controllers_(0),
+           lockstep_(false), tick_(0), ready_tick_(0),
+           pub_td_(0.3), sim_schedule_(pub_td_),
+           stats_csv_(0), trace_file_("assisi_trace.json"), pending_samples_(0),
+           publishing_(false), publish_tick_(0), publish_tick_time_(0),
+           stop_publishing_(false), publish_overruns_(0)
     {
         GOOGLE_PROTOBUF_VERIFY_VERSION;
 
+        sim_time_device_ = sim_schedule_.addDevice("AbsoluteTime");
+        sim_stats_device_ = sim_schedule_.addDevice("Stats");
+        sim_schedule_.setPeriod("Stats", DEFAULT_STATS_PERIOD);
+        sim_schedule_.addObject(0);
+
+        lockstep_phase_ = perfCounters.addPhase("LockstepWait");
+        commands_phase_ = perfCounters.addPhase("Commands");
+        controllers_phase_ = perfCounters.addPhase("Controllers");
+        send_sim_phase_ = publish_perf_.addPhase("Send.Sim");
+
         context_ = new zmq::context_t(1);
         publisher_ = new socket_t(*context_, ZMQ_PUB);
-        subscriber_ = new socket_t(*context_, ZMQ_SUB);
 
         publisher_->bind(pub_address_.c_str());
         //int buff_size = 1;
         //publisher_->setsockopt(ZMQ_SNDHWM, &buff_size, sizeof(int));
-        subscriber_->bind(sub_address_.c_str());
-        subscriber_->setsockopt(ZMQ_SUBSCRIBE, "Sim", 3);
+        receiver_ = new CommandReceiver(*context_, sub_address_, commandQueueSize,
+                                        &lockstep_barrier_);
+
+        // The publisher socket is only used by the publisher thread from now on
+        publish_thread_ = boost::thread(&WorldExt::publishLoop_, this);
     }
 
 // -----------------------------------------------------------------------------
 
     WorldExt::~WorldExt()
     {
+        // Stop receiving and publishing before the handlers go away
+        {
+            boost::lock_guard<boost::mutex> lock(publish_mutex_);
+            stop_publishing_ = true;
+        }
+        publish_cond_.notify_one();
+        publish_done_cond_.notify_all();
+        publish_thread_.join();
+        delete receiver_;
+        delete stats_csv_;
+        delete capture_;
+        // Controllers hold pointers to the objects
+        delete controllers_;
+
         // We own the handlers, so delete them
         BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
         {
             delete rh.second;
         }
 
-        delete subscriber_;
         delete publisher_;
         delete context_;
      }
@@ -82,143 +125,653 @@ namespace Enki
         else
         {
             handlers_[type] = handler;
+            handler->getPublishSchedule().setPeriod(pub_td_);
+            HandlerPhases phases;
+            phases.snapshot = perfCounters.addPhase("Snapshot." + type);
+            {
+                boost::lock_guard<boost::mutex> lock(publish_mutex_);
+                phases.send = publish_perf_.addPhase("Send." + type);
+            }
+            phases.handle_trace = type + "::handleIncoming";
+            phases.send_trace = type + "::sendOutgoing";
+            handler_phases_[handler] = phases;
+            return true;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::setPublishPeriod(double period)
+    {
+        pub_td_ = period;
+        sim_schedule_.setPeriod(period);
+        BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
+        {
+            rh.second->getPublishSchedule().setPeriod(period);
         }
     }
 
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::setPublishPeriod(const string& type,
+                                    const string& device,
+                                    double period)
+    {
+        PublishSchedule* schedule;
+        if (type == "Sim")
+        {
+            schedule = &sim_schedule_;
+        }
+        else if (handlers_.count(type) > 0)
+        {
+            schedule = &handlers_[type]->getPublishSchedule();
+        }
+        else
+        {
+            return false;
+        }
+        if (device.empty())
+        {
+            schedule->setPeriod(period);
+            return true;
+        }
+        else
+        {
+            return schedule->setPeriod(device, period);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    CommandStats WorldExt::getCommandStats() const
+    {
+        return receiver_->getStats();
+    }
+
+// -----------------------------------------------------------------------------
+
+    unsigned long WorldExt::getPublishOverruns() const
+    {
+        boost::lock_guard<boost::mutex> lock(publish_mutex_);
+        return publish_overruns_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::setCapture(const string& filename)
+    {
+        CaptureWriter* capture = new CaptureWriter;
+        if (!capture->open(filename))
+        {
+            delete capture;
+            return false;
+        }
+        delete capture_;
+        capture_ = capture;
+        receiver_->setCapture(true);
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::setReplay(const string& filename)
+    {
+        if (!receiver_->startReplay(filename))
+        {
+            return false;
+        }
+        replaying_ = true;
+        replay_finished_ = false;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::isReplayFinished() const
+    {
+        return replay_finished_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::addController(const string& library,
+                                 const string& argument,
+                                 unsigned threads)
+    {
+        if (controllers_ == 0)
+        {
+            controllers_ = new ControllerHost(threads);
+        }
+        return controllers_->load(library, argument);
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::setTraceFile(const string& filename)
+    {
+        trace_file_ = filename;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool WorldExt::setStatsFile(const string& filename)
+    {
+        ofstream* csv = new ofstream(filename.c_str());
+        if (!csv->is_open())
+        {
+            delete csv;
+            return false;
+        }
+        *csv << "time,phase,mean,p50,p95,p99,max\n";
+        boost::lock_guard<boost::mutex> lock(publish_mutex_);
+        delete stats_csv_;
+        stats_csv_ = csv;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::setLockstep(double timeout, LockstepBarrier::TimeoutPolicy policy)
+    {
+        lockstep_barrier_.setTimeout(timeout, policy);
+        lockstep_ = true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::interruptLockstep()
+    {
+        lockstep_barrier_.interrupt();
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    bool WorldExt::isReadyToStep()
+    {
+        if (!lockstep_ || tick_ == 0 || ready_tick_ == tick_)
+        {
+            return true;
+        }
+        if (lockstep_barrier_.poll(tick_))
+        {
+            ready_tick_ = tick_;
+            return true;
+        }
+        return false;
+    }
+
 // -----------------------------------------------------------------------------
 
     /* virtual */
     void WorldExt::controlStep(double dt)
     {
+        ASSISI_TRACE_SCOPE("WorldExt::controlStep");
         // TODO: Check if this update sequence is correct
 
-        // Read all incoming messages & apply to robots
-        // Icoming messages represent controller outputs
-        int in_count = 0;
+        // In lockstep mode, wait until the controllers are done with
+        // the previous tick; their commands are then in the queue
+        if (lockstep_ && tick_ > 0 && ready_tick_ != tick_)
+        {
+            perfCounters.begin(lockstep_phase_);
+            lockstep_barrier_.wait(tick_);
+            perfCounters.end();
+        }
 
-        string name;
-        string device;
-        string command;
-        string data;
-        int len = recv_multipart(*subscriber_, name, device,
-                                 command, data, ZMQ_DONTWAIT);
-        while (len > 0)
+        // Apply all commands received since the last step
+        // Icoming messages represent controller outputs
+        perfCounters.begin(commands_phase_);
+        const unsigned long step = perfCounters.getTicks();
+        Command* command;
+        if (replaying_ && !replay_finished_)
         {
-            in_count++;
-            if (name == "Sim")
+            // Each replayed command is applied before the next one is
+            // parsed, so it can address the objects spawned before it
+            while (receiver_->replay(step, command))
             {
-                handleSim_(device, command, data);
+                dispatch_(step, command);
             }
-            else if (handlers_by_object_.count(name) > 0)
+            replay_finished_ = receiver_->isReplayFinished();
+            if (replay_finished_)
             {
-                handlers_by_object_[name]->handleIncoming(name, device, 
-                                                          command, data);
+                cout << "Replay finished at step " << step << endl;
             }
-            else
-            {
-                cerr << "Unknown object: " << name << endl;
-            }    
-            len = recv_multipart(*subscriber_, name, device,
-                                 command, data, ZMQ_DONTWAIT);
+        }
+        while (receiver_->pop(command))
+        {
+            dispatch_(step, command);
         }
 
-        pub_timer_ += dt;
-        if (pub_timer_ >= pub_td_)
+        CommandStats stats = receiver_->getStats();
+        if (stats.dropped > reported_drops_)
         {
+            cerr << "Command queue full, dropped "
+                 << stats.dropped - reported_drops_ << " commands" << endl;
+            reported_drops_ = stats.dropped;
+        }
+        perfCounters.end();
 
-            // Publish sensor data
-            int out_count = 0;
+        // Run the in-process controllers on the current sensor values
+        if (controllers_)
+        {
+            ASSISI_TRACE_SCOPE("WorldExt::controllers");
+            perfCounters.begin(controllers_phase_);
+            HandlerMap::const_iterator casus = handlers_.find("Casu");
+            HandlerMap::const_iterator bees = handlers_.find("Bee");
+            controllers_->step(
+                getAbsoluteTime(),
+                casus == handlers_.end() ? 0 : dynamic_cast<const CasuHandler*>(casus->second),
+                bees == handlers_.end() ? 0 : dynamic_cast<const BeeHandler*>(bees->second));
+            perfCounters.end();
+        }
 
-            sendSim_ (*publisher_);
-            // Invoke all handlers to send messages
-            BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
-            {
-                rh.second->sendOutgoing(*publisher_);
-            }
-            pub_timer_ = 0.0;
+        // Take a snapshot of the data to publish. Each handler only
+        // copies the devices whose publish instants fall in this step,
+        // so publishing is spread over the steps instead of happening
+        // in one burst. Serialization happens in the publisher thread.
+        double from = getAbsoluteTime();
+        double to = from + dt;
+        if (sim_schedule_.isDue(0, sim_time_device_, from, to))
+        {
+            sim_outgoing_.add() = from;
+            pending_samples_++;
         }
+        if (sim_schedule_.isDue(0, sim_stats_device_, from, to))
+        {
+            snapshotStats_(from, stats);
+            pending_samples_++;
+        }
+        BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
+        {
+            perfCounters.begin(handler_phases_.find(rh.second)->second.snapshot);
+            pending_samples_ += rh.second->snapshotOutgoing(from, to);
+            perfCounters.end();
+        }
+        if (lockstep_)
+        {
+            // Every tick is announced, so the publisher cannot be skipped
+            tick_++;
+            handOverOutgoing_(true);
+        }
+        else if (pending_samples_ > 0)
+        {
+            handOverOutgoing_(false);
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::dispatch_(unsigned long step, Command* command)
+    {
+        if (capture_ && command->frames)
+        {
+            capture_->write(step, *command->frames);
+        }
+        if (command->handler == 0)
+        {
+            handleSim_(*command);
+        }
+        else
+        {
+            ASSISI_TRACE_SCOPE(handler_phases_.find(command->handler)->second.handle_trace.c_str());
+            command->handler->handleIncoming(*command);
+        }
+        delete command;
     }
 
 // -----------------------------------------------------------------------------
 
-    bool WorldExt::handleSim_(const string& device, 
-                              const string& command,
-                              const string& data)
+    bool WorldExt::handleSim_(const Command& command)
     {
-        if (device == "Spawn")
+        switch (command.command)
+        {
+        case SIM_SPAWN:
         {
-            // Device is Spawn, command is object type
+            // Argument is object type
             // Read command contents and spawn object
-            const string& object_type = command;
+            const string& object_type = command.argument;
             if (handlers_.count(object_type) > 0)
             {
-                string name = handlers_[object_type]->createObject(data, this);
-                if (name.length() > 0)
+                const Spawn& spawn = static_cast<const Spawn&>(*command.payload);
+                ObjectHandle handle = names_.intern(spawn.name());
+                if (handle >= handlers_by_object_.size())
+                {
+                    handlers_by_object_.resize(handle + 1, 0);
+                }
+                if (handlers_by_object_[handle] != 0)
+                {
+                    cerr << "Object " << spawn.name() << " already exists!" << endl;
+                }
+                else if (handlers_[object_type]->createObject(spawn, handle, this))
                 {
                     // New robot was spawned
-                    handlers_by_object_[name] = handlers_[command];
-                    subscriber_->setsockopt(ZMQ_SUBSCRIBE, 
-                                            name.c_str(), 
-                                            name.length());
+                    handlers_by_object_[handle] = handlers_[object_type];
+                    receiver_->subscribe(spawn.name(), handle,
+                                         handlers_[object_type]);
                 }
             }
             else
             {
                 cerr << "Unknown object type " << object_type << endl;
             }
+            break;
         }
-        else if (device == "Teleport")
+        case SIM_SPAWN_BATCH:
+            spawnBatch_(static_cast<const SpawnBatch&>(*command.payload),
+                        command.argument);
+            break;
+        case SIM_TELEPORT:
         {
-            // Device is Teleport, command is object name
-            const string name = command;
-            if (handlers_by_object_.count(name) > 0)
+            // Argument is object name
+            const string& name = command.argument;
+            ObjectHandle handle = names_.find(name);
+            if (handle == NO_HANDLE || handle >= handlers_by_object_.size()
+                || handlers_by_object_[handle] == 0)
+            {
+                cerr << "Unknown object " << name << endl;
+                break;
+            }
+            ObjectHandler* handler = handlers_by_object_[handle];
+            PhysicalObject* object = handler->getObject(handle);
+            const PoseStamped& pose = static_cast<const PoseStamped&>(*command.payload);
+            if (object != 0)
             {
-                PoseStamped pose;
-                assert(pose.ParseFromString(data));
-                handlers_by_object_[name]->getObject(name)->pos = Point(pose.pose().position().x(),
-                                                                        pose.pose().position().y());
-                handlers_by_object_[name]->getObject(name)->angle = pose.pose().orientation().z();
+                object->pos = Point(pose.pose().position().x(),
+                                    pose.pose().position().y());
+                object->angle = pose.pose().orientation().z();
             }
             else
             {
-                cerr << "Unknown object " << name << endl;
+                handler->teleportObject(handle,
+                                        pose.pose().position().x(),
+                                        pose.pose().position().y(),
+                                        pose.pose().orientation().z());
             }
+            break;
         }
-        else if (device == "Heat")
-        {
-           if (command == "reset")
-           {
-              Temperature temp_msg;
-              assert (temp_msg.ParseFromString (data));
-              PhysicSimulationsIterator iterator = this->physicSimulations.begin ();
-              PhysicSimulationsIterator end = this->physicSimulations.end ();
-              while (iterator != end) {
-                 WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (*iterator);
-                 if (worldHeat != NULL) {
-                    worldHeat->resetTemperature (temp_msg.temp ());
-                 }
-                 iterator++;
+        case SIM_HEAT_RESET:
+        {
+           const Temperature& temp_msg = static_cast<const Temperature&>(*command.payload);
+           PhysicSimulationsIterator iterator = this->physicSimulations.begin ();
+           PhysicSimulationsIterator end = this->physicSimulations.end ();
+           while (iterator != end) {
+              WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (*iterator);
+              if (worldHeat != NULL) {
+                 worldHeat->resetTemperature (temp_msg.temp ());
               }
+              iterator++;
            }
+           break;
         }
-        else
-        {
-            cerr << "Unknown sim device!" << endl; 
+        case SIM_TRACE_FLUSH:
+#ifdef ASSISI_TRACE
+            if (ASSISI_TRACE_FLUSH(trace_file_))
+            {
+                cout << "Trace events written to " << trace_file_ << endl;
+            }
+            else
+            {
+                cerr << "Could not write trace events to " << trace_file_ << endl;
+            }
+#else
+            cerr << "Trace events are not recorded, build with ASSISI_TRACE" << endl;
+#endif
+            break;
+        default:
+            cerr << "Unknown sim command!" << endl; 
         }
         return true;
     }
 
+// -----------------------------------------------------------------------------
+
+    // Records of a spawn batch handled by the same handler
+    struct SpawnGroup
+    {
+        vector<const Spawn*> spawns;
+        vector<ObjectHandle> handles;
+    };
+
+    void WorldExt::spawnBatch_(const SpawnBatch& batch,
+                               const string& default_type)
+    {
+        typedef std::map<ObjectHandler*, SpawnGroup> Groups;
+        Groups groups;
+
+        BOOST_FOREACH(const Spawn& spawn, batch.spawn())
+        {
+            const string& object_type =
+                spawn.has_type() ? spawn.type() : default_type;
+            if (handlers_.count(object_type) == 0)
+            {
+                cerr << "Unknown object type " << object_type << endl;
+                continue;
+            }
+            ObjectHandle handle = names_.intern(spawn.name());
+            if (handle >= handlers_by_object_.size())
+            {
+                handlers_by_object_.resize(handle + 1, 0);
+            }
+            if (handlers_by_object_[handle] != 0)
+            {
+                cerr << "Object " << spawn.name() << " already exists!" << endl;
+                continue;
+            }
+            // Claim the name, so that it is not used twice in the batch
+            ObjectHandler* handler = handlers_[object_type];
+            handlers_by_object_[handle] = handler;
+            groups[handler].spawns.push_back(&spawn);
+            groups[handler].handles.push_back(handle);
+        }
+
+        BOOST_FOREACH(Groups::value_type& g, groups)
+        {
+            ObjectHandler* handler = g.first;
+            const SpawnGroup& group = g.second;
+            handler->createObjects(group.spawns, group.handles, this);
+            for (size_t i = 0; i < group.handles.size(); i++)
+            {
+                ObjectHandle handle = group.handles[i];
+                if (handler->hasObject(handle))
+                {
+                    receiver_->subscribe(group.spawns[i]->name(), handle, handler);
+                }
+                else
+                {
+                    handlers_by_object_[handle] = 0;
+                }
+            }
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
     int WorldExt::sendSim_(zmq::socket_t& socket)
     {
-        Time sd;
-        double at = this->getAbsoluteTime ();
-        long int sec = trunc (at);
-        long int nsec = (at - sec) * 1000000000;
-        sd.set_sec (sec);
-        sd.set_nsec (nsec);
+        for (size_t i = 0; i < sim_outgoing_.size (); i++)
+        {
+            Time sd;
+            double at = sim_outgoing_[i];
+            long int sec = trunc (at);
+            long int nsec = (at - sec) * 1000000000;
+            sd.set_sec (sec);
+            sd.set_nsec (nsec);
+            std::string data;
+            sd.SerializeToString (&data);
+            zmq::send_multipart (socket, "Sim", "AbsoluteTime", "Value", data);
+        }
+        for (size_t i = 0; i < stats_outgoing_.size(); i++)
+        {
+            sendStats_(socket, stats_outgoing_[i]);
+        }
+        return sim_outgoing_.size () + stats_outgoing_.size();
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::snapshotStats_(double time, const CommandStats& commands)
+    {
+        StatsSample& sample = stats_outgoing_.add();
+        sample.time = time;
+        sample.ticks = perfCounters.getTicks();
+        sample.commands = commands;
+        sample.phases.clear();
+        perfCounters.summarize(sample.phases);
+        // The back buffers are only written by this thread
+        sample.publish_drops = sim_outgoing_.dropped() + stats_outgoing_.dropped();
+        BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
+        {
+            sample.publish_drops += rh.second->droppedOutgoing();
+        }
+        boost::lock_guard<boost::mutex> lock(publish_mutex_);
+        publish_perf_.summarize(sample.phases);
+        sample.publish_overruns = publish_overruns_;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::sendStats_(zmq::socket_t& socket, const StatsSample& sample)
+    {
+        SimStats stats;
+        long int sec = trunc (sample.time);
+        long int nsec = (sample.time - sec) * 1000000000;
+        stats.mutable_stamp()->set_sec(sec);
+        stats.mutable_stamp()->set_nsec(nsec);
+        stats.set_ticks(sample.ticks);
+        BOOST_FOREACH(const PerfCounters::Summary& summary, sample.phases)
+        {
+            PhaseStats* phase = stats.add_phase();
+            phase->set_name(summary.name);
+            phase->set_mean(summary.mean);
+            phase->set_p50(summary.p50);
+            phase->set_p95(summary.p95);
+            phase->set_p99(summary.p99);
+            phase->set_max(summary.max);
+            if (stats_csv_)
+            {
+                *stats_csv_ << sample.time << ',' << summary.name << ','
+                            << summary.mean << ',' << summary.p50 << ','
+                            << summary.p95 << ',' << summary.p99 << ','
+                            << summary.max << '\n';
+            }
+        }
+        if (stats_csv_)
+        {
+            stats_csv_->flush();
+        }
+        stats.set_commands_received(sample.commands.received);
+        stats.set_commands_dropped(sample.commands.dropped);
+        stats.set_commands_invalid(sample.commands.invalid);
+        stats.set_command_queue_depth(sample.commands.depth);
+        stats.set_publish_overruns(sample.publish_overruns);
+        stats.set_publish_drops(sample.publish_drops);
+        std::string data;
+        stats.SerializeToString(&data);
+        zmq::send_multipart(socket, "Sim", "Stats", "Value", data);
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::sendTick_(zmq::socket_t& socket)
+    {
+        LockstepTick tick;
+        tick.set_tick(publish_tick_);
+        long int sec = trunc (publish_tick_time_);
+        long int nsec = (publish_tick_time_ - sec) * 1000000000;
+        tick.mutable_stamp()->set_sec(sec);
+        tick.mutable_stamp()->set_nsec(nsec);
         std::string data;
-        sd.SerializeToString (&data);
-        zmq::send_multipart (socket, "Sim", "AbsoluteTime", "Value", data);
+        tick.SerializeToString(&data);
+        zmq::send_multipart(socket, "Sim", "Lockstep", "Tick", data);
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::handOverOutgoing_(bool wait)
+    {
+        boost::unique_lock<boost::mutex> lock(publish_mutex_);
+        if (publishing_)
+        {
+            if (!wait)
+            {
+                // Keep adding to the back buffers until the publisher
+                // is free
+                publish_overruns_++;
+                return;
+            }
+            while (publishing_ && !stop_publishing_)
+            {
+                publish_done_cond_.wait(lock);
+            }
+        }
+        if (lockstep_)
+        {
+            publish_tick_ = tick_;
+            publish_tick_time_ = getAbsoluteTime();
+            lockstep_barrier_.published(tick_);
+        }
+        sim_outgoing_.swap();
+        stats_outgoing_.swap();
+        publishing_handlers_.clear();
+        BOOST_FOREACH(const HandlerMap::value_type& rh, handlers_)
+        {
+            rh.second->swapOutgoing();
+            publishing_handlers_.push_back(rh.second);
+        }
+        pending_samples_ = 0;
+        publishing_ = true;
+        publish_cond_.notify_one();
+    }
+
+// -----------------------------------------------------------------------------
+
+    void WorldExt::publishLoop_()
+    {
+        boost::unique_lock<boost::mutex> lock(publish_mutex_);
+        while (true)
+        {
+            while (!publishing_ && !stop_publishing_)
+            {
+                publish_cond_.wait(lock);
+            }
+            if (!publishing_)
+            {
+                break;
+            }
+            lock.unlock();
+
+            // Send times are recorded once the lock is taken again
+            double start = PerfCounters::now();
+            sendSim_ (*publisher_);
+            send_times_.clear();
+            send_times_.push_back(PerfCounters::now() - start);
+            // Invoke all handlers to send messages
+            BOOST_FOREACH(ObjectHandler* handler, publishing_handlers_)
+            {
+                ASSISI_TRACE_SCOPE(handler_phases_.find(handler)->second.send_trace.c_str());
+                start = PerfCounters::now();
+                handler->sendOutgoing(*publisher_);
+                send_times_.push_back(PerfCounters::now() - start);
+            }
+            // The tick goes last, so controllers have all its data
+            if (publish_tick_ > 0)
+            {
+                sendTick_(*publisher_);
+            }
+
+            lock.lock();
+            publish_perf_.add(send_sim_phase_, send_times_[0]);
+            for (size_t i = 0; i < publishing_handlers_.size(); i++)
+            {
+                HandlerPhaseMap::const_iterator it =
+                    handler_phases_.find(publishing_handlers_[i]);
+                publish_perf_.add(it->second.send, send_times_[i + 1]);
+            }
+            publish_perf_.endTick();
+            publishing_ = false;
+            publish_tick_ = 0;
+            publish_done_cond_.notify_all();
+        }
     }
 // -----------------------------------------------------------------------------
 
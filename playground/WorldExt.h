@@ -8,21 +8,38 @@
 #ifndef ENKI_WORLD_EXT_H
 #define ENKI_WORLD_EXT_H
 
+#include <fstream>
 #include <map>
+#include <vector>
+
+#include <boost/thread.hpp>
 
 #include <zmq.hpp>
 
 #include "ExtendedWorld.h"
+#include "PerfCounters.h"
 //#include "PhysicalEngine.h"
 
 #include "handlers/ObjectHandler.h"
+#include "handlers/OutgoingBuffer.h"
+#include "CommandReceiver.h"
+#include "LockstepBarrier.h"
+#include "ControllerHost.h"
+
+namespace AssisiMsg
+{
+    class SpawnBatch;
+}
 
 namespace Enki
 {
 
     //! The extension of Enki::World with a ZMQ publisher an subscriber
     /*!
-
+        Commands are received and parsed by a CommandReceiver thread.
+        Outgoing data is copied by the simulation thread into the
+        handlers' buffers, and serialized and sent by a publisher
+        thread, which owns the publisher socket.
      */
     class WorldExt : public ExtendedWorld
     {
@@ -42,6 +59,10 @@ namespace Enki
          
            \param skewReportThreshold How much skew must be present in order
            to print a message.  By default is 5%.
+
+           \param commandQueueSize Maximum number of received commands
+           waiting to be applied. Commands arriving when the queue is full
+           are dropped.
          */
         WorldExt(double r, 
                  const std::string& pub_address,
@@ -49,7 +70,8 @@ namespace Enki
                  const Color& wallsColor = Color::gray,
                  const World::GroundTexture& groundTexture = World::GroundTexture(),
                  unsigned int skewMonitorRate = 60,
-                 double skewReportThreshold = 0.05
+                 double skewReportThreshold = 0.05,
+                 unsigned int commandQueueSize = 4096
                  );
 
         //! Destructor
@@ -67,20 +89,127 @@ it must be created on the heap and should not be deleted!
         //! Add an object to the WorldExt
         void addObject(PhysicalObject *po);
 
+        //! Set the publish period of all handlers and of the simulation state.
+        /*! Devices with an explicitly set period keep it.
+         */
+        void setPublishPeriod(double period);
+
+        //! Set the publish period of an object type or of one of its devices.
+        /*!
+            \param type   Object type, as given to addHandler, or "Sim" for
+                          the simulation state.
+            \param device Device name; if empty, the default period of
+                          the object type is set.
+            \return False if there is no handler for the object type.
+         */
+        bool setPublishPeriod(const std::string& type,
+                              const std::string& device,
+                              double period);
+
+        //! Statistics of the incoming command queue.
+        CommandStats getCommandStats() const;
+
+        //! Number of steps in which the publisher thread was still busy.
+        /*! The snapshots of those steps are sent together
+            with the snapshot of the next free step. Steps that wait
+            for the publisher, as in lockstep mode, are not counted.
+         */
+        unsigned long getPublishOverruns() const;
+
+        //! Also write the Sim/Stats phase timings to a CSV file.
+        /*! \return False if the file cannot be opened.
+         */
+        bool setStatsFile(const std::string& filename);
+
+        //! File written by the Sim/Trace/Flush command.
+        /*! Trace events are only recorded in builds with ASSISI_TRACE.
+         */
+        void setTraceFile(const std::string& filename);
+
+        //! Write the applied commands to a capture file.
+        /*! Every valid command is written with the step in which it
+            is applied, so the run can be replayed with setReplay.
+
+            \return False if the file cannot be opened.
+         */
+        bool setCapture(const std::string& filename);
+
+        //! Take the commands from a capture file instead of the socket.
+        /*! The captured commands are applied in the same steps as in
+            the captured run, so the objects must be spawned by the
+            capture too. Lockstep messages are not captured.
+
+            \return False if the file is not a capture file.
+         */
+        bool setReplay(const std::string& filename);
+
+        //! True once all the commands of the replayed capture are applied.
+        bool isReplayFinished() const;
+
+        //! Run a controller plugin inside the simulator.
+        /*! The plugin's controller is offered the objects spawned
+            from now on, and runs every step after the received
+            commands are applied.
+
+            \param library  Path of the plugin shared object.
+            \param argument Passed to the controller constructor.
+            \param threads  Size of the controller thread pool, 0 for
+                            one thread per core. Only used by the
+                            first call.
+            \return False if the plugin cannot be loaded.
+         */
+        bool addController(const std::string& library,
+                           const std::string& argument,
+                           unsigned threads = 0);
+
+        //! Step in lockstep with the registered controllers.
+        /*! After each step the world publishes a Sim/Lockstep/Tick
+            message, and the next step waits until all controllers
+            registered with Sim/Lockstep/Register have acknowledged
+            the tick, or until the timeout expires.
+
+            \param timeout Seconds of wall time to wait for the
+                           controllers, zero or less to wait forever.
+            \param policy  What to do with controllers that time out.
+         */
+        void setLockstep(double timeout, LockstepBarrier::TimeoutPolicy policy);
+
+        //! Stop waiting for lockstep controllers.
+        /*! Safe to call from a signal handler. Once called, steps do
+            not wait for the controllers anymore.
+         */
+        void interruptLockstep();
+
+        //! In lockstep mode, whether the controllers are done with
+        //! the last tick, polled without blocking.
+        /*! Once it returns true the next step does not wait for the
+            controllers. For the viewer, whose GUI thread must not
+            block.
+         */
+        virtual bool isReadyToStep();
+
     protected:
         virtual void controlStep(double dt);
 
     private:
 
+        //! Capture and apply a command, and delete it.
+        void dispatch_(unsigned long step, Command* command);
+
         //! Simulation command handling
         /*!
-            \param device Can be "spawn"
-            \param cmd    Robot type; currently EPuck and Casu are supported
-            \param data   AssisiMsg::Spawn message, serialized to string
+            \param command One of SimCommand, with the robot type as
+                           argument for SIM_SPAWN and the object
+                           name for SIM_TELEPORT.
+         */
+        bool handleSim_(const Command& command);
+
+        //! Spawn the objects of a SpawnBatch command.
+        /*! Records are grouped by type, and each group is handed to
+            the handler of the type in a single createObjects call.
          */
-        bool handleSim_(const std::string& device,
-                        const std::string& command,
-                        const std::string& data);
+        void spawnBatch_(const AssisiMsg::SpawnBatch& batch,
+                         const std::string& default_type);
         //! Send outgoing messages.
         /*! 
             Send a message with sim state bar robot state.
@@ -89,12 +218,46 @@ it must be created on the heap and should not be deleted!
          */
         int sendSim_(zmq::socket_t& socket);
 
+        //! Data of a Sim/Stats message.
+        struct StatsSample
+        {
+            double time;
+            unsigned long ticks;
+            std::vector<PerfCounters::Summary> phases;
+            CommandStats commands;
+            unsigned long publish_overruns;
+            unsigned long publish_drops;
+        };
+
+        //! Copy the rolling phase statistics into the stats buffer.
+        void snapshotStats_(double time, const CommandStats& commands);
+
+        //! Send a Sim/Stats message, and write it to the CSV file.
+        void sendStats_(zmq::socket_t& socket, const StatsSample& sample);
+
+        //! Send the Sim/Lockstep/Tick message of the front buffers.
+        void sendTick_(zmq::socket_t& socket);
+
+        //! Hand the snapshots over to the publisher thread.
+        /*! If the publisher is busy, the snapshots stay in the back
+            buffers until the next step, unless wait is true, in which
+            case this waits for the publisher. Full back buffers drop
+            their oldest samples.
+         */
+        void handOverOutgoing_(bool wait);
+
+        //! Publisher thread main loop.
+        void publishLoop_();
+
         typedef std::map<std::string, ObjectHandler*> HandlerMap;
         // Robot handler pointer, one handler per robot type
         HandlerMap handlers_;
-        // Pointers to handlers, grouped by object name
-        // All robots of the same type will point to the same handler
-        HandlerMap handlers_by_object_;
+        // Object names, interned into the handles used everywhere else
+        NameTable names_;
+        // Pointers to handlers, indexed by object handle, 0 for names
+        // without an object. All robots of the same type will point
+        // to the same handler.
+        std::vector<ObjectHandler*> handlers_by_object_;
 
         // ZMQ connection data members
         std::string pub_address_;
@@ -102,13 +265,82 @@ it must be created on the heap and should not be deleted!
         
         zmq::context_t* context_;
         zmq::socket_t* publisher_;
-        zmq::socket_t* subscriber_;
+        // Receives and parses commands in a separate thread
+        CommandReceiver* receiver_;
+        // Dropped command count at the last report
+        unsigned long reported_drops_;
+        // Applied commands are written here, if not 0
+        CaptureWriter* capture_;
+        // Commands are read from a capture file
+        bool replaying_;
+        bool replay_finished_;
+
+        // In-process controllers, created by the first addController
+        ControllerHost* controllers_;
 
-        // Publish sample time. Messages will be published every pub_td_
+        // Lockstep mode; the barrier is updated by the receiver
+        LockstepBarrier lockstep_barrier_;
+        bool lockstep_;
+        // Number of ticks published in lockstep mode
+        unsigned long tick_;
+        // Last tick found acknowledged by isReadyToStep
+        unsigned long ready_tick_;
+
+        // Default publish period, in seconds of simulated time.
         // Should be a multiple of the world update time step.
         double pub_td_; 
-        // Publish timer. Keeps track of time between two publish events.
-        double pub_timer_;
+        // Publish schedule of the simulation state messages.
+        PublishSchedule sim_schedule_;
+        int sim_time_device_;
+        int sim_stats_device_;
+        // Absolute times waiting to be published
+        OutgoingBuffer<double> sim_outgoing_;
+        // Statistics waiting to be published
+        OutgoingBuffer<StatsSample> stats_outgoing_;
+        // CSV copy of the statistics, written by the publisher thread
+        std::ofstream* stats_csv_;
+        // Chrome trace file
+        std::string trace_file_;
+        // Number of samples taken since the last hand over
+        std::size_t pending_samples_;
+
+        // Publisher thread synchronization. The publisher thread
+        // sends the front buffers while publishing_ is true.
+        mutable boost::mutex publish_mutex_;
+        boost::condition_variable publish_cond_;
+        // Notified when the publisher has sent the front buffers
+        boost::condition_variable publish_done_cond_;
+        bool publishing_;
+        // Lockstep tick to announce after the front buffers, or 0
+        unsigned long publish_tick_;
+        double publish_tick_time_;
+        bool stop_publishing_;
+        unsigned long publish_overruns_;
+        // Handlers whose front buffers are being sent
+        std::vector<ObjectHandler*> publishing_handlers_;
+        boost::thread publish_thread_;
+
+        // Phases timed by the simulation thread, in perfCounters
+        int lockstep_phase_;
+        int commands_phase_;
+        int controllers_phase_;
+        // Phases timed by the publisher thread. Updated with
+        // publish_mutex_ held, so they can be summarized.
+        PerfCounters publish_perf_;
+        int send_sim_phase_;
+        // Send times of the current round. Publisher thread only.
+        std::vector<double> send_times_;
+        struct HandlerPhases
+        {
+            int snapshot;
+            int send;
+            // Trace event names
+            std::string handle_trace;
+            std::string send_trace;
+        };
+        typedef std::map<ObjectHandler*, HandlerPhases> HandlerPhaseMap;
+        // Set up in addHandler, before the simulation starts
+        HandlerPhaseMap handler_phases_;
     };
 
 }
@@ -54,9 +54,9 @@ int main(int argc, char* argv[])
     // Spawn robot
     cout << "Spawnning " << name << endl;
     message_t msg;
-    str_to_msg("sim", msg);
+    str_to_msg("Sim", msg);
     pub.send(msg, ZMQ_SNDMORE);
-    str_to_msg("spawn", msg);
+    str_to_msg("Spawn", msg);
     pub.send(msg, ZMQ_SNDMORE);
     str_to_msg("EPuck", msg);
     pub.send(msg, ZMQ_SNDMORE);
@@ -29,10 +29,13 @@ namespace Enki
     const double Bee::AIR_FLOW_SENSOR_ORIENTATION = 0;
 
     Bee::Bee(double body_length, double body_width, double body_height,
-             double body_mass, double max_speed) :
+             double body_mass, double max_speed,
+             const PhysicalObject::Hull* hull,
+             const ModelParameters& parameters) :
         len_(body_length), w_(body_width), h_(body_height),
         m_(body_mass), v_max_(max_speed),
         DifferentialWheeled(body_width, max_speed, 0.0),
+        ExtendedRobot(OBJECT_BEE),
         object_sensors(5),
         heat_sensors(4),
         color_r_(0.93), color_g_(0.79), color_b_(0)
@@ -42,17 +45,14 @@ namespace Enki
         // Set shape & color
 
         //setRectangular(len_, w_, h_, 1);
-        Polygone footprint;
-        footprint.push_back(Point(len_/2,w_/4));
-        footprint.push_back(Point(len_/2-w_/(4*sqrt(2)),w_/2));
-        footprint.push_back(Point(-len_/2+w_/(4*sqrt(2)),w_/2));
-        footprint.push_back(Point(-len_/2,w_/4));
-        footprint.push_back(Point(-len_/2,-w_/4));
-        footprint.push_back(Point(-len_/2+w_/(2*sqrt(2)),-w_/2));
-        footprint.push_back(Point(len_/2-w_/(2*sqrt(2)),-w_/2));
-        footprint.push_back(Point(len_/2,-w_/4));
-        PhysicalObject::Hull hull(PhysicalObject::Part(footprint, h_));
-        setCustomHull(hull, m_);
+        if (hull)
+        {
+            setCustomHull(*hull, m_);
+        }
+        else
+        {
+            setCustomHull(makeHull(len_, w_, h_), m_);
+        }
         setColor(color_r_, color_g_ , color_b_);
 
         // Set other physical properties
@@ -109,13 +109,32 @@ namespace Enki
 
         // Add airflow sensor
         air_flow_sensor = new AirFlowSensor
-            (Bee::AIR_FLOW_SENSOR_RANGE,
+            (parameters.air_flow_sensor_range,
              this,
              Bee::AIR_FLOW_SENSOR_POSITION,
              Bee::AIR_FLOW_SENSOR_ORIENTATION);
         addLocalInteraction (this->air_flow_sensor);
     }
 
+    /* static */
+    PhysicalObject::Hull Bee::makeHull(double body_length,
+                                       double body_width,
+                                       double body_height)
+    {
+        double l = body_length;
+        double w = body_width;
+        Polygone footprint;
+        footprint.push_back(Point(l/2,w/4));
+        footprint.push_back(Point(l/2-w/(4*sqrt(2)),w/2));
+        footprint.push_back(Point(-l/2+w/(4*sqrt(2)),w/2));
+        footprint.push_back(Point(-l/2,w/4));
+        footprint.push_back(Point(-l/2,-w/4));
+        footprint.push_back(Point(-l/2+w/(2*sqrt(2)),-w/2));
+        footprint.push_back(Point(l/2-w/(2*sqrt(2)),-w/2));
+        footprint.push_back(Point(l/2,-w/4));
+        return PhysicalObject::Hull(PhysicalObject::Part(footprint, body_height));
+    }
+
     /* virtual */
     Bee::~Bee()
     {
@@ -10,6 +10,7 @@
 #include "interactions/HeatSensor.h"
 #include "interactions/LightSensor.h"
 #include "interactions/AirFlowSensor.h"
+#include "robots/ModelParameters.h"
 
 namespace Enki
 {
@@ -28,8 +29,20 @@ namespace Enki
 
 	public:
         //! Create a Bee
+        /*! The body shape is built from the dimensions, unless a
+            prefab hull made by makeHull is given. The air flow
+            sensor range is taken from parameters, by default the
+            process wide ones.
+         */
 		Bee(double body_length, double body_width, double body_height,
-            double body_mass, double max_speed);
+            double body_mass, double max_speed,
+            const PhysicalObject::Hull* hull = 0,
+            const ModelParameters& parameters = ModelParameters());
+
+        //! Body shape of a bee with the given dimensions.
+        static PhysicalObject::Hull makeHull(double body_length,
+                                             double body_width,
+                                             double body_height);
         
         //! destructor
         virtual ~Bee();
@@ -0,0 +1,272 @@
+/* Bee swarm implementation.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "BeeSwarm.h"
+
+#include "extensions/ExtendedWorld.h"
+#include "interactions/AirPump.h"
+#include "interactions/LightConstants.h"
+#include "interactions/LightSource.h"
+#include "interactions/WorldHeat.h"
+#include "interactions/WorldStimulus.h"
+
+namespace Enki
+{
+
+    const unsigned BeeSwarm::HEAT_SENSOR_COUNT;
+
+    // Light sensor range of a Bee
+    static const double LIGHT_SENSOR_RANGE = 10;
+
+// -----------------------------------------------------------------------------
+
+    BeeSwarm::BeeSwarm(double body_length, double body_width, double max_speed,
+                       const ModelParameters& parameters) :
+        world_(0),
+        body_radius_(body_length / 2),
+        wheel_distance_(body_width),
+        max_speed_(max_speed),
+        light_sensor_range_(LIGHT_SENSOR_RANGE),
+        air_flow_sensor_range_(parameters.air_flow_sensor_range)
+    {
+        // same positions as the heat sensors of a Bee
+        heat_sensor_positions_[0] = Vector(body_length / 2, 0);
+        heat_sensor_positions_[1] = Vector(0, body_width);
+        heat_sensor_positions_[2] = Vector(-body_length / 2, 0);
+        heat_sensor_positions_[3] = Vector(0, -body_width);
+    }
+
+// -----------------------------------------------------------------------------
+
+    std::size_t BeeSwarm::addBee(const Point& pos, double yaw)
+    {
+        x.push_back(pos.x);
+        y.push_back(pos.y);
+        this->yaw.push_back(yaw);
+        left_speed.push_back(0);
+        right_speed.push_back(0);
+        left_encoder.push_back(0);
+        right_encoder.push_back(0);
+        color_r.push_back(0.93);
+        color_g.push_back(0.79);
+        color_b.push_back(0);
+        const double ambient = world_ != 0 && world_->worldHeat != 0
+            ? world_->worldHeat->getHeatAt(pos) : 0;
+        temperatures.resize(temperatures.size() + HEAT_SENSOR_COUNT, ambient);
+        light_blue.push_back(0);
+        airflow_x.push_back(0);
+        airflow_y.push_back(0);
+        return x.size() - 1;
+    }
+
+// -----------------------------------------------------------------------------
+
+    void BeeSwarm::setPose(std::size_t bee, const Point& pos, double yaw)
+    {
+        x[bee] = pos.x;
+        y[bee] = pos.y;
+        this->yaw[bee] = yaw;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void BeeSwarm::initParameters(const ExtendedWorld* world)
+    {
+        world_ = world;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void BeeSwarm::initStateComputing(double dt)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* virtual */
+    void BeeSwarm::computeNextState(double dt)
+    {
+        if (x.empty())
+        {
+            return;
+        }
+        scanObjects_();
+        move_(dt);
+        collide_();
+        sense_();
+    }
+
+// -----------------------------------------------------------------------------
+
+    void BeeSwarm::scanObjects_()
+    {
+        obstacle_x_.clear();
+        obstacle_y_.clear();
+        obstacle_radius_.clear();
+        light_sources_.clear();
+        air_pumps_.clear();
+        for (World::Objects::const_iterator i = world_->objects.begin();
+             i != world_->objects.end(); ++i)
+        {
+            const PhysicalObject* po = *i;
+            // one cast per object and step, not per bee
+            const LightSource* light_source = dynamic_cast<const LightSource*>(po);
+            if (light_source != 0)
+            {
+                light_sources_.push_back(light_source);
+                continue;
+            }
+            const AirPump* air_pump = dynamic_cast<const AirPump*>(po);
+            if (air_pump != 0)
+            {
+                air_pumps_.push_back(air_pump);
+                continue;
+            }
+            obstacle_x_.push_back(po->pos.x);
+            obstacle_y_.push_back(po->pos.y);
+            obstacle_radius_.push_back(po->getRadius());
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void BeeSwarm::move_(double dt)
+    {
+        const std::size_t n = x.size();
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double left = std::max(-max_speed_, std::min(max_speed_, left_speed[i]));
+            const double right = std::max(-max_speed_, std::min(max_speed_, right_speed[i]));
+            const double forward = (left + right) / 2;
+            x[i] += forward * std::cos(yaw[i]) * dt;
+            y[i] += forward * std::sin(yaw[i]) * dt;
+            yaw[i] += (right - left) / wheel_distance_ * dt;
+            left_encoder[i] = left;
+            right_encoder[i] = right;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void BeeSwarm::collide_()
+    {
+        const std::size_t n = x.size();
+        // push the bees out of the bounding circles of the objects
+        for (std::size_t o = 0; o < obstacle_x_.size(); o++)
+        {
+            const double reach = obstacle_radius_[o] + body_radius_;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const double dx = x[i] - obstacle_x_[o];
+                const double dy = y[i] - obstacle_y_[o];
+                const double d2 = dx * dx + dy * dy;
+                if (d2 < reach * reach && d2 > 0)
+                {
+                    const double scale = reach / std::sqrt(d2);
+                    x[i] = obstacle_x_[o] + dx * scale;
+                    y[i] = obstacle_y_[o] + dy * scale;
+                }
+            }
+        }
+        // keep the bees inside the walls
+        switch (world_->wallsType)
+        {
+        case World::WALLS_SQUARE:
+            for (std::size_t i = 0; i < n; i++)
+            {
+                x[i] = std::max(body_radius_, std::min(world_->w - body_radius_, x[i]));
+                y[i] = std::max(body_radius_, std::min(world_->h - body_radius_, y[i]));
+            }
+            break;
+        case World::WALLS_CIRCULAR:
+        {
+            const double inside = world_->r - body_radius_;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const double d2 = x[i] * x[i] + y[i] * y[i];
+                if (d2 > inside * inside)
+                {
+                    const double scale = inside / std::sqrt(d2);
+                    x[i] *= scale;
+                    y[i] *= scale;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+
+    void BeeSwarm::sense_()
+    {
+        const std::size_t n = x.size();
+        if (world_->worldHeat != 0)
+        {
+            // all heat sensors of the swarm in one read of the grid
+            heat_positions_.resize(n * HEAT_SENSOR_COUNT);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const Point pos(x[i], y[i]);
+                const Matrix22 rot(yaw[i]);
+                for (unsigned s = 0; s < HEAT_SENSOR_COUNT; s++)
+                {
+                    heat_positions_[i * HEAT_SENSOR_COUNT + s] =
+                        pos + rot * heat_sensor_positions_[s];
+                }
+            }
+            world_->worldHeat->getHeatsAt(heat_positions_, temperatures);
+        }
+        WorldStimulus* stimulus = world_->worldStimulus;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const Point pos(x[i], y[i]);
+            double light = 0;
+            Vector airflow(0, 0);
+            if (stimulus != 0)
+            {
+                light = stimulus->getLightAt(pos, Light::Blue);
+                airflow = stimulus->getAirFlowAt(pos);
+            }
+            else
+            {
+                for (std::size_t l = 0; l < light_sources_.size(); l++)
+                {
+                    const LightSource* source = light_sources_[l];
+                    const double reach = light_sensor_range_ + source->getRadius();
+                    if ((source->absolutePosition - pos).norm2() <= reach * reach)
+                    {
+                        light += source->getIntensityAt(pos, Light::Blue);
+                    }
+                }
+                for (std::size_t a = 0; a < air_pumps_.size(); a++)
+                {
+                    const AirPump* pump = air_pumps_[a];
+                    const double reach = air_flow_sensor_range_ + pump->getRadius();
+                    if ((pump->absolutePosition - pos).norm2() <= reach * reach)
+                    {
+                        airflow += pump->getAirFlowAt(pos);
+                    }
+                }
+            }
+            light_blue[i] = light;
+            // in the bee frame, as read by an AirFlowSensor
+            const Vector local = Matrix22(-yaw[i]) * airflow;
+            airflow_x[i] = local.x;
+            airflow_y[i] = local.y;
+        }
+    }
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,121 @@
+/*! \file  BeeSwarm.h
+    \brief Many bees simulated as arrays.
+
+ */
+
+#ifndef ENKI_BEE_SWARM_H
+#define ENKI_BEE_SWARM_H
+
+#include <vector>
+
+#include <PhysicalEngine.h>
+
+#include "extensions/PhysicSimulation.h"
+#include "robots/ModelParameters.h"
+
+namespace Enki
+{
+
+    class LightSource;
+    class AirPump;
+
+    //! A swarm of bees that are not Enki objects.
+    /*! Every Bee is a full Enki robot with its own heap allocated
+        sensors. The swarm keeps the pose, wheel speeds, colour and
+        sensor values of each of its bees in arrays, and updates all
+        bees in batch passes over them, so colonies of thousands of
+        bees can be simulated.
+
+        The model is simpler than the Bee one. Bees move kinematically
+        with their wheel speeds. They collide with the walls and with
+        the bounding circle of every Enki object, such as the CASUs,
+        but not with each other. They sense heat, blue light and air
+        flow at the same positions as a Bee. They have no object
+        sensors, and Enki objects do not sense them.
+
+        The swarm is a physic simulation, so it is stepped by the
+        world after the heat model if it is added after it.
+     */
+    class BeeSwarm : public PhysicSimulation
+    {
+    public:
+        //! Heat sensors of each bee: front, left, back and right.
+        static const unsigned HEAT_SENSOR_COUNT = 4;
+
+        BeeSwarm(double body_length, double body_width, double max_speed,
+                 const ModelParameters& parameters = ModelParameters());
+
+        //! Add a bee.
+        /*! \return Index of the bee in the arrays.
+         */
+        std::size_t addBee(const Point& pos, double yaw);
+
+        //! Number of bees.
+        std::size_t size() const { return x.size(); }
+
+        //! Move a bee.
+        void setPose(std::size_t bee, const Point& pos, double yaw);
+
+        virtual void initParameters(const ExtendedWorld* world);
+        virtual void initStateComputing(double dt);
+        //! Move the bees, resolve collisions and update the sensors.
+        virtual void computeNextState(double dt);
+
+        /* State, one element per bee */
+
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> yaw;
+        //! Wheel speed setpoints.
+        std::vector<double> left_speed;
+        std::vector<double> right_speed;
+        //! Wheel speeds of the last step.
+        std::vector<double> left_encoder;
+        std::vector<double> right_encoder;
+        //! Diagnostic colour.
+        std::vector<double> color_r;
+        std::vector<double> color_g;
+        std::vector<double> color_b;
+
+        /* Sensor values */
+
+        //! HEAT_SENSOR_COUNT temperatures per bee.
+        std::vector<double> temperatures;
+        std::vector<double> light_blue;
+        //! Air flow in the bee frame.
+        std::vector<double> airflow_x;
+        std::vector<double> airflow_y;
+
+    private:
+        //! Gather the obstacles, light sources and air pumps.
+        void scanObjects_();
+        void move_(double dt);
+        void collide_();
+        void sense_();
+
+        const ExtendedWorld* world_;
+        double body_radius_;
+        double wheel_distance_;
+        double max_speed_;
+        double light_sensor_range_;
+        double air_flow_sensor_range_;
+        //! Positions of the heat sensors in the bee frame.
+        Vector heat_sensor_positions_[HEAT_SENSOR_COUNT];
+        //! Positions of the heat sensors of all bees in the last step.
+        std::vector<Point> heat_positions_;
+
+        //! Bounding circles of the Enki objects.
+        std::vector<double> obstacle_x_;
+        std::vector<double> obstacle_y_;
+        std::vector<double> obstacle_radius_;
+        std::vector<const LightSource*> light_sources_;
+        std::vector<const AirPump*> air_pumps_;
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -53,6 +53,8 @@ namespace Enki
     /*const*/ double Casu::VIBRATION_SENSOR_MAX_MEASURABLE_FREQUENCY = 500;
     /*const*/ double Casu::VIBRATION_SENSOR_AMPLITUDE_STANDARD_DEVIATION_GAUSSIAN_NOISE = 0;
     /*const*/ double Casu::VIBRATION_SENSOR_FREQUENCY_STANDARD_DEVIATION_GAUSSIAN_NOISE = 0;
+    unsigned Casu::VIBRATION_SPECTRUM_WINDOW = 0;
+    unsigned Casu::VIBRATION_SPECTRUM_PEAKS = 3;
 
     // Temperature sensors configuration
     const double Casu::TEMP_SENS_COUNT = 5;
@@ -70,7 +72,9 @@ namespace Enki
     /*const*/ double Casu::PELTIER_THERMAL_RESPONSE = 0.3;
     const double Casu::PELTIER_RADIUS = 1.6;
 
-    Casu::Casu(Vector pos, double yaw, ExtendedWorld* world, double ambientTemperature, int bridgeMask) :
+    Casu::Casu(Vector pos, double yaw, ExtendedWorld* world, double ambientTemperature, int bridgeMask, bool drawPeltier,
+               const ModelParameters& parameters) :
+        ExtendedRobot(OBJECT_CASU),
         world_(world),
         range_sensors(6),
         vibration_sensors (Casu::NUMBER_VIBRATION_SENSORS),
@@ -81,17 +85,9 @@ namespace Enki
         this->angle = yaw;
   
         // Set physical properties
-        double radius = 1;
-        double height = 2;
-        Polygone hex;
-        for (double a = pi/6; a < 2*pi; a += pi/3)
-            {
-                hex.push_back(Point(radius * cos(a), radius * sin(a)));
-            }
-        PhysicalObject::Hull hull(PhysicalObject::Part(hex, height));
-        setCustomHull(hull, 1000);
+        setCustomHull(prefabHull(), 1000);
         setColor(Color(0.8,0.8,0.8,0.3));
-        PhysicalObject::dryFrictionCoefficient = 1000; // Casus are immovable
+        PhysicalObject::dryFrictionCoefficient = Component::IMMOVABLE_DRY_FRICTION; // Casus are immovable
 
         // Add range sensors
         range_sensors[0] = new IRSensor(this, Vector(0.866,0), 0, 0, 
@@ -169,21 +165,24 @@ namespace Enki
         // TODO: make peltier parameters CASU constants
         peltier = new HeatActuatorMesh
            (this, Vector(0,0),
-            PELTIER_THERMAL_RESPONSE, ambientTemperature,
+            parameters.peltier_thermal_response, ambientTemperature,
             PELTIER_RADIUS, 16);
         this->addPhysicInteraction(this->peltier);
-        world->worldHeat->drawCircle (WorldHeat::THERMAL_DIFFUSIVITY_COPPER, this->pos, PELTIER_RADIUS);
+        if (drawPeltier) {
+            world->worldHeat->drawCircle (WorldHeat::THERMAL_DIFFUSIVITY_COPPER, this->pos, PELTIER_RADIUS);
+        }
 
         // Add vibration actuator
 
         this->vibration_source = new WaveVibrationSource
-            (Casu::VIBRATION_SOURCE_RANGE, this,
+            (parameters.vibration_source_range, this,
              Casu::VIBRATION_SOURCE_POSITION,
-             Casu::VIBRATION_SOURCE_MAXIMUM_AMPLITUDE,
+             parameters.vibration_source_maximum_amplitude,
              Casu::VIBRATION_SOURCE_PHASE,
              Casu::VIBRATION_SOURCE_VELOCITY,
-             Casu::VIBRATION_SOURCE_AMPLITUDE_QUADRATIC_DECAY,
-             Casu::VIBRATION_SOURCE_NOISE);
+             parameters.vibration_source_amplitude_quadratic_decay,
+             parameters.vibration_source_noise,
+             world);
         this->vibration_source->setCylindric(0, 0, -1); // Set to point object
         world_->addObject (this->vibration_source);
         addLocalInteraction (this->vibration_source);
@@ -196,6 +195,7 @@ namespace Enki
                  Casu::VIBRATION_SENSOR_MAX_MEASURABLE_FREQUENCY,
                  Casu::VIBRATION_SENSOR_AMPLITUDE_STANDARD_DEVIATION_GAUSSIAN_NOISE,
                  Casu::VIBRATION_SENSOR_FREQUENCY_STANDARD_DEVIATION_GAUSSIAN_NOISE);
+            vs->setSpectrumWindow (Casu::VIBRATION_SPECTRUM_WINDOW);
             this->vibration_sensors [i] = vs;
         }
 
@@ -204,7 +204,7 @@ namespace Enki
             double angle = Casu::AIR_PUMP_ORIENTATION + i * 2 * pi / Casu::AIR_PUMP_QUANTITY;
             Vector position (Casu::AIR_PUMP_DISTANCE * cos (angle), Casu::AIR_PUMP_DISTANCE * sin (angle));
             AirPump *airPump = new AirPump
-                (Casu::AIR_PUMP_RANGE,
+                (parameters.air_pump_range,
                  this,
                  position,
                  angle,
@@ -235,6 +235,34 @@ namespace Enki
             }
     }
 
+// -----------------------------------------------------------------------------
+
+    /* static */
+    void Casu::drawPeltiers(ExtendedWorld* world, const std::vector<Point>& positions)
+    {
+        world->worldHeat->drawCircles (WorldHeat::THERMAL_DIFFUSIVITY_COPPER, positions, PELTIER_RADIUS);
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    const PhysicalObject::Hull& Casu::prefabHull()
+    {
+        static PhysicalObject::Hull hull;
+        if (hull.empty())
+        {
+            double radius = 1;
+            double height = 2;
+            Polygone hex;
+            for (double a = pi/6; a < 2*pi; a += pi/3)
+                {
+                    hex.push_back(Point(radius * cos(a), radius * sin(a)));
+                }
+            hull.push_back(PhysicalObject::Part(hex, height));
+        }
+        return hull;
+    }
+
 // -----------------------------------------------------------------------------
 
 void Casu::
@@ -19,6 +19,7 @@
 #include "interactions/VibrationSensor.h"
 #include "interactions/HeatSensor.h"
 #include "interactions/AirPump.h"
+#include "robots/ModelParameters.h"
 
 namespace Enki
 {
@@ -48,6 +49,15 @@ namespace Enki
        static /*const*/ double VIBRATION_SENSOR_MAX_MEASURABLE_FREQUENCY;
        static /*const*/ double VIBRATION_SENSOR_AMPLITUDE_STANDARD_DEVIATION_GAUSSIAN_NOISE;
        static /*const*/ double VIBRATION_SENSOR_FREQUENCY_STANDARD_DEVIATION_GAUSSIAN_NOISE;
+       /**
+        * Number of samples kept by each vibration sensor to compute the
+        * spectrum of the sensed wave, 0 to keep none.
+        */
+       static unsigned VIBRATION_SPECTRUM_WINDOW;
+       /**
+        * Number of dominant frequencies published from the spectrum.
+        */
+       static unsigned VIBRATION_SPECTRUM_PEAKS;
 
        /* Temperature sensors' parameters and configuration */
        static const double TEMP_SENS_COUNT;
@@ -76,7 +86,19 @@ namespace Enki
 
     public:
         //! Create a CASU
-        Casu (Vector pos, double yaw, ExtendedWorld* world, double ambientTemperature, int bridgeMask = 0);
+        /*! If drawPeltier is false the copper disc under the peltier is
+            not drawn in the heat diffusivity grid, and the caller
+            should draw it with drawPeltiers. This is used to draw
+            the discs of many CASUs at once.
+
+            The peltier, vibration source and air pumps are configured
+            from parameters, by default the process wide ones.
+         */
+        Casu (Vector pos, double yaw, ExtendedWorld* world, double ambientTemperature, int bridgeMask = 0, bool drawPeltier = true,
+              const ModelParameters& parameters = ModelParameters ());
+
+        //! Draw the copper discs of CASUs at the given positions.
+        static void drawPeltiers (ExtendedWorld* world, const std::vector<Point>& positions);
 
         //! Destructor
         ~Casu();
@@ -113,6 +135,9 @@ namespace Enki
         AirPumpVector air_pumps;
 
     private:
+        //! Shape shared by all CASUs, built on first use.
+        static const PhysicalObject::Hull& prefabHull ();
+
         World* world_;
         void createBridge (ExtendedWorld* world, Vector direction);
     };
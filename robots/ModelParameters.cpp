@@ -0,0 +1,107 @@
+/* Model parameters implementation.
+
+ */
+
+#include "ModelParameters.h"
+
+#include "Casu.h"
+#include "Bee.h"
+#include "interactions/WorldHeat.h"
+
+using namespace std;
+
+namespace Enki
+{
+
+    // Configuration file keys, in the order of the members
+    static const char* const KEYS[] = {
+        "Vibration.range",
+        "Vibration.maximum_amplitude",
+        "Vibration.amplitude_quadratic_decay",
+        "Vibration.noise",
+        "Peltier.thermal_response",
+        "AirFlow.pump_range",
+        "AirFlow.sensor_range",
+        "Heat.cell_dissipation"
+    };
+    static const size_t KEY_COUNT = sizeof(KEYS) / sizeof(KEYS[0]);
+
+// -----------------------------------------------------------------------------
+
+    ModelParameters::ModelParameters()
+        : vibration_source_range(Casu::VIBRATION_SOURCE_RANGE),
+          vibration_source_maximum_amplitude(Casu::VIBRATION_SOURCE_MAXIMUM_AMPLITUDE),
+          vibration_source_amplitude_quadratic_decay(Casu::VIBRATION_SOURCE_AMPLITUDE_QUADRATIC_DECAY),
+          vibration_source_noise(Casu::VIBRATION_SOURCE_NOISE),
+          peltier_thermal_response(Casu::PELTIER_THERMAL_RESPONSE),
+          air_pump_range(Casu::AIR_PUMP_RANGE),
+          air_flow_sensor_range(Bee::AIR_FLOW_SENSOR_RANGE),
+          cell_dissipation(WorldHeat::CELL_DISSIPATION)
+    {
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool ModelParameters::set(const string& key, double value)
+    {
+        double* member = find_(key);
+        if (member == 0)
+        {
+            return false;
+        }
+        *member = value;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    bool ModelParameters::get(const string& key, double& value) const
+    {
+        const double* member = const_cast<ModelParameters*>(this)->find_(key);
+        if (member == 0)
+        {
+            return false;
+        }
+        value = *member;
+        return true;
+    }
+
+// -----------------------------------------------------------------------------
+
+    /* static */
+    vector<string> ModelParameters::keys()
+    {
+        return vector<string>(KEYS, KEYS + KEY_COUNT);
+    }
+
+// -----------------------------------------------------------------------------
+
+    double* ModelParameters::find_(const string& key)
+    {
+        double* members[] = {
+            &vibration_source_range,
+            &vibration_source_maximum_amplitude,
+            &vibration_source_amplitude_quadratic_decay,
+            &vibration_source_noise,
+            &peltier_thermal_response,
+            &air_pump_range,
+            &air_flow_sensor_range,
+            &cell_dissipation
+        };
+        for (size_t i = 0; i < KEY_COUNT; i++)
+        {
+            if (key == KEYS[i])
+            {
+                return members[i];
+            }
+        }
+        return 0;
+    }
+
+// -----------------------------------------------------------------------------
+
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
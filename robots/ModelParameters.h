@@ -0,0 +1,60 @@
+/*! \file  ModelParameters.h
+    \brief Tunable parameters of the CASU, bee and heat models.
+
+ */
+
+#ifndef ENKI_MODEL_PARAMETERS_H
+#define ENKI_MODEL_PARAMETERS_H
+
+#include <string>
+#include <vector>
+
+namespace Enki
+{
+
+    //! Model parameters of one world.
+    /*! The static members of Casu, Bee and WorldHeat hold the
+        process wide defaults, set from the configuration file. A
+        default constructed ModelParameters copies them; worlds with
+        their own parameters, such as the instances of an ensemble,
+        pass a modified copy to the objects they create.
+     */
+    struct ModelParameters
+    {
+        double vibration_source_range;
+        double vibration_source_maximum_amplitude;
+        double vibration_source_amplitude_quadratic_decay;
+        double vibration_source_noise;
+        double peltier_thermal_response;
+        double air_pump_range;
+        double air_flow_sensor_range;
+        double cell_dissipation;
+
+        //! Copy the current process wide defaults.
+        ModelParameters();
+
+        //! Set a parameter by its configuration file key.
+        /*! \param key Key as in Playground.cfg, e.g. Vibration.range.
+            \return False if the key is not a model parameter.
+         */
+        bool set(const std::string& key, double value);
+
+        //! Value of a parameter by its configuration file key.
+        /*! \return False if the key is not a model parameter.
+         */
+        bool get(const std::string& key, double& value) const;
+
+        //! Configuration file keys of all parameters.
+        static std::vector<std::string> keys();
+
+    private:
+        double* find_(const std::string& key);
+    };
+
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End: